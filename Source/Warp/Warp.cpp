@@ -1,210 +1,1444 @@
-// Copyright Epic Games, Inc. All Rights Reserved.
-
-#include "Warp.h"
-#include "Modules/ModuleManager.h"
-
-IMPLEMENT_PRIMARY_GAME_MODULE(FWarpGameModule, Warp, "Warp" );
-
-void FWarpGameModule::StartupModule()
-{
-
-	UE_LOG(LogUnrealMath, Log, TEXT("Warp startup"));
-
-    SetTileTypeW(5);
-    
-    GenerateTileMap(8, false, 6);
-    LoadTileMap();
-
-}
-
-// Geometry tiles functions
-
-//Try spawn tile
-bool TrySpawn(vector<Tile> *tiles, string coord, GyroVectorD gv) {
-    for (int i = 0; i < tiles->size(); ++i) {
-        GyroVectorD gv2 = tiles->at(i).gv;
-        if (sqrMagnitude(sub(gv, gv2).vec) < 1e-10) {
-            return false;
-        }
-    }
-    tiles->push_back(Tile(coord, gv));
-    return true;
-}
-
-void SplitAndAdd(FBufferArchive* dataArchive, float v) {
-    char* cv = (char*)&v;
-    for (int i = 0; i < 4; ++i) {
-        dataArchive->Add(cv[i]);
-    }
-}
-
-void Add(string coord, GyroVectorD gv, FString fname) {
-    FBufferArchive dataArchive;
-    FFileHelper::LoadFileToArray(dataArchive, *fname);
-    dataArchive.Add((uint8)coord.length() & 0x0000FF);
-    for (int i = 0; i < coord.length(); ++i) {
-        dataArchive.Add((uint8)coord[i]);
-    }
-    SplitAndAdd(&dataArchive, gv.vec.X);
-    SplitAndAdd(&dataArchive, gv.vec.Y);
-    SplitAndAdd(&dataArchive, gv.vec.Z);
-    SplitAndAdd(&dataArchive, gv.gyr.X);
-    SplitAndAdd(&dataArchive, gv.gyr.Y);
-    SplitAndAdd(&dataArchive, gv.gyr.Z);
-    SplitAndAdd(&dataArchive, gv.gyr.W);
-    FFileHelper::SaveArrayToFile(dataArchive, *fname);
-}
-
-float GetAndUnite(TArray<uint8> dataArchive, int32 *it) {
-    float f;
-    char b[] = { (char)dataArchive[*it], (char)dataArchive[*it + 1], (char)dataArchive[*it + 2], (char)dataArchive[*it + 3] };
-    memcpy(&f, &b, sizeof(f));
-    *it = *it + 4;
-    return f;
-}
-
-// Load tilemap of 2D area
-void FWarpGameModule::LoadTileMap() {
-
-    curr_tilemap.Empty();
-    TArray<uint8> dataArchive;
-    FFileHelper::LoadFileToArray(dataArchive, *curr_map);
-    int32 n = dataArchive.Num();
-    int32 it = 0;
-    TMap<char, FVector2D> conv = {
-        {'L', FVector2D(-CELL_WIDTH, 0)},
-        {'R', FVector2D(CELL_WIDTH, 0)},
-        {'D', FVector2D(0, -CELL_WIDTH)},
-        {'U', FVector2D(0, CELL_WIDTH)},
-        {'C', FVector2D(0, 0)},
-    };
-
-    FString Output;
-	
-	// Create non-euqlidean tiles
-    while (it < n) {
-        
-        int32 len = (int32)dataArchive[it];
-        it++;
-        len = len + it;
-        string coord;
-        FVector2D xz = FVector2D(0, 0);
-        for (;it < len; ++it) {
-            char c = (char)dataArchive[it];
-            xz += conv[c];
-        }
-
-        FVector vec;
-        vec.X = GetAndUnite(dataArchive, &it);
-        vec.Y = GetAndUnite(dataArchive, &it);
-        vec.Z = GetAndUnite(dataArchive, &it);
-
-        FQuat quat;
-        quat.X = GetAndUnite(dataArchive, &it);
-        quat.Y = GetAndUnite(dataArchive, &it);
-        quat.Z = GetAndUnite(dataArchive, &it);
-        quat.W = GetAndUnite(dataArchive, &it);
-
-        GyroVectorD gv = GyroVectorD(vec, quat);
-        WorldTile tile = WorldTile(xz, gv);
-        curr_tilemap.Add(tile);
-    }
-    
-}
-
-//Generate 2D tilemap
-void FWarpGameModule::GenerateTileMap(int type, bool lattice3D, int max_expand) 
-{
-
-    FString Output = "";
-
-    SetTileType(type);
-    vector<Tile> tiles;
-    tiles.push_back(Tile("C", GyroVectorD()));
-
-    FFileManagerGeneric *GFileManager = new FFileManagerGeneric();
-
-    if (!GFileManager->DirectoryExists(*MAP_DIR)) GFileManager->MakeDirectory(*MAP_DIR);
-
-    FString mapName = "Map" + FString::FromInt(type) + (lattice3D ? "L" : "") + ".bin";
-    curr_map = MAP_DIR + "/" + mapName;
-
-    FBufferArchive dataArchive;
-    FFileHelper::SaveArrayToFile(dataArchive, *curr_map);
-	
-	
-	//Each type of geometry has its own number of tiles
-	if (N == 2) {
-	   tiles.push_back(Tile("R", GyroVectorD(CELL_WIDTH, 0.0, 0.0)));
-	}
-	else if (N == 3) {
-	   ExpandMap(&tiles, 0, lattice3D);
-	   tiles.push_back(Tile("RR", add(tiles.at(1).gv, FVector4(CELL_WIDTH, 0.0, 0.0, 0.0))));
-	}
-	else {
-	   for (int i = 0; i < max_expand; ++i) {
-		   ExpandMap(&tiles, i, lattice3D);
-	   }
-	}
-
-	for (int i = 0; i < tiles.size(); ++i) {
-	   Add(tiles[i].coord, tiles[i].gv, curr_map);
-	}
-
-}
-
-// Shift tiles by direction
-FVector FWarpGameModule::MakeShift(char c) {
-    switch (c) {
-		case 'L': return FVector(-CELL_WIDTH, 0.0, 0.0);
-		case 'R': return FVector(CELL_WIDTH, 0.0, 0.0);
-		case 'F': return FVector(0.0, -CELL_WIDTH, 0.0);
-		case 'B': return FVector(0.0, CELL_WIDTH, 0.0);
-		case 'D': return FVector(0.0, 0.0, -CELL_WIDTH);
-		case 'U': return FVector(0.0, 0.0, CELL_WIDTH);
-		default: return FVector(0, 0, 0);
-    }
-}
-
-// Expand 2D tilemap
-void FWarpGameModule::ExpandMap(vector<Tile> *tiles, int len, bool lattice3D) {
-    for (int i = 0; i < tiles->size(); ++i) {
-        string coord = tiles->at(i).coord;
-        GyroVectorD gv = tiles->at(i).gv;
-
-        if (coord.length() == len) {
-            char last = (coord.length() > 0 ? coord[coord.length() - 1] : '\0');
-            if (last != 'L') {
-                TrySpawn(tiles, coord + "R", add(gv, MakeShift('R')));
-            }
-            if (last != 'R') {
-                TrySpawn(tiles, coord + "L", add(gv, MakeShift('L')));
-            }
-            if (last != 'D') {
-                TrySpawn(tiles, coord + "U", add(gv, MakeShift('U')));
-            }
-            if (last != 'U') {
-                TrySpawn(tiles, coord + "D", add(gv, MakeShift('D')));
-            }
-            if (lattice3D) {
-                if (last != 'F') {
-                    TrySpawn(tiles, coord + "B", add(gv, MakeShift('B')));
-                }
-                if (last != 'B') {
-                    TrySpawn(tiles, coord + "F", add(gv, MakeShift('F')));
-                }
-            }
-        }
-    }
-}
-
-unsigned char FWarpGameModule::NearbyAfterShift(vector<Tile> tiles, int ix, char c) {
-    GyroVectorD gv = add(tiles[ix].gv, MakeShift(c));
-    for (int i = 0; i < tiles.size(); ++i) {
-        GyroVectorD gv2 = tiles[i].gv;
-        if (sqrMagnitude(sub(gv, gv2).vec) < 1e-10) {
-            return 1;
-        }
-    }
-    return 0;
-}
\ No newline at end of file
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "Warp.h"
+#include "Modules/ModuleManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Async/ParallelFor.h"
+#include "Async/Async.h"
+#include "WarpMapFormat.h"
+#include "WarpVisibility.h"
+#include "WarpSymmetry.h"
+#include "WarpPathfinding.h"
+#include "Algo/Sort.h"
+#include "Algo/StableSort.h"
+
+IMPLEMENT_PRIMARY_GAME_MODULE(FWarpGameModule, Warp, "Warp" );
+
+//Switch curvature trig functions between exact, fast and table evaluation
+static FAutoConsoleCommand TrigModeCommand(
+    TEXT("Warp.TrigMode"),
+    TEXT("Warp.TrigMode <exact|fast|table>"),
+    FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args) {
+        if (Args.Num() > 0) {
+            if (Args[0] == TEXT("fast")) TrigMode() = ETrigMode::Fast;
+            else if (Args[0] == TEXT("table")) TrigMode() = ETrigMode::Table;
+            else TrigMode() = ETrigMode::Exact;
+        }
+        UE_LOG(LogUnrealMath, Log, TEXT("Warp trig mode %d"), (int32)TrigMode());
+    }));
+
+//Generate and load a map, e.g. "Warp.GenerateMap 5 1 8" for the {4,3,5} honeycomb to depth 8
+static FAutoConsoleCommand GenerateMapCommand(
+    TEXT("Warp.GenerateMap"),
+    TEXT("Warp.GenerateMap <N> <3D 0|1> <depth>"),
+    FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args) {
+        if (Args.Num() < 3) {
+            return;
+        }
+        FWarpGameModule* m = GetWarpModule();
+        m->GenerateTileMap(FCString::Atoi(*Args[0]), FCString::Atoi(*Args[1]) != 0, FCString::Atoi(*Args[2]));
+        m->LoadTileMap();
+    }));
+
+//Build a geometry in the background for a later switch, e.g. "Warp.PreloadGeometry 6 0 6"
+static FAutoConsoleCommand PreloadGeometryCommand(
+    TEXT("Warp.PreloadGeometry"),
+    TEXT("Warp.PreloadGeometry <N> <3D 0|1> <depth>"),
+    FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args) {
+        if (Args.Num() < 3) {
+            return;
+        }
+        GetWarpModule()->PreloadGeometry(FCString::Atoi(*Args[0]), FCString::Atoi(*Args[1]) != 0, FCString::Atoi(*Args[2]));
+    }));
+
+//Grow a map at runtime instead of generating it up front, e.g. "Warp.LazyMap 5 0 4 12"
+static FAutoConsoleCommand LazyMapCommand(
+    TEXT("Warp.LazyMap"),
+    TEXT("Warp.LazyMap <N> <3D 0|1> <initial rings> <max rings>"),
+    FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args) {
+        if (Args.Num() < 4) {
+            return;
+        }
+        GetWarpModule()->StartLazyMap(FCString::Atoi(*Args[0]), FCString::Atoi(*Args[1]) != 0, FCString::Atoi(*Args[2]), FCString::Atoi(*Args[3]));
+    }));
+
+//Bake potentially visible sets into the current map file and reload it, e.g. "Warp.BakeVisibility 65536"
+static FAutoConsoleCommand BakeVisibilityCommand(
+    TEXT("Warp.BakeVisibility"),
+    TEXT("Warp.BakeVisibility [budget]"),
+    FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args) {
+        FWarpGameModule* m = GetWarpModule();
+        if (Args.Num() > 0) m->VISIBILITY_BUDGET = FCString::Atoi(*Args[0]);
+
+        FWarpGeometryPtr active = m->GetGeometry();
+        TArray<uint8> dataArchive;
+        if (!active.IsValid() || !FFileHelper::LoadFileToArray(dataArchive, *active->map)) {
+            return;
+        }
+        FWarpGeometry geometry = *active;
+        m->BakeVisibility(&geometry, &dataArchive);
+        FFileHelper::SaveArrayToFile(dataArchive, *active->map);
+        m->LoadTileMap();
+    }));
+
+void FWarpGameModule::ShutdownModule()
+{
+
+    StopLazyMap();
+    for (TFuture<void>& preload : preloads) {
+        preload.Wait();
+    }
+    preloads.Empty();
+
+}
+
+void FWarpGameModule::StartupModule()
+{
+
+	UE_LOG(LogUnrealMath, Log, TEXT("Warp startup"));
+
+    SetTileTypeW(5);
+    
+    GenerateTileMap(8, false, 6);
+    LoadTileMap();
+
+}
+
+// Geometry tiles functions
+
+//Try spawn tile, fails on a duplicate or when the set is full
+bool TrySpawn(TileSet *tiles, int32 parent, char move, GyroVectorD gv) {
+    if (tiles->Find(gv) >= 0) {
+        return false;
+    }
+    int32 len = parent >= 0 ? (*tiles)[parent].len + 1 : 1;
+    return tiles->Push(Tile(parent, move, len, gv)) >= 0;
+}
+
+void SplitAndAdd(TArray<uint8>* dataArchive, float v) {
+    char* cv = (char*)&v;
+    for (int i = 0; i < 4; ++i) {
+        dataArchive->Add(cv[i]);
+    }
+}
+
+//Rebuild the coordinate path of a tile from its parent chain, returns its length
+int32 BuildCoord(const TileSet& tiles, int32 ix, char* coord) {
+    for (int32 i = ix; i >= 0; i = tiles[i].parent) {
+        coord[tiles[i].len - 1] = tiles[i].move;
+    }
+    return tiles[ix].len;
+}
+
+//Bytes of one tile record
+int32 RecordSize(int32 len) {
+    return 1 + len + 7 * sizeof(float);
+}
+
+//Raw records mark the antipode with this position on every axis and an identity gyration
+static const float AT_INFINITY_MARK = FLT_MAX;
+
+//Append a tile record, the archive is saved once after generation
+void Add(TArray<uint8>* dataArchive, const char* coord, int32 len, GyroVectorD gv) {
+    if (!TileIndex::IsFinite(gv.vec)) {
+        gv.vec = FVector(AT_INFINITY_MARK);
+        gv.gyr = FQuat::Identity;
+    }
+    dataArchive->Add((uint8)len & 0x0000FF);
+    dataArchive->Append((const uint8*)coord, len);
+    SplitAndAdd(dataArchive, gv.vec.X);
+    SplitAndAdd(dataArchive, gv.vec.Y);
+    SplitAndAdd(dataArchive, gv.vec.Z);
+    SplitAndAdd(dataArchive, gv.gyr.X);
+    SplitAndAdd(dataArchive, gv.gyr.Y);
+    SplitAndAdd(dataArchive, gv.gyr.Z);
+    SplitAndAdd(dataArchive, gv.gyr.W);
+}
+
+//Write all tile records, the archive is sized exactly so writing does not reallocate
+void WriteRawTileSet(const TileSet& tiles, TArray<uint8>* dataArchive) {
+    int64 bytes = 0;
+    for (int32 i = 0; i < tiles.Num(); ++i) {
+        bytes += RecordSize(tiles[i].len);
+    }
+    dataArchive->Reserve(bytes);
+
+    char coord[256];
+    for (int32 i = 0; i < tiles.Num(); ++i) {
+        int32 len = BuildCoord(tiles, i, coord);
+        Add(dataArchive, coord, len, tiles[i].gv);
+    }
+}
+
+void WriteTileSet(const TileSet& tiles, TArray<uint8>* dataArchive, bool compressed) {
+    if (compressed) {
+        WarpMapFormat::Write(tiles, dataArchive);
+    }
+    else {
+        WriteRawTileSet(tiles, dataArchive);
+    }
+}
+
+float GetAndUnite(const TArray<uint8>& dataArchive, int32 *it) {
+    float f;
+    char b[] = { (char)dataArchive[*it], (char)dataArchive[*it + 1], (char)dataArchive[*it + 2], (char)dataArchive[*it + 3] };
+    memcpy(&f, &b, sizeof(f));
+    *it = *it + 4;
+    return f;
+}
+
+FIntVector MoveCell(char c) {
+    switch (c) {
+        case 'L': return FIntVector(-1, 0, 0);
+        case 'R': return FIntVector(1, 0, 0);
+        case 'F': return FIntVector(0, -1, 0);
+        case 'B': return FIntVector(0, 1, 0);
+        case 'D': return FIntVector(0, 0, -1);
+        case 'U': return FIntVector(0, 0, 1);
+        default: return FIntVector(0, 0, 0);
+    }
+}
+
+// Parse tile records into a geometry, its curvature must be set
+void ParseTileMap(const TArray<uint8>& dataArchive, FWarpGeometry* geometry) {
+
+    //Visibility is a trailer after the tiles in either format
+    int32 trailer = WarpVisibility::TrailerSize(dataArchive);
+
+    if (WarpMapFormat::IsCompressed(dataArchive)) {
+        if (!WarpMapFormat::Read(dataArchive, geometry)) {
+            UE_LOG(LogUnrealMath, Error, TEXT("Corrupt compressed tile map %s"), *geometry->map);
+            return;
+        }
+        FinalizeTiles(geometry);
+        if (trailer > 0) {
+            WarpVisibility::Read(dataArchive, geometry->tiles.Num(), &geometry->visibility);
+        }
+        return;
+    }
+
+    int32 n = dataArchive.Num() - trailer;
+    int32 it = 0;
+    TMap<char, FIntVector> conv = {
+        {'L', FIntVector(-1, 0, 0)},
+        {'R', FIntVector(1, 0, 0)},
+        {'F', FIntVector(0, -1, 0)},
+        {'B', FIntVector(0, 1, 0)},
+        {'D', FIntVector(0, 0, -1)},
+        {'U', FIntVector(0, 0, 1)},
+        {'C', FIntVector(0, 0, 0)},
+    };
+    float cw = geometry->curvature.CELL_WIDTH;
+	
+	// Create non-euqlidean tiles
+    while (it < n) {
+        
+        int32 len = (int32)dataArchive[it];
+        int32 ring = len - 1;   //The path starts with the origin tile's C
+        it++;
+        len = len + it;
+        FIntVector cell = FIntVector(0, 0, 0);
+        for (;it < len; ++it) {
+            char c = (char)dataArchive[it];
+            cell += conv[c];
+            geometry->lattice3D |= (c == 'F' || c == 'B');
+        }
+        FVector2D xz = FVector2D(cell.X * cw, cell.Z * cw);
+
+        FVector vec;
+        vec.X = GetAndUnite(dataArchive, &it);
+        vec.Y = GetAndUnite(dataArchive, &it);
+        vec.Z = GetAndUnite(dataArchive, &it);
+
+        FQuat quat;
+        quat.X = GetAndUnite(dataArchive, &it);
+        quat.Y = GetAndUnite(dataArchive, &it);
+        quat.Z = GetAndUnite(dataArchive, &it);
+        quat.W = GetAndUnite(dataArchive, &it);
+
+        if (vec == FVector(AT_INFINITY_MARK)) {
+            vec = TileIndex::AtInfinity();
+        }
+        GyroVectorD gv = GyroVectorD(vec, quat);
+        geometry->tiles.Add(cell, xz, gv, ring);
+    }
+
+    FinalizeTiles(geometry);
+    if (trailer > 0) {
+        WarpVisibility::Read(dataArchive, geometry->tiles.Num(), &geometry->visibility);
+    }
+    
+}
+
+//Morton code of a cell given as unsigned offsets, X, Z and in 3D Y interleaved from the lowest bit
+static uint64 MortonCode(uint32 x, uint32 y, uint32 z, int32 dims, int32 levels) {
+    uint32 axes[3] = { x, z, y };
+    uint64 code = 0;
+    for (int32 b = 0; b < levels; ++b) {
+        for (int32 d = 0; d < dims; ++d) {
+            code |= (uint64)((axes[d] >> b) & 1) << (b * dims + d);
+        }
+    }
+    return code;
+}
+
+// Sort tiles from first on by ring, then by Morton code within each ring, and index their rings and cells
+// Tiles before first are already finalized and in lower rings, so a lazy map only sorts the rings it appends
+// Codes are taken from a fixed origin, so a lazy map's published rings keep their order as it grows
+void FinalizeTiles(FWarpGeometry* geometry, int32 first) {
+
+    FWarpTileStore& tiles = geometry->tiles;
+    const int32 n = tiles.Num();
+    const int32 count = n - first;
+    const int32 dims = geometry->lattice3D ? 3 : 2;
+    const int32 levels = 64 / dims;
+    const uint32 bias = 1u << (levels - 1);
+    if (first == 0) {
+        tiles.ringStart.Reset();
+        tiles.ringInner.Reset();
+        geometry->cell_tiles.Reset();
+    }
+
+    TArray<uint64> codes;
+    codes.SetNumUninitialized(count);
+    for (int32 i = 0; i < count; ++i) {
+        const FIntVector& c = tiles.cell[first + i];
+        codes[i] = MortonCode((uint32)c.X + bias, (uint32)c.Y + bias, (uint32)c.Z + bias, dims, levels);
+    }
+    TArray<int32> order;
+    order.SetNumUninitialized(count);
+    for (int32 i = 0; i < count; ++i) {
+        order[i] = i;
+    }
+    const int32* rings = tiles.ring.GetData() + first;
+    Algo::StableSort(order, [rings, &codes](int32 a, int32 b) {
+        return rings[a] != rings[b] ? rings[a] < rings[b] : codes[a] < codes[b];
+    });
+
+    FWarpTileStore sorted;
+    sorted.Reserve(count);
+    for (int32 i : order) {
+        sorted.Add(tiles.cell[first + i], tiles.xz[first + i], tiles.GV(first + i), tiles.ring[first + i]);
+    }
+    tiles.vec.SetNum(first, false);
+    tiles.gyr.SetNum(first, false);
+    tiles.xz.SetNum(first, false);
+    tiles.cell.SetNum(first, false);
+    tiles.ring.SetNum(first, false);
+    tiles.vec.Append(sorted.vec);
+    tiles.gyr.Append(sorted.gyr);
+    tiles.xz.Append(sorted.xz);
+    tiles.cell.Append(sorted.cell);
+    tiles.ring.Append(sorted.ring);
+
+    //The tile count after the last ring moves to the end of the new rings
+    if (tiles.ringStart.Num() > 0) {
+        tiles.ringStart.Pop(false);
+    }
+    geometry->cell_tiles.Reserve(n);
+    for (int32 ix = first; ix < n; ++ix) {
+        int32 ring = tiles.ring[ix];
+        while (tiles.ringStart.Num() <= ring) {
+            tiles.ringStart.Add(ix);
+            tiles.ringInner.Add(FLT_MAX);
+        }
+        if (TileIndex::IsFinite(tiles.vec[ix])) {
+            tiles.ringInner[ring] = FMath::Min(tiles.ringInner[ring], tiles.vec[ix].Size());
+        }
+
+        //Several paths can end in the same cell, the first tile of the lowest ring owns it
+        if (!geometry->cell_tiles.Contains(tiles.cell[ix])) {
+            geometry->cell_tiles.Add(tiles.cell[ix], ix);
+        }
+    }
+    tiles.ringStart.Add(n);
+
+}
+
+//Link tiles from first on to the tiles across their faces, find gives the tile at a position or INDEX_NONE
+template<typename Find>
+static void LinkNeighbours(FWarpGeometry* geometry, int32 first, Find find) {
+
+    FWarpGameModule* m = GetWarpModule();
+    const char moves[] = { 'R', 'L', 'U', 'D', 'B', 'F' };
+    const int32 numMoves = geometry->lattice3D ? 6 : 4;
+    const FWarpTileStore& tiles = geometry->tiles;
+    int32 n = tiles.Num();
+
+    geometry->neighbours.SetNumUninitialized(n * FWarpGeometry::FACES);
+    for (int32 i = first; i < n; ++i) {
+        for (int32 f = 0; f < FWarpGeometry::FACES; ++f) {
+            int32 next = INDEX_NONE;
+            if (f < numMoves) {
+                FVector v = add(tiles.GV(i), m->MakeShift(moves[f])).vec;
+                next = TileIndex::IsFinite(v) ? find(v) : INDEX_NONE;
+            }
+            geometry->neighbours[i * FWarpGeometry::FACES + f] = next;
+        }
+    }
+
+}
+
+// Link each tile to the tiles across its faces, found by position like duplicates during generation
+void BuildNeighbours(FWarpGeometry* geometry) {
+
+    FScopedCurvature scope(geometry->curvature);
+    const FWarpTileStore& tiles = geometry->tiles;
+    int32 n = tiles.Num();
+
+    FWarpArena arena;
+    TileIndex index;
+    if (!arena.Reserve(TileIndex::BytesFor(n)) || !index.Init(&arena, n)) {
+        geometry->neighbours.Reset();
+        return;
+    }
+    for (int32 i = 0; i < n; ++i) {
+        index.AddAt(tiles.vec[i], i);
+    }
+
+    LinkNeighbours(geometry, 0, [&index, &tiles](FVector v) {
+        return index.FindNear(v, [&tiles, &v](int32 j) { return sqrMagnitude(v - tiles.vec[j]) < 1e-10; });
+    });
+
+}
+
+//Bound a supertile by its children's bounds, centred on the child centre that gives the smallest bound
+template<typename Distance>
+static void BoundByChildren(const TArray<FWarpSupertile>& nodes, FWarpSupertile* node, Distance distance) {
+    float best = FLT_MAX;
+    node->unbounded = 0;
+    for (int32 a = node->child; a < node->child + node->numChildren; ++a) {
+        const FWarpSupertile& ca = nodes[a];
+        node->unbounded += ca.unbounded;
+        if (ca.unbounded == ca.count) {
+            continue;
+        }
+        float radius = 0.0f;
+        for (int32 b = node->child; b < node->child + node->numChildren; ++b) {
+            const FWarpSupertile& cb = nodes[b];
+            if (cb.unbounded < cb.count) {
+                radius = FMath::Max(radius, (a == b ? 0.0f : distance(cb.centre, ca.centre)) + cb.radius);
+            }
+        }
+        if (radius < best) {
+            best = radius;
+            node->centre = ca.centre;
+            node->radius = radius;
+        }
+    }
+}
+
+//Supertile tree over tiles [first, end), appended to nodes with its root first, order and rank of the range are filled in
+static void BuildSupertileTree(const FWarpTileStore& tiles, int32 dims, int32 first, int32 end,
+    TArray<FWarpSupertile>* nodes, TArray<int32>* order, TArray<int32>* rank) {
+
+    const float k = getK();
+    const int32 LEAF_TILES = 16;
+    const int32 n = end - first;
+    const int32 base = nodes->Num();
+
+    //Morton code of each cell from the lowest corner
+    FIntVector lo = tiles.cell[first];
+    FIntVector hi = tiles.cell[first];
+    for (int32 i = first; i < end; ++i) {
+        const FIntVector& cell = tiles.cell[i];
+        lo = FIntVector(FMath::Min(lo.X, cell.X), FMath::Min(lo.Y, cell.Y), FMath::Min(lo.Z, cell.Z));
+        hi = FIntVector(FMath::Max(hi.X, cell.X), FMath::Max(hi.Y, cell.Y), FMath::Max(hi.Z, cell.Z));
+    }
+    uint32 span = (uint32)FMath::Max3(hi.X - lo.X, hi.Y - lo.Y, hi.Z - lo.Z);
+    int32 levels = FMath::Min((int32)FMath::CeilLogTwo(span + 1), 64 / dims);
+
+    TArray<uint64> codes;
+    codes.SetNumUninitialized(n);
+    for (int32 i = 0; i < n; ++i) {
+        FIntVector c = tiles.cell[first + i] - lo;
+        codes[i] = MortonCode((uint32)c.X, (uint32)c.Y, (uint32)c.Z, dims, levels);
+    }
+    TArrayView<int32> sorted(order->GetData() + first, n);
+    for (int32 i = 0; i < n; ++i) {
+        sorted[i] = first + i;
+    }
+    Algo::StableSortBy(sorted, [&codes, first](int32 i) { return codes[i - first]; });
+    for (int32 i = first; i < end; ++i) {
+        (*rank)[(*order)[i]] = i;
+    }
+    auto code = [&codes, order, first](int32 j) { return codes[(*order)[j] - first]; };
+
+    //Split top down, a level where the whole range falls in one block is skipped
+    //Nodes are appended breadth first, so the children of a node are contiguous and come after it
+    TArray<int32> shifts;
+    FWarpSupertile root;
+    root.first = first;
+    root.count = n;
+    nodes->Add(root);
+    shifts.Add(levels);
+    for (int32 i = base; i < nodes->Num(); ++i) {
+        const int32 begin = (*nodes)[i].first;
+        const int32 stop = begin + (*nodes)[i].count;
+        int32 shift = shifts[i - base];
+        while (shift > 0 && stop - begin > LEAF_TILES &&
+            code(begin) >> ((shift - 1) * dims) == code(stop - 1) >> ((shift - 1) * dims)) {
+            shift--;
+        }
+        if (shift == 0 || stop - begin <= LEAF_TILES) {
+            continue;
+        }
+        (*nodes)[i].child = nodes->Num();
+        int32 block = begin;
+        for (int32 j = begin + 1; j <= stop; ++j) {
+            if (j == stop || code(j) >> ((shift - 1) * dims) != code(block) >> ((shift - 1) * dims)) {
+                FWarpSupertile node;
+                node.first = block;
+                node.count = j - block;
+                nodes->Add(node);
+                shifts.Add(shift - 1);
+                block = j;
+            }
+        }
+        (*nodes)[i].numChildren = nodes->Num() - (*nodes)[i].child;
+    }
+
+    //Bounds bottom up, members at infinity are counted and left out
+    auto distance = [k](const GyroVectorD& a, const GyroVectorD& b) {
+        return (float)FWarpSupertiles::Distance(k, sqrt(sqrMagnitude(sub(a, b).vec)));
+    };
+    for (int32 i = nodes->Num() - 1; i >= base; --i) {
+        FWarpSupertile& node = (*nodes)[i];
+        node.unbounded = 0;
+        if (node.numChildren > 0) {
+            BoundByChildren(*nodes, &node, distance);
+            continue;
+        }
+
+        //Centre on the finite member nearest the mean cell
+        FVector mean = FVector::ZeroVector;
+        for (int32 j = node.first; j < node.first + node.count; ++j) {
+            int32 t = (*order)[j];
+            if (TileIndex::IsFinite(tiles.vec[t])) {
+                mean += FVector(tiles.cell[t]);
+            }
+            else {
+                node.unbounded++;
+            }
+        }
+        if (node.unbounded == node.count) {
+            continue;
+        }
+        mean /= node.count - node.unbounded;
+        float best = FLT_MAX;
+        for (int32 j = node.first; j < node.first + node.count; ++j) {
+            int32 t = (*order)[j];
+            float d = FVector::DistSquared(FVector(tiles.cell[t]), mean);
+            if (TileIndex::IsFinite(tiles.vec[t]) && d < best) {
+                best = d;
+                node.centre = tiles.GV(t);
+            }
+        }
+        for (int32 j = node.first; j < node.first + node.count; ++j) {
+            int32 t = (*order)[j];
+            if (TileIndex::IsFinite(tiles.vec[t])) {
+                node.radius = FMath::Max(node.radius, distance(tiles.GV(t), node.centre));
+            }
+        }
+    }
+
+}
+
+// Merge tiles into supertiles by lattice block, 2 cells per axis per level, with bounds for culling them as one unit
+// Leaf bounds are measured to every member, parents bound their children's bounds, so building is O(n log n)
+void BuildSupertiles(FWarpGeometry* geometry) {
+
+    FScopedCurvature scope(geometry->curvature);
+    const FWarpTileStore& tiles = geometry->tiles;
+    FWarpSupertiles& st = geometry->supertiles;
+    st = FWarpSupertiles();
+    int32 n = tiles.Num();
+    if (n == 0) {
+        return;
+    }
+    st.order.SetNumUninitialized(n);
+    st.rank.SetNumUninitialized(n);
+    BuildSupertileTree(tiles, geometry->lattice3D ? 3 : 2, 0, n, &st.nodes, &st.order, &st.rank);
+
+}
+
+// Add a tree for the tiles from first on under the root of a lazy map's supertiles
+// The root's children are one tree per snapshot, earlier trees are moved up one node but not rebuilt
+static void AppendSupertiles(FWarpGeometry* geometry, int32 first) {
+
+    FScopedCurvature scope(geometry->curvature);
+    const float k = getK();
+    const FWarpTileStore& tiles = geometry->tiles;
+    FWarpSupertiles& st = geometry->supertiles;
+    int32 n = tiles.Num();
+    if (n == first) {
+        return;
+    }
+    st.order.SetNumUninitialized(n);
+    st.rank.SetNumUninitialized(n);
+    TArray<FWarpSupertile> tree;
+    BuildSupertileTree(tiles, geometry->lattice3D ? 3 : 2, first, n, &tree, &st.order, &st.rank);
+
+    //Root, tree roots, then the rest of each tree in the order they were added
+    TArray<FWarpSupertile> nodes;
+    int32 trees = st.nodes.Num() > 0 ? st.nodes[0].numChildren : 0;
+    int32 old = FMath::Max(st.nodes.Num(), 1);
+    nodes.Reserve(old + tree.Num() + 1);
+    nodes.Add(FWarpSupertile());
+    for (int32 i = 1; i <= trees; ++i) {
+        nodes.Add(st.nodes[i]);
+    }
+    nodes.Add(tree[0]);
+    for (int32 i = trees + 1; i < st.nodes.Num(); ++i) {
+        nodes.Add(st.nodes[i]);
+    }
+    for (int32 i = 1; i < tree.Num(); ++i) {
+        nodes.Add(tree[i]);
+    }
+    for (int32 i = 1; i < nodes.Num(); ++i) {
+        FWarpSupertile& node = nodes[i];
+        if (node.numChildren > 0) {
+            node.child += i == trees + 1 || i > old ? old : 1;
+        }
+    }
+
+    FWarpSupertile& root = nodes[0];
+    root.count = n;
+    root.child = 1;
+    root.numChildren = trees + 1;
+    BoundByChildren(nodes, &root, [k](const GyroVectorD& a, const GyroVectorD& b) {
+        return (float)FWarpSupertiles::Distance(k, sqrt(sqrMagnitude(sub(a, b).vec)));
+    });
+    st.nodes = MoveTemp(nodes);
+
+}
+
+// Load tilemap of 2D area or 3D honeycomb with the current curvature and make it active
+void FWarpGameModule::LoadTileMap() {
+
+    TArray<uint8> dataArchive;
+    FFileHelper::LoadFileToArray(dataArchive, *curr_map);
+
+    TSharedRef<FWarpGeometry, ESPMode::ThreadSafe> geometry = MakeShared<FWarpGeometry, ESPMode::ThreadSafe>();
+    geometry->type = curvature.N;
+    geometry->curvature = curvature;
+    geometry->map = curr_map;
+    ParseTileMap(dataArchive, &geometry.Get());
+    BuildNeighbours(&geometry.Get());
+    BuildSupertiles(&geometry.Get());
+    ActivateGeometry(geometry);
+
+}
+
+// Tile containing a level position (in tile units) in the active geometry
+int32 FWarpGameModule::FindTileAt(FVector pos) {
+    return active.IsValid() ? active->FindTileAt(pos) : INDEX_NONE;
+}
+
+const FWarpTileStore* FWarpGameModule::GetTilemap() {
+    return active.IsValid() ? &active->tiles : nullptr;
+}
+
+bool FWarpGameModule::Is3D() {
+    return active.IsValid() && active->lattice3D;
+}
+
+FString FWarpGameModule::MapPath(int type, bool lattice3D) {
+    return MAP_DIR + "/Map" + FString::FromInt(type) + (lattice3D ? "L" : "") + ".bin";
+}
+
+// Generate, save and parse a geometry without touching the active one, safe off the game thread
+FWarpGeometryPtr FWarpGameModule::MakeGeometry(int type, bool lattice3D, int max_expand) {
+
+    FWarpArena arena;
+    TileSet tiles;
+    if (!BuildTileSet(type, lattice3D, max_expand, &arena, &tiles)) {
+        return nullptr;
+    }
+
+    FBufferArchive dataArchive;
+    WriteTileSet(tiles, &dataArchive, bCompressMaps);
+
+    TSharedRef<FWarpGeometry, ESPMode::ThreadSafe> geometry = MakeShared<FWarpGeometry, ESPMode::ThreadSafe>();
+    geometry->type = type;
+    geometry->curvature = FWarpCurvature::ForType(type);
+    geometry->map = MapPath(type, lattice3D);
+    ParseTileMap(dataArchive, &geometry.Get());
+    geometry->lattice3D = lattice3D;
+    BuildNeighbours(&geometry.Get());
+    BuildSupertiles(&geometry.Get());
+    if (bBakeVisibility) {
+        BakeVisibility(&geometry.Get(), &dataArchive);
+    }
+    FFileHelper::SaveArrayToFile(dataArchive, *geometry->map);
+    return geometry;
+
+}
+
+// Build a geometry on the thread pool, FindGeometry returns it once done
+void FWarpGameModule::PreloadGeometry(int type, bool lattice3D, int max_expand) {
+
+    int32 key = GeometryKey(type, lattice3D);
+    {
+        FScopeLock lock(&geometryLock);
+        if (geometries.Contains(key) || pending.Contains(key)) {
+            return;
+        }
+        pending.Add(key);
+    }
+
+    preloads.RemoveAll([](const TFuture<void>& preload) { return preload.IsReady(); });
+    preloads.Add(Async(EAsyncExecution::ThreadPool, [this, type, lattice3D, max_expand, key]() {
+        double start = FPlatformTime::Seconds();
+        FWarpGeometryPtr geometry = MakeGeometry(type, lattice3D, max_expand);
+
+        FScopeLock lock(&geometryLock);
+        pending.Remove(key);
+        if (geometry.IsValid()) {
+            geometries.Add(key, geometry);
+            UE_LOG(LogUnrealMath, Log, TEXT("Geometry {4,%s%d} preloaded, %d tiles, %.1f ms"),
+                lattice3D ? TEXT("3,") : TEXT(""), type, geometry->tiles.Num(), (FPlatformTime::Seconds() - start) * 1000.0);
+        }
+    }));
+
+}
+
+FWarpGeometryPtr FWarpGameModule::FindGeometry(int type, bool lattice3D) {
+    FScopeLock lock(&geometryLock);
+    FWarpGeometryPtr* geometry = geometries.Find(GeometryKey(type, lattice3D));
+    return geometry ? *geometry : nullptr;
+}
+
+// Make a geometry current, game thread only
+// Everything reads curvature and tiles through it, so the switch is seen all at once
+void FWarpGameModule::ActivateGeometry(FWarpGeometryPtr geometry) {
+    if (!geometry.IsValid()) {
+        return;
+    }
+    {
+        FScopeLock lock(&geometryLock);
+        geometries.Add(GeometryKey(geometry->type, geometry->lattice3D), geometry);
+    }
+    if (active != geometry) {
+        pathfinder = MakeShared<FWarpPathfinder, ESPMode::ThreadSafe>(geometry);
+    }
+    active = geometry;
+    curvature = geometry->curvature;
+    curr_map = geometry->map;
+}
+
+//Generate 2D tilemap
+void FWarpGameModule::GenerateTileMap(int type, bool lattice3D, int max_expand) 
+{
+
+    SetTileType(type);
+
+    FWarpArena arena;
+    TileSet tiles;
+    if (!BuildTileSet(type, lattice3D, max_expand, &arena, &tiles)) {
+        return;
+    }
+
+    FFileManagerGeneric fileManager;
+    if (!fileManager.DirectoryExists(*MAP_DIR)) fileManager.MakeDirectory(*MAP_DIR);
+
+    curr_map = MapPath(type, lattice3D);
+
+    FBufferArchive dataArchive;
+    WriteTileSet(tiles, &dataArchive, bCompressMaps);
+    if (bBakeVisibility) {
+        FWarpGeometry geometry;
+        geometry.curvature = curvature;
+        ParseTileMap(dataArchive, &geometry);
+        geometry.lattice3D = lattice3D;
+        BuildNeighbours(&geometry);
+        BakeVisibility(&geometry, &dataArchive);
+    }
+    FFileHelper::SaveArrayToFile(dataArchive, *curr_map);
+
+}
+
+// Offline pass over a parsed map with neighbours, the sets are kept on the geometry and appended to the file data
+void FWarpGameModule::BakeVisibility(FWarpGeometry* geometry, TArray<uint8>* dataArchive) {
+
+    double start = FPlatformTime::Seconds();
+    WarpVisibility::Compute(*geometry, VISIBILITY_BUDGET, &geometry->visibility);
+    WarpVisibility::Append(geometry->visibility, geometry->tiles.Num(), dataArchive);
+
+    int32 n = geometry->tiles.Num();
+    int64 visible = 0;
+    for (uint32 w : geometry->visibility.words) {
+        visible += FPlatformMath::CountBits(w);
+    }
+    UE_LOG(LogUnrealMath, Log, TEXT("Visibility for %d tiles: %.1f visible per tile, %d words, %.1f s"),
+        n, (float)visible / FMath::Max(n, 1), geometry->visibility.words.Num(), FPlatformTime::Seconds() - start);
+
+}
+
+// Upper bound on tiles reached in max_expand - 1 rings
+// Every tile but the origin came in through one face, so it spawns at most faces - 1 new tiles
+// Flat maps are the lattice cells within that many steps, which grow polynomially
+int32 FWarpGameModule::TileCapacity(bool lattice3D, int max_expand) {
+    const FWarpCurvature& c = Curvature();
+    int expected = ExpectedClosedTiles(c.N, lattice3D);
+    if (expected > 0) {
+        return expected;
+    }
+    int rings = c.K > 0.0f ? MAX_CLOSED_RINGS : max_expand - 1;
+    if (c.K == 0.0f) {
+        //Square with 4r cells in ring r, octahedron with 4r^2 + 2
+        int64 r = FMath::Max(rings, 0);
+        int64 flat = lattice3D ? (2 * r + 1) * (2 * r * r + 2 * r + 3) / 3 : 2 * r * r + 2 * r + 1;
+        return (int32)FMath::Min<int64>(flat, GenerationCapacity);
+    }
+    int64 faces = lattice3D ? 6 : 4;
+    int64 total = 1;
+    int64 ring = faces;
+    for (int i = 0; i < rings && total < GenerationCapacity; ++i) {
+        total += ring;
+        ring *= faces - 1;
+    }
+    return (int32)FMath::Min<int64>(total, GenerationCapacity);
+}
+
+// Expand a tile set in one arena, the only allocation is the arena block
+// The tile type only applies to this thread, the active geometry is left alone
+bool FWarpGameModule::BuildTileSet(int type, bool lattice3D, int max_expand, FWarpArena *arena, TileSet *tiles, bool report)
+{
+
+    FScopedCurvature scope(FWarpCurvature::ForType(type));
+    const FWarpCurvature& c = scope.curvature;
+
+    //Records store the path length in one byte
+    max_expand = FMath::Min(max_expand, 255);
+
+    int32 capacity = TileCapacity(lattice3D, max_expand);
+    int32 scratch = bParallelGeneration ? FMath::Min(GENERATION_CHUNK, capacity) * (lattice3D ? 6 : 4) : 0;
+    SIZE_T scratchBytes = scratch > 0 ?
+        FWarpArena::ArrayBytes<GyroVectorD>(scratch) + FWarpArena::ArrayBytes<bool>(scratch) + TileIndex::BytesFor(scratch) : 0;
+    bool symmetric = bSymmetricGeneration && c.K <= 0.0f && c.N != 2;
+    auto symmetryBytes = [&]() { return symmetric ? FWarpSymmetryState::BytesFor(capacity, lattice3D) : 0; };
+    if (GenerationMemoryBudget > 0) {
+        //Shrink the set to the budget, expansion stops when it fills
+        while (capacity > 1 && TileSet::BytesFor(capacity) + scratchBytes + symmetryBytes() > GenerationMemoryBudget) {
+            capacity /= 2;
+        }
+    }
+    if (!arena->Reserve(TileSet::BytesFor(capacity) + scratchBytes + symmetryBytes()) || !tiles->Init(arena, capacity)) {
+        UE_LOG(LogUnrealMath, Error, TEXT("Map %d: could not reserve %d tiles"), type, capacity);
+        return false;
+    }
+    tiles->Push(Tile(-1, 'C', 1, GyroVectorD()));
+
+    //Orbit tables follow the set in the arena, ring scratch goes after them
+    FWarpSymmetryState sym;
+    symmetric = symmetric && sym.Init(arena, capacity, lattice3D);
+
+	//N == 2 is the dihedron: two faces with the cell width at infinity, so it cannot be expanded
+	if (c.N == 2) {
+	   tiles->Push(Tile(0, 'R', 2, GyroVectorD(c.CELL_WIDTH, 0.0, 0.0)));
+	}
+	else {
+	   //Spherical tilings are finite, they expand until a ring adds nothing whatever max_expand is
+	   bool closed = c.K > 0.0f;
+	   double start = FPlatformTime::Seconds();
+	   for (int i = 1; closed ? i <= MAX_CLOSED_RINGS : i < max_expand; ++i) {
+		   //A ring the symmetric pass cannot take is expanded in full, later rings stay that way
+		   int added = symmetric ? ExpandMapSymmetric(tiles, i, lattice3D, &sym) : -1;
+		   if (added < 0 && bParallelGeneration) {
+			   added = ExpandMapParallel(tiles, i, lattice3D);
+		   }
+		   else if (added < 0) {
+			   added = ExpandMap(tiles, i, lattice3D);
+		   }
+		   if (added == 0) {
+			   break;
+		   }
+
+		   //Report cost per depth, honeycombs grow fast
+		   if (report) {
+			   UE_LOG(LogUnrealMath, Log, TEXT("Map %d depth %d: %d cells, %.1f ms, %.1f MB"),
+				   type, i, tiles->Num(), (FPlatformTime::Seconds() - start) * 1000.0, arena->Size() / (1024.0 * 1024.0));
+		   }
+
+		   if (tiles->dropped > 0) {
+			   UE_LOG(LogUnrealMath, Warning, TEXT("Map %d stopped at depth %d, capacity of %d tiles reached"), type, i, tiles->capacity);
+			   break;
+		   }
+	   }
+	}
+
+	//Compare finite tilings with the polyhedron (2D) or polychoron (3D) they tile the sphere as
+	int expected = ExpectedClosedTiles(c.N, lattice3D);
+	if (report && expected > 0 && tiles->Num() != expected) {
+	   UE_LOG(LogUnrealMath, Warning, TEXT("Map %d has %d tiles, the {4,%s%d} tiling has %d"),
+		   type, tiles->Num(), lattice3D ? TEXT("3,") : TEXT(""), c.N, expected);
+	}
+	return true;
+
+}
+
+// Start a map that grows at runtime, expanding initial_rings like GenerateTileMap before it is activated
+// Later rings come from UpdateLazyMap, up to max_rings (spherical maps stop when they close)
+bool FWarpGameModule::StartLazyMap(int type, bool lattice3D, int initial_rings, int max_rings)
+{
+
+    StopLazyMap();
+
+    FScopedCurvature scope(FWarpCurvature::ForType(type));
+    const FWarpCurvature& c = scope.curvature;
+
+    lazy = MakeUnique<FWarpLazyMap>();
+    FWarpLazyMap& m = *lazy;
+    m.type = type;
+    m.lattice3D = lattice3D;
+    m.maxRings = FMath::Min(max_rings, 255);
+    m.building.type = type;
+    m.building.lattice3D = lattice3D;
+    m.building.curvature = c;
+    m.building.map = MapPath(type, lattice3D);
+
+    if (!ReserveLazyTiles(2)) {
+        lazy.Reset();
+        return false;
+    }
+    m.tiles.Push(Tile(-1, 'C', 1, GyroVectorD()));
+    m.cells.Add(FIntVector(0, 0, 0));
+
+    //The dihedron cannot be expanded, same as BuildTileSet
+    if (c.N == 2) {
+        m.tiles.Push(Tile(0, 'R', 2, GyroVectorD(c.CELL_WIDTH, 0.0, 0.0)));
+        m.cells.Add(FIntVector(1, 0, 0));
+        m.done = true;
+    }
+    while (!m.done && m.ring < initial_rings) {
+        ExpandLazySlice(-1.0);
+    }
+
+    SetTileType(type);
+    m.geometry = SnapshotLazyMap();
+    ActivateGeometry(m.geometry);
+    return true;
+
+}
+
+void FWarpGameModule::StopLazyMap()
+{
+    if (lazySlice.IsValid()) {
+        lazySlice.Wait();
+        lazySlice = TFuture<FWarpGeometryPtr>();
+    }
+    lazy.Reset();
+}
+
+bool FWarpGameModule::IsLazyMapComplete()
+{
+    return lazy.IsValid() && !lazySlice.IsValid() && lazy->done;
+}
+
+// Make room for at least needed tiles, moving the set to a larger arena, false if it could not be allocated
+// Capacity doubles up to the ring bound, GenerationMemoryBudget caps it like BuildTileSet and the map stops when it fills
+bool FWarpGameModule::ReserveLazyTiles(int32 needed)
+{
+    FWarpLazyMap& m = *lazy;
+    int32 bound = TileCapacity(m.lattice3D, m.maxRings);
+    int32 capacity = FMath::Min(FMath::Max(needed, m.tiles.capacity * 2), bound);
+    if (needed <= m.tiles.capacity || capacity <= m.tiles.capacity) {
+        return true;
+    }
+    if (GenerationMemoryBudget > 0) {
+        while (capacity > FMath::Max(m.tiles.capacity, 1) && TileSet::BytesFor(capacity) > GenerationMemoryBudget) {
+            capacity = FMath::Max(capacity / 2, m.tiles.capacity);
+        }
+        if (capacity <= m.tiles.capacity) {
+            return true;
+        }
+    }
+
+    //The old arena holds the tiles until they are pushed into the new one
+    TUniquePtr<FWarpArena> arena = MakeUnique<FWarpArena>();
+    const Tile* tiles = m.tiles.tiles;
+    int32 num = m.tiles.Num();
+    if (!arena->Reserve(TileSet::BytesFor(capacity)) || !m.tiles.Init(arena.Get(), capacity)) {
+        UE_LOG(LogUnrealMath, Error, TEXT("Lazy map %d: could not reserve %d tiles"), m.type, capacity);
+        return false;
+    }
+    for (int32 i = 0; i < num; ++i) {
+        m.tiles.Push(tiles[i]);
+    }
+    m.arena = MoveTemp(arena);
+    return true;
+}
+
+// Expand parents of the current ring until the budget (seconds, negative for none) runs out
+// Parents go in the same order as ExpandMap, so the set matches eager generation; true when a ring completes
+bool FWarpGameModule::ExpandLazySlice(double budget)
+{
+    FWarpLazyMap& m = *lazy;
+    FScopedCurvature scope(FWarpCurvature::ForType(m.type));
+    double start = FPlatformTime::Seconds();
+
+    //Every parent but the origin came in through one face
+    int32 faces = m.lattice3D ? 6 : 4;
+    if (!ReserveLazyTiles(m.tiles.Num() + (m.ringEnd - m.cursor) * (m.cursor == 0 ? faces : faces - 1))) {
+        m.done = true;
+        return false;
+    }
+
+    while (m.cursor < m.ringEnd) {
+        ExpandTile(&m.tiles, m.cursor++, m.lattice3D);
+        if (budget >= 0.0 && (m.cursor & 31) == 0 && FPlatformTime::Seconds() - start > budget) {
+            return false;
+        }
+    }
+
+    //Cells of the new ring follow from their parents
+    for (int32 i = m.cells.Num(); i < m.tiles.Num(); ++i) {
+        const Tile& t = m.tiles[i];
+        m.cells.Add(m.cells[t.parent] + MoveCell(t.move));
+    }
+
+    int32 added = m.tiles.Num() - m.ringEnd;
+    bool closed = scope.curvature.K > 0.0f;
+    m.ring++;
+    m.ringEnd = m.tiles.Num();
+    if (added == 0 || m.tiles.dropped > 0 || !(closed ? m.ring <= MAX_CLOSED_RINGS : m.ring < m.maxRings)) {
+        m.done = true;
+    }
+    return true;
+}
+
+// Immutable geometry of the tiles expanded so far, tile indices stay the same as the map grows
+// Tiles added since the last snapshot are sorted in, linked and put under supertiles of their own,
+// of the tiles already there only the outer ring is linked again, it had nothing beyond it before
+FWarpGeometryPtr FWarpGameModule::SnapshotLazyMap()
+{
+    FWarpLazyMap& m = *lazy;
+    FWarpGeometry& geometry = m.building;
+    FWarpTileStore& store = geometry.tiles;
+    FScopedCurvature scope(geometry.curvature);
+
+    int32 first = store.Num();
+    int32 rings = store.NumRings();
+    int32 relink = rings > 0 ? store.ringStart[rings - 1] : 0;
+    int32 n = m.cells.Num();
+    float cw = geometry.curvature.CELL_WIDTH;
+    store.Reserve(n);
+    for (int32 i = first; i < n; ++i) {
+        FIntVector cell = m.cells[i];
+        store.Add(cell, FVector2D(cell.X * cw, cell.Z * cw), m.tiles[i].gv, m.tiles[i].len - 1);
+    }
+    FinalizeTiles(&geometry, first);
+
+    //The set's index finds tiles by position, slots take them to their place in the store
+    auto find = [&m](FVector v) {
+        return m.tiles.index.FindNear(v, [&m, &v](int32 j) { return sqrMagnitude(v - m.tiles[j].gv.vec) < 1e-10; });
+    };
+    m.slots.SetNumUninitialized(n);
+    for (int32 i = first; i < n; ++i) {
+        int32 j = find(store.vec[i]);
+        if (j >= 0) {
+            m.slots[j] = i;
+        }
+    }
+    LinkNeighbours(&geometry, relink, [&m, &find](FVector v) {
+        int32 j = find(v);
+        return j >= 0 ? m.slots[j] : INDEX_NONE;
+    });
+    AppendSupertiles(&geometry, first);
+
+    return MakeShared<FWarpGeometry, ESPMode::ThreadSafe>(geometry);
+}
+
+// Launch the next slice when the player is near the edge, publish a ring once its slice completes it
+FWarpGeometryPtr FWarpGameModule::UpdateLazyMap(int32 playerTile)
+{
+    if (!lazy.IsValid()) {
+        return nullptr;
+    }
+
+    FWarpGeometryPtr grown;
+    if (lazySlice.IsValid()) {
+        if (!lazySlice.IsReady()) {
+            return nullptr;
+        }
+        grown = lazySlice.Get();
+        lazySlice = TFuture<FWarpGeometryPtr>();
+
+        //A switch to another geometry stops the map from being activated, it keeps growing in the background
+        if (grown.IsValid()) {
+            bool current = active == lazy->geometry;
+            lazy->geometry = grown;
+            if (current) {
+                ActivateGeometry(grown);
+            }
+            else {
+                grown.Reset();
+            }
+        }
+    }
+
+    if (lazy->done) {
+        return grown;
+    }
+    const FWarpLazyMap& m = *lazy;
+    const FWarpTileStore* published = m.geometry.IsValid() ? &m.geometry->tiles : nullptr;
+    int32 playerRing = published && published->IsValidIndex(playerTile) ? published->ring[playerTile] + 1 : 1;
+    if (playerRing + LAZY_MARGIN < m.ring) {
+        return grown;
+    }
+
+    //Only this task touches the lazy map until it is collected above
+    double budget = LAZY_SLICE_SECONDS;
+    lazySlice = Async(EAsyncExecution::ThreadPool, [this, budget]() {
+        return ExpandLazySlice(budget) ? SnapshotLazyMap() : FWarpGeometryPtr();
+    });
+    return grown;
+}
+
+// Tile count of a finite spherical tiling, 0 when the tiling is infinite
+int FWarpGameModule::ExpectedClosedTiles(int n, bool lattice3D) {
+    switch (n) {
+        case 2: return 2;                   //Dihedron
+        case 3: return lattice3D ? 8 : 6;   //Tesseract cells, cube faces
+        default: return 0;
+    }
+}
+
+// Shift tiles by direction
+FVector FWarpGameModule::MakeShift(char c) {
+    const float CELL_WIDTH = Curvature().CELL_WIDTH;
+    switch (c) {
+		case 'L': return FVector(-CELL_WIDTH, 0.0, 0.0);
+		case 'R': return FVector(CELL_WIDTH, 0.0, 0.0);
+		case 'F': return FVector(0.0, -CELL_WIDTH, 0.0);
+		case 'B': return FVector(0.0, CELL_WIDTH, 0.0);
+		case 'D': return FVector(0.0, 0.0, -CELL_WIDTH);
+		case 'U': return FVector(0.0, 0.0, CELL_WIDTH);
+		default: return FVector(0, 0, 0);
+    }
+}
+
+// First tile of the ring of path length len, rings are appended in order
+static int32 RingStart(const TileSet& tiles, int len) {
+    int32 i = tiles.Num();
+    while (i > 0 && tiles[i - 1].len == len) {
+        --i;
+    }
+    return i;
+}
+
+// Expand 2D tilemap or 3D honeycomb
+int FWarpGameModule::ExpandMap(TileSet *tiles, int len, bool lattice3D) {
+    int32 before = tiles->Num();
+    for (int32 i = RingStart(*tiles, len); i < before; ++i) {
+        ExpandTile(tiles, i, lattice3D);
+    }
+    return tiles->Num() - before;
+}
+
+// Spawn the children of one tile, every move but the one back to its parent
+void FWarpGameModule::ExpandTile(TileSet *tiles, int32 i, bool lattice3D) {
+    GyroVectorD gv = (*tiles)[i].gv;
+    char last = (*tiles)[i].move;
+    if (last != 'L') {
+        TrySpawn(tiles, i, 'R', add(gv, MakeShift('R')));
+    }
+    if (last != 'R') {
+        TrySpawn(tiles, i, 'L', add(gv, MakeShift('L')));
+    }
+    if (last != 'D') {
+        TrySpawn(tiles, i, 'U', add(gv, MakeShift('U')));
+    }
+    if (last != 'U') {
+        TrySpawn(tiles, i, 'D', add(gv, MakeShift('D')));
+    }
+    if (lattice3D) {
+        if (last != 'F') {
+            TrySpawn(tiles, i, 'B', add(gv, MakeShift('B')));
+        }
+        if (last != 'B') {
+            TrySpawn(tiles, i, 'F', add(gv, MakeShift('F')));
+        }
+    }
+}
+
+// Expand 2D tilemap, one ring across worker threads
+// Workers shift every frontier tile and drop candidates that hit existing tiles,
+// then candidates are merged in frontier and move order so the result matches ExpandMap
+// The frontier goes in chunks so candidate scratch stays inside the arena block
+int FWarpGameModule::ExpandMapParallel(TileSet *tiles, int len, bool lattice3D) {
+    const char moves[] = { 'R', 'L', 'U', 'D', 'B', 'F' };
+    const char backs[] = { 'L', 'R', 'D', 'U', 'F', 'B' };
+    const int numMoves = lattice3D ? 6 : 4;
+
+    FVector shifts[6];
+    for (int m = 0; m < numMoves; ++m) {
+        shifts[m] = MakeShift(moves[m]);
+    }
+
+    int32 before = tiles->Num();
+    int32 first = RingStart(*tiles, len);
+    FWarpArena* arena = tiles->arena;
+    const FWarpCurvature callerCurvature = Curvature();
+
+    for (int32 chunk = first; chunk < before; chunk += GENERATION_CHUNK) {
+        int32 count = FMath::Min(GENERATION_CHUNK, before - chunk);
+
+        SIZE_T mark = arena->Mark();
+        GyroVectorD* candidates = arena->AllocArray<GyroVectorD>(count * numMoves);
+        bool* valid = arena->AllocArray<bool>(count * numMoves);
+        TileIndex pushed;
+        if (!candidates || !valid || !pushed.Init(arena, count * numMoves)) {
+            arena->Rewind(mark);
+            return tiles->Num() - before;
+        }
+
+        const TileSet& existing = *tiles;
+        ParallelFor(count, [&](int32 f) {
+            //Workers follow the curvature of the calling thread, which may be a background load
+            FScopedCurvature scope(callerCurvature);
+            const Tile& tile = existing[chunk + f];
+            char last = tile.move;
+            for (int m = 0; m < numMoves; ++m) {
+                int32 c = f * numMoves + m;
+                valid[c] = false;
+                if (last == backs[m]) {
+                    continue;
+                }
+                candidates[c] = add(tile.gv, shifts[m]);
+                valid[c] = existing.Find(candidates[c]) < 0;
+            }
+        });
+
+        //Deterministic merge, workers already dropped tiles of the set as it was before this chunk,
+        //so only candidates that match each other remain, found in an index over the tiles pushed here
+        const int32 base = tiles->Num();
+        for (int32 f = 0; f < count; ++f) {
+            for (int m = 0; m < numMoves; ++m) {
+                int32 c = f * numMoves + m;
+                if (!valid[c] || pushed.Find(tiles->tiles + base, candidates[c]) >= 0) {
+                    continue;
+                }
+                int32 ix = tiles->Push(Tile(chunk + f, moves[m], existing[chunk + f].len + 1, candidates[c]));
+                if (ix >= 0) {
+                    pushed.Add(tiles->tiles + base, ix - base);
+                }
+            }
+        }
+        arena->Rewind(mark);
+    }
+    return tiles->Num() - before;
+}
+
+// Same tile and the same gyration up to sign, which decides how the tile's moves are oriented
+static bool SameFrame(const GyroVectorD& a, const GyroVectorD& b) {
+    return sqrMagnitude(sub(a, b).vec) < 1e-10 && FMath::Abs(a.gyr.GetNormalized() | b.gyr.GetNormalized()) > 1.0f - 1e-5f;
+}
+
+// Expand one ring from the first tile of each orbit of the symmetry group, every other tile is an image of those
+// A tile's first (parent, move) in frontier and move order is the one ExpandMap spawns it from,
+// so images are keyed by it and appended in key order, which gives exactly the tiles, paths and order of ExpandMap
+// Returns -1 without touching the set when the orbit tables or scratch run out, the caller expands the ring in full
+int FWarpGameModule::ExpandMapSymmetric(TileSet *tiles, int len, bool lattice3D, FWarpSymmetryState *sym) {
+    if (!sym->valid || sym->ring != len) {
+        sym->valid = false;
+        return -1;
+    }
+    const char moves[] = { 'R', 'L', 'U', 'D', 'B', 'F' };
+    const int numMoves = lattice3D ? 6 : 4;
+    const FWarpSymmetry& group = sym->group;
+    const int32 ops = group.num;
+
+    FVector shifts[6];
+    for (int m = 0; m < numMoves; ++m) {
+        shifts[m] = MakeShift(moves[m]);
+    }
+
+    int32 before = tiles->Num();
+    int32 reps = sym->ringEnd - sym->ringBegin;
+    int32 count = reps * numMoves;
+    FWarpArena* arena = tiles->arena;
+    SIZE_T mark = arena->Mark();
+    const FWarpCurvature callerCurvature = Curvature();
+
+    GyroVectorD* candidates = arena->AllocArray<GyroVectorD>(count);
+    uint8* candidateOps = arena->AllocArray<uint8>(count);
+    bool* valid = arena->AllocArray<bool>(count);
+    int32* candidateOrbits = arena->AllocArray<int32>(count);
+    Tile* sector = arena->AllocArray<Tile>(count);
+    TileIndex sectorIndex;
+    if (!candidates || !candidateOps || !valid || !candidateOrbits || !sector || !sectorIndex.Init(arena, count)) {
+        arena->Rewind(mark);
+        sym->valid = false;
+        return -1;
+    }
+
+    //Shift the first tile of each orbit, on workers as in ExpandMapParallel, candidate = op * its fold into the sector
+    const TileSet& existing = *tiles;
+    ParallelFor(reps, [&](int32 r) {
+        FScopedCurvature scope(callerCurvature);
+        const Tile& tile = existing[sym->images[(sym->ringBegin + r) * ops]];
+        for (int m = 0; m < numMoves; ++m) {
+            int32 c = r * numMoves + m;
+            candidates[c] = add(tile.gv, shifts[m]);
+            valid[c] = existing.Find(candidates[c]) < 0;
+            if (valid[c]) {
+                candidateOps[c] = group.inverse[group.ToSector(candidates[c].vec)];
+            }
+        }
+    }, !bParallelGeneration);
+
+    //Each orbit of the new ring meets the sector in one tile, the first candidate to land there starts the orbit
+    //Rounding can put a tile on a mirror either side of it, so a miss is retried through the mirrors that fix it
+    int32 children = 0;
+    for (int32 c = 0; c < count; ++c) {
+        if (!valid[c]) {
+            continue;
+        }
+        GyroVectorD folded = group.Apply(group.inverse[candidateOps[c]], candidates[c]);
+        int32 j = sectorIndex.Find(sector, folded);
+        for (int32 s = 1; j < 0 && s < ops; ++s) {
+            if ((group.Apply(s, folded.vec) - folded.vec).SizeSquared() < 1e-8f) {
+                j = sectorIndex.Find(sector, group.Apply(s, folded));
+                if (j >= 0) {
+                    candidateOps[c] = group.compose[candidateOps[c]][group.inverse[s]];
+                }
+            }
+        }
+        if (j < 0) {
+            new (&sector[children]) Tile(c, 'C', len + 1, folded);
+            sectorIndex.Add(sector, children);
+            j = children++;
+        }
+        candidateOrbits[c] = j;
+    }
+
+    uint8* cosets = arena->AllocArray<uint8>(children * ops);
+    FWarpSymmetryState::FChild* next = arena->AllocArray<FWarpSymmetryState::FChild>(children * ops);
+    if (!cosets || !next || sym->numOrbits + children > sym->orbitCapacity) {
+        arena->Rewind(mark);
+        sym->valid = false;
+        return -1;
+    }
+
+    //Elements that fix a sector tile (it lies on a mirror or axis) give the same tile, each coset is named by its smallest element
+    for (int32 j = 0; j < children; ++j) {
+        const GyroVectorD& gv = sector[j].gv;
+        uint8 fixes[FWarpSymmetry::MAX_OPS];
+        int32 numFixes = 0;
+        for (int32 s = 0; s < ops; ++s) {
+            if (s == 0 || ((group.Apply(s, gv.vec) - gv.vec).SizeSquared() < 1e-8f &&
+                sqrMagnitude(sub(group.Apply(s, gv), gv).vec) < 1e-10)) {
+                fixes[numFixes++] = (uint8)s;
+            }
+        }
+        for (int32 e = 0; e < ops; ++e) {
+            uint8 first = (uint8)e;
+            for (int32 f = 0; f < numFixes; ++f) {
+                first = FMath::Min(first, group.compose[e][fixes[f]]);
+            }
+            cosets[j * ops + e] = first;
+            next[j * ops + e] = { MAX_int64, j, -1, (uint8)e, 0 };
+        }
+    }
+
+    //Every (parent, move) of the ring is a first tile's candidate seen through a parent's frame, keep the smallest per new tile
+    for (int32 c = 0; c < count; ++c) {
+        if (!valid[c]) {
+            continue;
+        }
+        int32 o = sym->ringBegin + c / numMoves;
+        int32 m = c % numMoves;
+        int32 j = candidateOrbits[c];
+        for (int32 g = 0; g < ops; ++g) {
+            uint8 frame = sym->frames[o * ops + g];
+            int64 key = (int64)sym->images[o * ops + g] * 8 + group.moves[frame][m];
+            FWarpSymmetryState::FChild& child = next[j * ops + cosets[j * ops + group.compose[frame][candidateOps[c]]]];
+            if (key < child.key) {
+                child.key = key;
+                child.candidate = c;
+                child.frame = frame;
+            }
+        }
+    }
+
+    int32 numNext = 0;
+    for (int32 i = 0; i < children * ops; ++i) {
+        if (cosets[i] == next[i].op) {
+            next[numNext++] = next[i];
+        }
+    }
+    //Duplicates are told apart by gyration too, so deep 3D rings can hold tiles the symmetry does not carry onto each other
+    //An image no candidate reaches means the ring is not symmetric in those terms and is left to the full expansion
+    for (int32 i = 0; i < numNext; ++i) {
+        if (next[i].key == MAX_int64) {
+            arena->Rewind(mark);
+            sym->valid = false;
+            return -1;
+        }
+    }
+    Algo::SortBy(TArrayView<FWarpSymmetryState::FChild>(next, numNext), &FWarpSymmetryState::FChild::key);
+
+    //Append in ExpandMap order, each tile is its generator's candidate through the generator's frame as ExpandMap computes it
+    int32 orbitBase = sym->numOrbits;
+    for (int32 i = 0; i < children * ops; ++i) {
+        sym->images[orbitBase * ops + i] = -1;
+    }
+    for (int32 i = 0; i < numNext; ++i) {
+        const FWarpSymmetryState::FChild& child = next[i];
+        int32 parent = (int32)(child.key / 8);
+        GyroVectorD gv = group.Apply(child.frame, candidates[child.candidate]);
+        int32 ix = tiles->Push(Tile(parent, moves[child.key % 8], len + 1, gv));
+        if (ix < 0) {
+            continue;
+        }
+        sym->orbit[ix] = orbitBase + child.orbit;
+        sym->element[ix] = child.op;
+        for (int32 e = 0; e < ops; ++e) {
+            if (cosets[child.orbit * ops + e] == child.op) {
+                sym->images[(orbitBase + child.orbit) * ops + e] = ix;
+            }
+        }
+    }
+
+    //A ring cut short by capacity has orbits with missing tiles, and one whose frames do not match cannot be mapped further
+    bool complete = tiles->dropped == 0;
+    for (int32 j = 0; j < children && complete; ++j) {
+        const int32* images = sym->images + (orbitBase + j) * ops;
+        uint8* frames = sym->frames + (orbitBase + j) * ops;
+
+        //Off the mirrors every element gives its own tile, and that tile's frame
+        bool fixed = false;
+        for (int32 e = 0; e < ops; ++e) {
+            frames[e] = (uint8)e;
+            fixed |= cosets[j * ops + e] != e;
+        }
+        if (!fixed) {
+            continue;
+        }
+        const GyroVectorD& first = (*tiles)[images[0]].gv;
+        for (int32 g = 0; g < ops && complete; ++g) {
+            const GyroVectorD& gv = (*tiles)[images[g]].gv;
+            complete = false;
+            for (int32 e = 0; e < ops && !complete; ++e) {
+                if (cosets[j * ops + e] == cosets[j * ops + g] && SameFrame(group.Apply(e, first), gv)) {
+                    frames[g] = (uint8)e;
+                    complete = true;
+                }
+            }
+        }
+    }
+
+    sym->numOrbits += children;
+    sym->ringBegin = orbitBase;
+    sym->ringEnd = sym->numOrbits;
+    sym->ring = len + 1;
+    sym->valid = complete;
+    arena->Rewind(mark);
+    return tiles->Num() - before;
+}
+
+unsigned char FWarpGameModule::NearbyAfterShift(const TileSet& tiles, int ix, char c) {
+    return tiles.Find(add(tiles[ix].gv, MakeShift(c))) >= 0 ? 1 : 0;
+}
@@ -1,98 +1,584 @@
-// Copyright Epic Games, Inc. All Rights Reserved.
-
-#pragma once
-
-#include "CoreMinimal.h"
-#include "Misc/CoreMisc.h"
-#include "Misc/FileHelper.h"
-#include "HAL/FileManagerGeneric.h"
-#include "Modules/ModuleInterface.h"
-#include "Modules/ModuleManager.h"
-#include "Serialization/BufferArchive.h"
-
-using namespace std;
-
-struct Tile;
-struct WorldTile;
-
-class WARP_API FWarpGameModule : public IModuleInterface
-{
-
-    const FString MAP_DIR = FPaths::ProjectContentDir() + TEXT("Levels/");
-    FString curr_map = "";
-    TArray<WorldTile> curr_tilemap;
-
-    int N = 1;
-    float K = 1.0f;
-    float KLEIN_V = 1.0f;
-    float CELL_WIDTH = 1.0f;
-    
-
-public:
-	virtual void StartupModule() override;
-
-	void GenerateTileMap(int type, bool lattice3D, int max_expand);
-    FVector MakeShift(char c);
-    void ExpandMap(vector<Tile> *tiles, int len, bool lattice3D);
-    unsigned char NearbyAfterShift(vector<Tile> tiles, int ix, char c);
-    void LoadTileMap();
-
-    int GetN() { return N; }
-    float GetK() { return K; }
-    float GetKlein() { return KLEIN_V; }
-    float GetCellW() { return CELL_WIDTH; }
-    FString GetCurrMap() { return curr_map; }
-    TArray<WorldTile>* GetTilemap() { return &curr_tilemap; };
-
-    void SetN(int v) { N = v; }
-    void SetK(float v) { K = v; }
-    void SetKlein(float v) { KLEIN_V = v; }
-    void SetCellW(float v) { CELL_WIDTH = v; }
-    
-	//Set tile type and parameters by geometry type
-    void SetTileTypeW(float n) {
-
-        N = (int)n;
-        float a = PI / 4;
-        float b = PI / N;
-        float r = cos(b) / sin(a);
-		
-        if (n == 4.0f) {
-            K = 0.0f;
-            KLEIN_V = 1.0f;
-            CELL_WIDTH = 2.0;
-        }
-        else {
-            K = (n < 4.0f ? 1.0f : -1.0f);
-            a = PI / 4;
-            b = PI / n;
-            r = cos(b) / sin(a);
-            CELL_WIDTH = sqrt(abs(r * r - 1.0)) / r;
-            KLEIN_V = (float)(CELL_WIDTH + (3e-4 / n));
-        }
-    }
-
-};
-
-#include "WarpMath.h"
-
-using namespace WarpMath;
-
-//NQ tiles
-struct Tile {
-    Tile(string _coord, GyroVectorD _gv) {
-        coord = _coord; gv = _gv;
-    };
-    GyroVectorD gv;
-    string coord;
-};
-
-struct WorldTile {
-    WorldTile(FVector2D _xz, GyroVectorD _gv) {
-        xz = _xz; gv = _gv;
-    };
-    GyroVectorD gv;
-    FVector2D xz;
-};
-
-
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Misc/CoreMisc.h"
+#include "Misc/FileHelper.h"
+#include "HAL/FileManagerGeneric.h"
+#include "Modules/ModuleInterface.h"
+#include "Modules/ModuleManager.h"
+#include "Serialization/BufferArchive.h"
+#include "WarpArena.h"
+#include "Async/Future.h"
+#include "Templates/Atomic.h"
+#include <limits>
+
+using namespace std;
+
+struct Tile;
+struct WorldTile;
+struct FWarpTileStore;
+struct TileIndex;
+struct TileSet;
+struct FWarpSymmetryState;
+struct FWarpGeometry;
+struct FWarpLazyMap;
+class FWarpPathfinder;
+
+//Immutable once loaded, shared between the module, components and background loads
+typedef TSharedPtr<const FWarpGeometry, ESPMode::ThreadSafe> FWarpGeometryPtr;
+typedef TSharedPtr<FWarpPathfinder, ESPMode::ThreadSafe> FWarpPathfinderPtr;
+
+//Curvature and cell parameters of one tile type
+struct FWarpCurvature {
+    int N = 1;
+    float K = 1.0f;
+    float KLEIN_V = 1.0f;
+    float CELL_WIDTH = 1.0f;
+
+	//Parameters by geometry type
+	//The face distance of the {4,N} square tiling equals that of the {4,3,N} cube honeycomb
+	//(both come from a dihedral angle of 2pi/N), so 3D maps use the same cell width
+    static FWarpCurvature ForType(float n) {
+
+        FWarpCurvature c;
+        c.N = (int)n;
+		
+        if (n == 4.0f) {
+            c.K = 0.0f;
+            c.KLEIN_V = 1.0f;
+            c.CELL_WIDTH = 2.0;
+        }
+        else {
+            c.K = (n < 4.0f ? 1.0f : -1.0f);
+            float a = PI / 4;
+            float b = PI / n;
+            float r = cos(b) / sin(a);
+            c.CELL_WIDTH = sqrt(abs(r * r - 1.0)) / r;
+            c.KLEIN_V = (float)(c.CELL_WIDTH + (3e-4 / n));
+        }
+        return c;
+    }
+};
+
+//Curvature override of the calling thread, set by FScopedCurvature
+inline const FWarpCurvature*& ScopedCurvatureSlot() {
+    static thread_local const FWarpCurvature* slot = nullptr;
+    return slot;
+}
+
+class WARP_API FWarpGameModule : public IModuleInterface
+{
+
+    const FString MAP_DIR = FPaths::ProjectContentDir() + TEXT("Levels/");
+    FString curr_map = "";
+    FWarpCurvature curvature;
+    FWarpGeometryPtr active;
+    FWarpPathfinderPtr pathfinder;
+
+    //Loaded geometries by GeometryKey, background loads add to it under geometryLock
+    TMap<int32, FWarpGeometryPtr> geometries;
+    TSet<int32> pending;
+    FCriticalSection geometryLock;
+
+    //Background loads still running, ShutdownModule waits for them before the module goes away
+    TArray<TFuture<void>> preloads;
+
+    //Map grown at runtime and the ring slice running for it, if any
+    TUniquePtr<FWarpLazyMap> lazy;
+    TFuture<FWarpGeometryPtr> lazySlice;
+
+    bool ReserveLazyTiles(int32 needed);
+    bool ExpandLazySlice(double budget);
+    FWarpGeometryPtr SnapshotLazyMap();
+    
+
+public:
+	virtual void StartupModule() override;
+	virtual void ShutdownModule() override;
+
+	void GenerateTileMap(int type, bool lattice3D, int max_expand);
+    FVector MakeShift(char c);
+    int ExpectedClosedTiles(int n, bool lattice3D);
+    int32 TileCapacity(bool lattice3D, int max_expand);
+    bool BuildTileSet(int type, bool lattice3D, int max_expand, FWarpArena *arena, TileSet *tiles, bool report = true);
+    int ExpandMap(TileSet *tiles, int len, bool lattice3D);
+    void ExpandTile(TileSet *tiles, int32 ix, bool lattice3D);
+    int ExpandMapParallel(TileSet *tiles, int len, bool lattice3D);
+    int ExpandMapSymmetric(TileSet *tiles, int len, bool lattice3D, FWarpSymmetryState *sym);
+    unsigned char NearbyAfterShift(const TileSet& tiles, int ix, char c);
+    void LoadTileMap();
+    int32 FindTileAt(FVector pos);
+
+    //Several geometries can be held at once, only the active one drives getK() and the tile map
+    static int32 GeometryKey(int type, bool lattice3D) { return type * 2 + (lattice3D ? 1 : 0); }
+    FString MapPath(int type, bool lattice3D);
+    FWarpGeometryPtr MakeGeometry(int type, bool lattice3D, int max_expand);
+    void PreloadGeometry(int type, bool lattice3D, int max_expand);
+    FWarpGeometryPtr FindGeometry(int type, bool lattice3D);
+    void ActivateGeometry(FWarpGeometryPtr geometry);
+    FWarpGeometryPtr GetGeometry() { return active; }
+
+    //Paths over the active geometry's tiles (WarpPathfinding.h), replaced with its caches when the geometry changes
+    //Queries already running keep the pathfinder and geometry they started with
+    FWarpPathfinderPtr GetPathfinder() { return pathfinder; }
+
+    //Lazy generation, rings are expanded on the thread pool as the player nears the edge of the map
+    //Each frame runs at most one slice of LAZY_SLICE_SECONDS, the tiles match eager generation ring for ring
+    bool StartLazyMap(int type, bool lattice3D, int initial_rings, int max_rings);
+    void StopLazyMap();
+    bool IsLazyMap() { return lazy.IsValid(); }
+    bool IsLazyMapComplete();
+
+    //Call every frame with the player's tile, returns the grown geometry once a ring completes (already active)
+    FWarpGeometryPtr UpdateLazyMap(int32 playerTile);
+
+    float LAZY_SLICE_SECONDS = 0.002f;
+
+    //Grow when the player is this many rings from the edge
+    int32 LAZY_MARGIN = 2;
+
+    //Expand rings across worker threads, output is identical to ExpandMap
+    bool bParallelGeneration = true;
+
+    //Expand one tile per orbit of the origin tile's symmetries and copy the rest (WarpSymmetry.h), output is identical to ExpandMap
+    //Hyperbolic and flat maps only, spherical ones are small and hold the antipode
+    bool bSymmetricGeneration = false;
+
+    //Safety cap on rings for finite (spherical) tilings
+    const int MAX_CLOSED_RINGS = 64;
+
+    //Cap the arena for generation state at this many bytes, 0 for no limit
+    SIZE_T GenerationMemoryBudget = 0;
+
+    //Hard cap on tiles per map, the arena is sized from the ring bound below this
+    int32 GenerationCapacity = 1 << 22;
+
+    //Frontier tiles handled per parallel pass, bounds the candidate scratch
+    const int32 GENERATION_CHUNK = 16384;
+
+    //Write maps in the compressed format (WarpMapFormat.h), loading detects either format
+    bool bCompressMaps = false;
+
+    //Bake potentially visible sets into generated maps (WarpVisibility.h)
+    //Portal sequences one tile may open before its set falls back to every tile connected to it
+    bool bBakeVisibility = false;
+    int32 VISIBILITY_BUDGET = 1 << 16;
+
+    //Compute visibility for a parsed geometry and append it to its map data
+    void BakeVisibility(FWarpGeometry* geometry, TArray<uint8>* dataArchive);
+
+    //Active curvature, or the one a background load set for this thread
+    const FWarpCurvature& Curvature() const {
+        const FWarpCurvature* scoped = ScopedCurvatureSlot();
+        return scoped ? *scoped : curvature;
+    }
+
+    int GetN() { return Curvature().N; }
+    float GetK() { return Curvature().K; }
+    float GetKlein() { return Curvature().KLEIN_V; }
+    float GetCellW() { return Curvature().CELL_WIDTH; }
+    FString GetCurrMap() { return curr_map; }
+    //Tiles of the active geometry, nothing is copied and the pointer stays valid while it is active
+    const FWarpTileStore* GetTilemap();
+    bool Is3D();
+
+    void SetN(int v) { curvature.N = v; }
+    void SetK(float v) { curvature.K = v; }
+    void SetKlein(float v) { curvature.KLEIN_V = v; }
+    void SetCellW(float v) { curvature.CELL_WIDTH = v; }
+    
+	//Set tile type and parameters by geometry type
+    void SetTileTypeW(float n) {
+        curvature = FWarpCurvature::ForType(n);
+    }
+
+};
+
+//Curvature seen by getK() and the generator on this thread while in scope
+//Background loads use it so they never touch the active geometry
+struct FScopedCurvature {
+    FScopedCurvature(const FWarpCurvature& _curvature) : curvature(_curvature), previous(ScopedCurvatureSlot()) {
+        ScopedCurvatureSlot() = &curvature;
+    }
+    ~FScopedCurvature() {
+        ScopedCurvatureSlot() = previous;
+    }
+    FScopedCurvature(const FScopedCurvature&) = delete;
+    FScopedCurvature& operator=(const FScopedCurvature&) = delete;
+
+    FWarpCurvature curvature;
+    const FWarpCurvature* previous;
+};
+
+#include "WarpMath.h"
+
+using namespace WarpMath;
+
+//NQ tiles
+//The coordinate path is kept as the parent tile and the last move, BuildCoord rebuilds it
+struct Tile {
+    Tile(int32 _parent, char _move, int32 _len, GyroVectorD _gv) {
+        parent = _parent; move = _move; len = _len; gv = _gv;
+    };
+    GyroVectorD gv;
+    int32 parent;   //-1 for the origin tile
+    int32 len;      //Length of the coordinate path, 1 for the origin tile
+    char move;      //Last move of the path, 'C' for the origin tile
+};
+
+//Spatial hash over tile positions for duplicate checks
+//Duplicates lie within 1e-5 of each other, well below the cell size, so a lookup only visits neighbouring cells
+//Open addressing over arena memory, the table holds at least twice as many slots as tiles so it never grows
+struct TileIndex {
+    const float CELL = 1e-4f;
+    FIntVector* keys = nullptr;
+    int32* heads = nullptr;     //First tile in the cell, -1 for an empty slot
+    int32* next = nullptr;      //Next tile in the same cell
+    uint32 mask = 0;
+
+    //On a sphere the tile opposite the origin sits at infinity, every path to it gives inf or NaN
+    int32 antipode = -1;
+
+    static uint32 SlotsFor(int32 capacity) {
+        return FMath::RoundUpToPowerOfTwo(FMath::Max(2 * capacity, 16));
+    }
+
+    static SIZE_T BytesFor(int32 capacity) {
+        uint32 slots = SlotsFor(capacity);
+        return FWarpArena::ArrayBytes<FIntVector>(slots) + FWarpArena::ArrayBytes<int32>(slots) + FWarpArena::ArrayBytes<int32>(capacity);
+    }
+
+    bool Init(FWarpArena* arena, int32 capacity) {
+        uint32 slots = SlotsFor(capacity);
+        keys = arena->AllocArray<FIntVector>(slots);
+        heads = arena->AllocArray<int32>(slots);
+        next = arena->AllocArray<int32>(capacity);
+        if (!keys || !heads || !next) {
+            return false;
+        }
+        FMemory::Memset(heads, 0xFF, slots * sizeof(int32));
+        mask = slots - 1;
+        antipode = -1;
+        return true;
+    }
+
+    static bool IsFinite(FVector v) {
+        return FMath::IsFinite(v.X) && FMath::IsFinite(v.Y) && FMath::IsFinite(v.Z);
+    }
+
+    //Map files mark the antipode rather than store its inf or NaN, it is read back as this position
+    static FVector AtInfinity() {
+        return FVector(numeric_limits<float>::infinity());
+    }
+
+    FIntVector Cell(FVector v) const {
+        return FIntVector(FMath::FloorToInt(v.X / CELL), FMath::FloorToInt(v.Y / CELL), FMath::FloorToInt(v.Z / CELL));
+    }
+
+    //Slot of a cell, or the empty slot where it would go
+    uint32 Slot(FIntVector c) const {
+        uint32 h = (uint32)c.X * 73856093u ^ (uint32)c.Y * 19349663u ^ (uint32)c.Z * 83492791u;
+        uint32 s = (h * 2654435769u) & mask;
+        while (heads[s] >= 0 && keys[s] != c) {
+            s = (s + 1) & mask;
+        }
+        return s;
+    }
+
+    void Add(const Tile* tiles, int32 ix) { AddAt(tiles[ix].gv.vec, ix); }
+
+    //Index of the tile at gv, or -1
+    int32 Find(const Tile* tiles, GyroVectorD gv) const {
+        return FindNear(gv.vec, [tiles, &gv](int32 i) { return sqrMagnitude(sub(gv, tiles[i].gv).vec) < 1e-10; });
+    }
+
+    //Index ix at position v, for stores other than Tile arrays
+    void AddAt(FVector v, int32 ix);
+
+    //First index in the cells around v that same accepts, or -1, the antipode for any non-finite v
+    template<typename Same>
+    int32 FindNear(FVector v, Same same) const;
+};
+
+//Fixed capacity tile store for generation, tiles and index live in one arena
+struct TileSet {
+    Tile* tiles = nullptr;
+    int32 num = 0;
+    int32 capacity = 0;
+    int32 dropped = 0;      //Pushes refused because the set was full
+    TileIndex index;
+    FWarpArena* arena = nullptr;    //Also holds per-ring scratch past the set
+
+    //Arena bytes for a set of capacity tiles
+    static SIZE_T BytesFor(int32 capacity) {
+        return FWarpArena::ArrayBytes<Tile>(capacity) + TileIndex::BytesFor(capacity);
+    }
+
+    bool Init(FWarpArena* _arena, int32 _capacity) {
+        arena = _arena;
+        tiles = arena->AllocArray<Tile>(_capacity);
+        num = 0;
+        dropped = 0;
+        capacity = tiles && index.Init(arena, _capacity) ? _capacity : 0;
+        return capacity > 0;
+    }
+
+    int32 Num() const { return num; }
+    bool IsFull() const { return num >= capacity; }
+    const Tile& operator[](int32 i) const { return tiles[i]; }
+
+    //Index of the new tile, or -1 when the set is full
+    int32 Push(const Tile& tile) {
+        if (IsFull()) {
+            dropped++;
+            return -1;
+        }
+        new (&tiles[num]) Tile(tile);
+        index.Add(tiles, num);
+        return num++;
+    }
+
+    int32 Find(GyroVectorD gv) const { return index.Find(tiles, gv); }
+
+    TArrayView<const Tile> View() const { return TArrayView<const Tile>(tiles, num); }
+};
+
+inline void TileIndex::AddAt(FVector v, int32 ix) {
+    next[ix] = -1;
+    if (!IsFinite(v)) {
+        antipode = ix;
+        return;
+    }
+    FIntVector c = Cell(v);
+    uint32 s = Slot(c);
+    keys[s] = c;
+    next[ix] = heads[s];
+    heads[s] = ix;
+}
+
+template<typename Same>
+inline int32 TileIndex::FindNear(FVector v, Same same) const {
+    if (!IsFinite(v)) {
+        return antipode;
+    }
+    FIntVector c = Cell(v);
+    for (int32 dx = -1; dx <= 1; ++dx) {
+        for (int32 dy = -1; dy <= 1; ++dy) {
+            for (int32 dz = -1; dz <= 1; ++dz) {
+                for (int32 i = heads[Slot(c + FIntVector(dx, dy, dz))]; i >= 0; i = next[i]) {
+                    if (same(i)) {
+                        return i;
+                    }
+                }
+            }
+        }
+    }
+    return -1;
+}
+
+struct WorldTile {
+    WorldTile(FIntVector _cell, FVector2D _xz, GyroVectorD _gv) {
+        cell = _cell; xz = _xz; gv = _gv;
+    };
+    GyroVectorD gv;
+    FVector2D xz;
+    FIntVector cell;    //Lattice cell in the level, Y is only used by 3D maps
+};
+
+//Tile map as separate arrays, so a scan over one field streams only that field
+//Tiles are sorted by ring (moves from the origin tile), then in Morton order of their cells within a ring,
+//so the tiles within r rings are always the first WithinRings(r) and neighbours are mostly near in memory
+struct FWarpTileStore {
+    template<typename T>
+    using TAlignedArray = TArray<T, TAlignedHeapAllocator<64>>;
+
+    //Bumped whenever the order changes, tile indices baked with another layout are stale
+    static const int32 LAYOUT = 1;
+
+    TAlignedArray<FVector> vec;
+    TAlignedArray<FQuat> gyr;
+    TAlignedArray<FVector2D> xz;
+    TAlignedArray<FIntVector> cell;
+    TAlignedArray<int32> ring;
+    TArray<int32> ringStart;    //First tile of each ring, with the tile count after the last ring
+    TArray<float> ringInner;    //Smallest |vec| in each ring, for scans that only reach so far from the origin
+
+    int32 Num() const { return vec.Num(); }
+    bool IsValidIndex(int32 i) const { return vec.IsValidIndex(i); }
+
+    void Reserve(int32 n) {
+        vec.Reserve(n);
+        gyr.Reserve(n);
+        xz.Reserve(n);
+        cell.Reserve(n);
+        ring.Reserve(n);
+    }
+
+    //Appended in any order, FinalizeTiles sorts them
+    int32 Add(FIntVector _cell, FVector2D _xz, const GyroVectorD& gv, int32 _ring) {
+        gyr.Add(gv.gyr);
+        xz.Add(_xz);
+        cell.Add(_cell);
+        ring.Add(_ring);
+        return vec.Add(gv.vec);
+    }
+
+    //Members are set directly, so an unnormalized identity gyration stays as it is
+    GyroVectorD GV(int32 i) const {
+        GyroVectorD gv;
+        gv.vec = vec[i];
+        gv.gyr = gyr[i];
+        return gv;
+    }
+
+    WorldTile operator[](int32 i) const { return WorldTile(cell[i], xz[i], GV(i)); }
+
+    //CRC of the tile cells and gyrovectors, bakes made against another map compare unequal
+    uint32 Hash() const {
+        uint32 crc = FCrc::MemCrc32(cell.GetData(), cell.Num() * sizeof(FIntVector));
+        crc = FCrc::MemCrc32(vec.GetData(), vec.Num() * sizeof(FVector), crc);
+        return FCrc::MemCrc32(gyr.GetData(), gyr.Num() * sizeof(FQuat), crc);
+    }
+
+    int32 NumRings() const { return FMath::Max(ringStart.Num() - 1, 0); }
+
+    //Tiles [0, WithinRings(r)) are at most r moves from the origin tile
+    int32 WithinRings(int32 r) const {
+        return ringStart.Num() > 0 ? ringStart[FMath::Clamp(r + 1, 0, ringStart.Num() - 1)] : 0;
+    }
+
+    //Tiles [0, WithinRadius(r)) hold every tile with |vec| <= r, rings are not quite ordered by distance so all are checked
+    int32 WithinRadius(float radius) const {
+        for (int32 r = ringInner.Num() - 1; r >= 0; --r) {
+            if (ringInner[r] <= radius) {
+                return WithinRings(r);
+            }
+        }
+        return 0;
+    }
+};
+
+//Tiles potentially visible from each tile, baked offline into the map file
+//Each row is a bitset over the range of words its visible tiles span
+struct FWarpVisibility {
+    TArray<int32> first;
+    TArray<int32> offset;
+    TArray<uint32> words;
+
+    bool IsValid() const { return offset.Num() > 1; }
+
+    bool Visible(int32 from, int32 to) const {
+        int32 w = (to >> 5) - first[from];
+        if (w < 0 || w >= offset[from + 1] - offset[from]) {
+            return false;
+        }
+        return (words[offset[from] + w] >> (to & 31)) & 1;
+    }
+};
+
+//Group of tiles in neighbouring lattice cells, children are contiguous in the node array and none means a leaf
+//Every member tile is within radius (hyperbolic distance) of the centre tile
+//Members at infinity are left out of the bound and counted in unbounded
+struct FWarpSupertile {
+    GyroVectorD centre;
+    float radius = 0.0f;
+    int32 unbounded = 0;
+    int32 first = 0;
+    int32 count = 0;
+    int32 child = 0;
+    int32 numChildren = 0;
+};
+
+//Supertile hierarchy over the tile map, merged a block of 2 cells per axis at a time up to one root
+//Tiles are sorted in Morton order of their cells, so each supertile covers one range of order
+struct FWarpSupertiles {
+    TArray<FWarpSupertile> nodes;
+    TArray<int32> order;
+    TArray<int32> rank;
+
+    bool IsValid() const { return nodes.Num() > 0; }
+
+    //Hyperbolic distance of a Poincare ball point at magnitude r from the centre, 2 * atanh(r) for k = -1
+    static double Distance(float k, double r) {
+        if (k < 0.0f) {
+            double s = sqrt(-k);
+            return 2.0 * atanh(FMath::Min(r * s, 1.0 - 1e-15)) / s;
+        }
+        return k > 0.0f ? 2.0 * atan(r * sqrt(k)) / sqrt(k) : 2.0 * r;
+    }
+
+    //Magnitude of a Poincare ball point at distance d from the centre, the inverse of Distance
+    static double Radius(float k, double d) {
+        if (k < 0.0f) {
+            double s = sqrt(-k);
+            return tanh(0.5 * d * s) / s;
+        }
+        return k > 0.0f ? tan(FMath::Min(0.5 * d * sqrt(k), 0.5 * PI - 1e-6)) / sqrt(k) : 0.5 * d;
+    }
+};
+
+//Tile map with the curvature it was built for, never changed after loading
+struct FWarpGeometry {
+    int32 type = 1;
+    bool lattice3D = false;
+    FWarpCurvature curvature;
+    FString map;
+    FWarpTileStore tiles;
+    TMap<FIntVector, int32> cell_tiles;
+
+    //Neighbour across each face in move order R, L, U, D, B, F, -1 where the tiling has no tile (a wall)
+    static const int32 FACES = 6;
+    TArray<int32> neighbours;
+
+    int32 Neighbour(int32 tile, int32 face) const {
+        return neighbours.Num() > 0 ? neighbours[tile * FACES + face] : INDEX_NONE;
+    }
+
+    FWarpVisibility visibility;
+    FWarpSupertiles supertiles;
+
+    //Lattice cell of a level position (in tile units), 2D maps ignore the height
+    FIntVector CellAt(FVector pos) const {
+        return FIntVector(
+            FMath::FloorToInt(pos.X / curvature.CELL_WIDTH),
+            lattice3D ? FMath::FloorToInt(pos.Y / curvature.CELL_WIDTH) : 0,
+            FMath::FloorToInt(pos.Z / curvature.CELL_WIDTH));
+    }
+
+    //Tile containing a level position (in tile units)
+    int32 FindTileAt(FVector pos) const {
+        const int32* ix = cell_tiles.Find(CellAt(pos));
+        return ix ? *ix : INDEX_NONE;
+    }
+};
+
+//Tile map files, raw records or WarpMapFormat
+void WriteTileSet(const TileSet& tiles, TArray<uint8>* dataArchive, bool compressed);
+void ParseTileMap(const TArray<uint8>& dataArchive, FWarpGeometry* geometry);
+void FinalizeTiles(FWarpGeometry* geometry, int32 first = 0);
+//Lattice step of one move, none for the origin tile's C
+FIntVector MoveCell(char c);
+void BuildNeighbours(FWarpGeometry* geometry);
+void BuildSupertiles(FWarpGeometry* geometry);
+
+//Tile set grown one ring at a time, see FWarpGameModule::StartLazyMap
+//Parents of the ring being expanded run from cursor to ringEnd, their children are appended after
+//The set starts small and moves to a larger arena when the next ring may not fit, see ReserveLazyTiles
+//Snapshots append the new rings to building and publish a copy, earlier rings keep their neighbours and supertiles
+struct FWarpLazyMap {
+    int type = 1;
+    bool lattice3D = false;
+    int maxRings = 0;
+    TUniquePtr<FWarpArena> arena;
+    TileSet tiles;
+    TArray<FIntVector> cells;
+    int32 ring = 1;
+    int32 ringEnd = 1;
+    int32 cursor = 0;
+    TAtomic<bool> done { false };   //Written by slice tasks
+    FWarpGeometry building;
+    TArray<int32> slots;        //Index in building of each tile of the set
+    FWarpGeometryPtr geometry;  //Last published
+};
@@ -0,0 +1,200 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "WarpAgentManager.h"
+#include "WarpHyperComponent.h"
+#include "Async/ParallelFor.h"
+#include "Kismet/GameplayStatics.h"
+#include "Math/RandomStream.h"
+
+AWarpAgentManager::AWarpAgentManager()
+{
+
+	PrimaryActorTick.bCanEverTick = true;
+
+}
+
+AWarpAgentManager* AWarpAgentManager::Get(UWorld* World)
+{
+	TArray<AActor*> found;
+	UGameplayStatics::GetAllActorsOfClass(World, AWarpAgentManager::StaticClass(), found);
+	if (found.Num() > 0) {
+		return Cast<AWarpAgentManager>(found[0]);
+	}
+	return World->SpawnActor<AWarpAgentManager>();
+}
+
+void AWarpAgentManager::BeginPlay()
+{
+	Super::BeginPlay();
+
+	//Compose after the player has moved this frame
+	TArray<AActor*> found;
+	UGameplayStatics::GetAllActorsOfClass(GetWorld(), AWarpHyperComponent::StaticClass(), found);
+	if (found.Num() > 0) {
+		hyper = Cast<AWarpHyperComponent>(found[0]);
+		AddTickPrerequisiteActor(hyper);
+	}
+}
+
+int32 AWarpAgentManager::Spawn(GyroVectorD gv, float heading, float speed, uint32 seed)
+{
+	int32 ix = agentVec.Add(gv.vec);
+	agentGyr.Add(gv.gyr);
+	agentVelocity.Add(FVector(0, 0, 0));
+	agentHeading.Add(heading);
+	agentSpeed.Add(speed);
+	//Xorshift never leaves zero
+	agentSeed.Add(seed != 0 ? seed : 0x9E3779B9u);
+	agentRows.AddZeroed(4);
+	return ix;
+}
+
+void AWarpAgentManager::SpawnCrowd(int32 count, int32 seed)
+{
+	const FWarpTileStore* tiles = GetWarpModule()->GetTilemap();
+	if (!tiles || tiles->Num() == 0) {
+		return;
+	}
+
+	FRandomStream random(seed);
+	int32 start = Num();
+	agentVec.Reserve(start + count);
+	agentGyr.Reserve(start + count);
+	agentVelocity.Reserve(start + count);
+	agentHeading.Reserve(start + count);
+	agentSpeed.Reserve(start + count);
+	agentSeed.Reserve(start + count);
+	agentRows.Reserve((start + count) * 4);
+
+	for (int32 i = 0; i < count; i++) {
+		GyroVectorD gv = tiles->GV(random.RandHelper(tiles->Num()));
+		if (!TileIndex::IsFinite(gv.vec)) {
+			continue;
+		}
+		float heading = random.FRandRange(-PI, PI);
+		float speed = WalkSpeed * random.FRandRange(0.5f, 1.0f);
+		Spawn(gv, heading, speed, random.GetUnsignedInt());
+	}
+}
+
+void AWarpAgentManager::Kill(int32 ix)
+{
+	if (!agentVec.IsValidIndex(ix)) {
+		return;
+	}
+	int32 last = agentVec.Num() - 1;
+	agentVec.RemoveAtSwap(ix, 1, false);
+	agentGyr.RemoveAtSwap(ix, 1, false);
+	agentVelocity.RemoveAtSwap(ix, 1, false);
+	agentHeading.RemoveAtSwap(ix, 1, false);
+	agentSpeed.RemoveAtSwap(ix, 1, false);
+	agentSeed.RemoveAtSwap(ix, 1, false);
+
+	//Rows move four at a time
+	if (ix != last) {
+		FMemory::Memcpy(&agentRows[ix * 4], &agentRows[last * 4], 4 * sizeof(FVector4));
+	}
+	agentRows.SetNum(last * 4, false);
+}
+
+void AWarpAgentManager::Empty()
+{
+	agentVec.Reset();
+	agentGyr.Reset();
+	agentVelocity.Reset();
+	agentHeading.Reset();
+	agentSpeed.Reset();
+	agentSeed.Reset();
+	agentRows.Reset();
+}
+
+// Wander every agent and move it along its velocity
+// Like projectiles each step is a Mobius add in the agent frame, moves in the tile plane keep agents on it
+void AWarpAgentManager::Step(float DeltaTime)
+{
+	const int32 n = agentVec.Num();
+	if (n == 0) {
+		return;
+	}
+
+	const float k = getK();
+	const int32 batch = std::max(BatchSize, 1);
+	const int32 batches = (n + batch - 1) / batch;
+	const float smooth = pow(2.0f, -DeltaTime / std::max(Smoothing, 1e-4f));
+	const float turn = TurnRate * DeltaTime;
+	const float radiusSq = WanderRadius * WanderRadius;
+
+	FVector* vec = agentVec.GetData();
+	FQuat* gyr = agentGyr.GetData();
+	FVector* velocity = agentVelocity.GetData();
+	float* heading = agentHeading.GetData();
+	const float* speed = agentSpeed.GetData();
+	uint32* seed = agentSeed.GetData();
+
+	ParallelFor(batches, [=](int32 b) {
+		const int32 end = std::min(n, (b + 1) * batch);
+		for (int32 i = b * batch; i < end; i++) {
+			//Xorshift, uniform in [-1, 1]
+			uint32 s = seed[i];
+			s ^= s << 13;
+			s ^= s >> 17;
+			s ^= s << 5;
+			seed[i] = s;
+			float wander = (float)(s >> 8) * (2.0f / 16777216.0f) - 1.0f;
+			heading[i] += wander * turn;
+
+			//Far out, head back towards the origin, which lies along -vec in the agent frame
+			if (sqrMagnitude(vec[i]) > radiusSq) {
+				FVector home = gyr[i] * -vec[i];
+				heading[i] = FMath::Atan2(home.Z, home.X);
+			}
+
+			float sinH, cosH;
+			FMath::SinCos(&sinH, &cosH, heading[i]);
+			FVector desired = FVector(cosH, 0.0f, sinH) * speed[i];
+			velocity[i] = desired + (velocity[i] - desired) * smooth;
+
+			float moved = velocity[i].Size() * DeltaTime;
+			if (moved <= 0.0f) {
+				continue;
+			}
+			FVector delta = velocity[i] * (TanK(k, moved) / moved);
+			FVector newVec;
+			FQuat newGyr;
+			MobiusAddGyrK(k, vec[i], gyr[i].Inverse() * delta, &newVec, &newGyr);
+			vec[i] = newVec;
+			gyr[i] = (gyr[i] * newGyr).GetNormalized();
+		}
+	}, !bParallelStep || batches == 1);
+}
+
+void AWarpAgentManager::ComposeTransforms(const GyroVectorD& worldGV)
+{
+	const int32 n = agentVec.Num();
+	if (n == 0) {
+		return;
+	}
+
+	const float k = getK();
+	const int32 batch = std::max(BatchSize, 1);
+	const int32 batches = (n + batch - 1) / batch;
+	const FVector* vec = agentVec.GetData();
+	const FQuat* gyr = agentGyr.GetData();
+	FVector4* rows = agentRows.GetData();
+
+	ParallelFor(batches, [=, &worldGV](int32 b) {
+		const int32 end = std::min(n, (b + 1) * batch);
+		for (int32 i = b * batch; i < end; i++) {
+			ComposeToMatrixRows(k, GyroVectorD(vec[i], gyr[i]), worldGV, rows + i * 4);
+		}
+	}, !bParallelStep || batches == 1);
+}
+
+void AWarpAgentManager::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	Step(DeltaTime);
+	ComposeTransforms(IsValid(hyper) ? hyper->GetWorldGV() : GyroVectorD(FVector(0, 0, 0), FQuat::Identity));
+}
@@ -0,0 +1,98 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "Warp.h"
+#include "WarpAgentManager.generated.h"
+
+class AWarpHyperComponent;
+
+using namespace WarpMath;
+
+//Walks crowds of agents (NPCs) over the tiling
+//Gyrovectors, velocities and headings are kept as contiguous arrays and advanced in one batched step,
+//composed transforms are written to one array for renderers to read
+UCLASS()
+class WARP_API AWarpAgentManager : public AActor
+{
+	GENERATED_BODY()
+
+	//Agent gyrovectors (position and holonomy)
+	TArray<FVector> agentVec;
+	TArray<FQuat> agentGyr;
+
+	//Velocity in the agent frame, smoothed towards the heading
+	TArray<FVector> agentVelocity;
+
+	//Heading in the tile plane of the agent frame, radians from +X towards +Z
+	TArray<float> agentHeading;
+	TArray<float> agentSpeed;
+
+	//Per agent random state, so wandering never shares a generator between workers
+	TArray<uint32> agentSeed;
+
+	//Four matrix rows per agent from the last ComposeTransforms
+	TArray<FVector4> agentRows;
+
+	UPROPERTY(Transient)
+	AWarpHyperComponent* hyper = nullptr;
+
+public:
+	AWarpAgentManager();
+
+	/** Walking speed of new agents, in gyrovector units per second */
+	UPROPERTY(EditAnywhere, Category = Agents)
+	float WalkSpeed = 0.5f;
+
+	/** Largest heading change per second while wandering, radians */
+	UPROPERTY(EditAnywhere, Category = Agents)
+	float TurnRate = 2.0f;
+
+	/** Seconds for velocity to reach half way to the heading */
+	UPROPERTY(EditAnywhere, Category = Agents)
+	float Smoothing = 0.05f;
+
+	/** Agents further from the origin than this (Poincare norm) turn back */
+	UPROPERTY(EditAnywhere, Category = Agents)
+	float WanderRadius = 0.8f;
+
+	/** Split steps across worker threads */
+	UPROPERTY(EditAnywhere, Category = Agents)
+	bool bParallelStep = true;
+
+	/** Agents per worker batch */
+	UPROPERTY(EditAnywhere, Category = Agents)
+	int32 BatchSize = 512;
+
+	//Find the manager in the world, spawning one if needed
+	static AWarpAgentManager* Get(UWorld* World);
+
+	//Add an agent at gyrovector gv facing heading (radians in its tile plane), seed starts its wandering
+	int32 Spawn(GyroVectorD gv, float heading, float speed, uint32 seed);
+
+	//Add count agents spread over the tiles of the active geometry
+	void SpawnCrowd(int32 count, int32 seed);
+
+	//Remove an agent, the last agent takes its index
+	void Kill(int32 ix);
+	void Empty();
+
+	//Advance all agents by DeltaTime
+	void Step(float DeltaTime);
+
+	//Compose every agent with the world gyrovector into matrix rows, as the hyperbolic materials take them
+	void ComposeTransforms(const GyroVectorD& worldGV);
+
+	int32 Num() const { return agentVec.Num(); }
+	GyroVectorD GetAgentGV(int32 ix) const { return GyroVectorD(agentVec[ix], agentGyr[ix]); }
+	float GetAgentHeading(int32 ix) const { return agentHeading[ix]; }
+	const FVector4* GetAgentRows(int32 ix) const { return agentRows.GetData() + ix * 4; }
+
+protected:
+	virtual void BeginPlay() override;
+
+public:
+	virtual void Tick(float DeltaTime) override;
+};
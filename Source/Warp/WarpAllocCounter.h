@@ -0,0 +1,105 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/MemoryBase.h"
+#include "HAL/PlatformTLS.h"
+
+//Malloc wrapper that counts heap allocations, for benchmarks only
+//Allocations on the installing thread are counted apart from the rest of the engine
+class FWarpMallocCounter : public FMalloc
+{
+public:
+	FMalloc* Inner = nullptr;
+	uint32 OwnerThread = 0;
+	TAtomic<int64> OwnerAllocs { 0 };
+	TAtomic<int64> OtherAllocs { 0 };
+
+	virtual void* Malloc(SIZE_T Count, uint32 Alignment) override
+	{
+		Count1();
+		return Inner->Malloc(Count, Alignment);
+	}
+
+	virtual void* Realloc(void* Original, SIZE_T Count, uint32 Alignment) override
+	{
+		Count1();
+		return Inner->Realloc(Original, Count, Alignment);
+	}
+
+	virtual void Free(void* Original) override { Inner->Free(Original); }
+	virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override { return Inner->QuantizeSize(Count, Alignment); }
+	virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override { return Inner->GetAllocationSize(Original, SizeOut); }
+	virtual void Trim(bool bTrimThreadCaches) override { Inner->Trim(bTrimThreadCaches); }
+	virtual void SetupTLSCachesOnCurrentThread() override { Inner->SetupTLSCachesOnCurrentThread(); }
+	virtual void ClearAndDisableTLSCachesOnCurrentThread() override { Inner->ClearAndDisableTLSCachesOnCurrentThread(); }
+	virtual bool IsInternallyThreadSafe() const override { return Inner->IsInternallyThreadSafe(); }
+	virtual bool ValidateHeap() override { return Inner->ValidateHeap(); }
+	virtual const TCHAR* GetDescriptiveName() override { return TEXT("WarpMallocCounter"); }
+
+private:
+	void Count1()
+	{
+		if (FPlatformTLS::GetCurrentThreadId() == OwnerThread) {
+			OwnerAllocs++;
+		}
+		else {
+			OtherAllocs++;
+		}
+	}
+};
+
+//Counts allocations while in scope by swapping GMalloc
+//The counter is static so a thread still holding the old GMalloc pointer never sees it destroyed
+//Only the outermost scope swaps GMalloc, nested scopes share the counter and count from their own start
+//Scopes are opened and closed on the game thread
+struct FWarpScopedAllocCount
+{
+	FWarpScopedAllocCount()
+	{
+		FWarpMallocCounter& Counter = Get();
+		if (Depth()++ == 0) {
+			check(GMalloc != &Counter);
+			Counter.Inner = GMalloc;
+			Counter.OwnerThread = FPlatformTLS::GetCurrentThreadId();
+			Counter.OwnerAllocs = 0;
+			Counter.OtherAllocs = 0;
+			GMalloc = &Counter;
+		}
+		OwnerStart = Counter.OwnerAllocs;
+		OtherStart = Counter.OtherAllocs;
+	}
+
+	~FWarpScopedAllocCount()
+	{
+		if (--Depth() == 0) {
+			GMalloc = Get().Inner;
+		}
+	}
+
+	FWarpScopedAllocCount(const FWarpScopedAllocCount&) = delete;
+	FWarpScopedAllocCount& operator=(const FWarpScopedAllocCount&) = delete;
+
+	//Allocations made by the installing thread since this scope opened
+	int64 Owner() const { return Get().OwnerAllocs - OwnerStart; }
+
+	//Allocations made by workers and other engine threads since this scope opened
+	int64 Other() const { return Get().OtherAllocs - OtherStart; }
+
+private:
+	int64 OwnerStart = 0;
+	int64 OtherStart = 0;
+
+	static FWarpMallocCounter& Get()
+	{
+		static FWarpMallocCounter Counter;
+		return Counter;
+	}
+
+	static int32& Depth()
+	{
+		static int32 Scopes = 0;
+		return Scopes;
+	}
+};
@@ -0,0 +1,65 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+//Bump allocator for generation state
+//Reserve takes one block up front, allocations never free on their own, Rewind drops everything after a mark
+struct FWarpArena {
+
+    FWarpArena() {}
+    FWarpArena(const FWarpArena&) = delete;
+    FWarpArena& operator=(const FWarpArena&) = delete;
+    ~FWarpArena() { Release(); }
+
+    //Replace the block with one of at least bytes, everything allocated before is lost
+    bool Reserve(SIZE_T bytes) {
+        Release();
+        base = (uint8*)FMemory::Malloc(bytes, 16);
+        size = base ? bytes : 0;
+        return base != nullptr;
+    }
+
+    void Release() {
+        if (base) {
+            FMemory::Free(base);
+        }
+        base = nullptr;
+        size = 0;
+        used = 0;
+    }
+
+    //Null when the block is full
+    void* Alloc(SIZE_T bytes, SIZE_T align = 16) {
+        SIZE_T start = Align(used, align);
+        if (start + bytes > size) {
+            return nullptr;
+        }
+        used = start + bytes;
+        return base + start;
+    }
+
+    //Uninitialized storage for n values
+    template<typename T>
+    T* AllocArray(SIZE_T n) {
+        return (T*)Alloc(n * sizeof(T), alignof(T));
+    }
+
+    //Bytes an array takes, with worst case padding, for sizing Reserve
+    template<typename T>
+    static SIZE_T ArrayBytes(SIZE_T n) {
+        return n * sizeof(T) + alignof(T);
+    }
+
+    SIZE_T Mark() const { return used; }
+    void Rewind(SIZE_T mark) { used = FMath::Min(mark, used); }
+
+    SIZE_T Used() const { return used; }
+    SIZE_T Size() const { return size; }
+
+private:
+    uint8* base = nullptr;
+    SIZE_T size = 0;
+    SIZE_T used = 0;
+};
@@ -0,0 +1,822 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+// Console benchmarks for the hyperbolic math and generation paths
+// Results are written to the log
+
+#include "Warp.h"
+#include "WarpAllocCounter.h"
+#include "WarpHyperComponent.h"
+#include "WarpAgentManager.h"
+#include "WarpVertexWarp.h"
+#include "WarpPathfinding.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Math/RandomStream.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogWarpBench, Log, All);
+
+namespace WarpBench {
+
+	static const TCHAR* ModeName(ETrigMode mode)
+	{
+		switch (mode) {
+			case ETrigMode::Fast: return TEXT("fast");
+			case ETrigMode::Table: return TEXT("table");
+			default: return TEXT("exact");
+		}
+	}
+
+	struct FTrigCase {
+		const TCHAR* name;
+		float lo;
+		float hi;
+		double (*ref)(double);
+		float (*fn)(float);
+	};
+
+	static double RefAtanh(double x) { return atanh(x); }
+	static double RefAcosh(double x) { return acosh(x); }
+	static float EvalAtanh(float x) { return (float)Atanh(x); }
+	static float EvalAcosh(float x) { return (float)Acosh(x); }
+
+	// Accuracy and throughput of each trig function in each mode
+	static void Trig()
+	{
+		const FTrigCase cases[] = {
+			{ TEXT("tanh"), -3.0f, 3.0f, [](double x) { return tanh(x); }, TanhM },
+			{ TEXT("tan"), -1.2f, 1.2f, [](double x) { return tan(x); }, TanM },
+			{ TEXT("atan"), -20.0f, 20.0f, [](double x) { return atan(x); }, AtanM },
+			{ TEXT("atanh"), -0.95f, 0.95f, RefAtanh, EvalAtanh },
+			{ TEXT("acosh"), 1.001f, 100.0f, RefAcosh, EvalAcosh },
+		};
+		const ETrigMode modes[] = { ETrigMode::Exact, ETrigMode::Fast, ETrigMode::Table };
+		const int32 samples = 1 << 20;
+
+		ETrigMode saved = TrigMode();
+		TArray<float> xs;
+		xs.SetNumUninitialized(samples);
+
+		for (const FTrigCase& c : cases) {
+			for (int32 i = 0; i < samples; i++) {
+				xs[i] = c.lo + (c.hi - c.lo) * i / (samples - 1);
+			}
+
+			for (ETrigMode mode : modes) {
+				TrigMode() = mode;
+
+				double maxErr = 0.0;
+				for (int32 i = 0; i < samples; i++) {
+					maxErr = FMath::Max(maxErr, FMath::Abs((double)c.fn(xs[i]) - c.ref(xs[i])));
+				}
+
+				//Sum the results so the loop is not optimized away
+				volatile float sink = 0.0f;
+				float sum = 0.0f;
+				double start = FPlatformTime::Seconds();
+				for (int32 i = 0; i < samples; i++) {
+					sum += c.fn(xs[i]);
+				}
+				double elapsed = FPlatformTime::Seconds() - start;
+				sink = sum;
+
+				UE_LOG(LogWarpBench, Log, TEXT("%-6s %-6s max err %.3g  %.2f ns/call"), c.name, ModeName(mode), maxErr, elapsed * 1e9 / samples);
+			}
+		}
+
+		//Branch-free batch kernel against per-element libm
+		TArray<float> out;
+		out.SetNumUninitialized(samples);
+		for (int32 i = 0; i < samples; i++) {
+			xs[i] = -3.0f + 6.0f * i / (samples - 1);
+		}
+		double start = FPlatformTime::Seconds();
+		TanKBatch(-1.0f, xs.GetData(), out.GetData(), samples);
+		double batch = FPlatformTime::Seconds() - start;
+		start = FPlatformTime::Seconds();
+		for (int32 i = 0; i < samples; i++) {
+			out[i] = (float)tanh(xs[i]);
+		}
+		double libm = FPlatformTime::Seconds() - start;
+		UE_LOG(LogWarpBench, Log, TEXT("TanKBatch %.2f ns/elem, libm tanh %.2f ns/elem"), batch * 1e9 / samples, libm * 1e9 / samples);
+
+		TrigMode() = saved;
+	}
+
+	static GyroVectorD RandomGV(FRandomStream& rng)
+	{
+		FVector vec = rng.GetUnitVector() * rng.FRandRange(0.0f, 0.8f);
+		FQuat gyr = FQuat(rng.GetUnitVector(), rng.FRandRange(-PI, PI));
+		return GyroVectorD(vec, gyr);
+	}
+
+	// The Mobius sum before the cross term fix, which added the X component of c x t on every axis
+	static FVector MobiusAddXCross(float k, FVector a, FVector b)
+	{
+		FVector c = k * FVector::CrossProduct(a, b);
+		float d = 1.0f - k * FVector::DotProduct(a, b);
+		FVector t = a + b;
+		float cr = FVector::CrossProduct(c, t).X;
+		return (t * d + FVector(cr, cr, cr)) / (d * d + sqrMagnitude(c));
+	}
+
+	// MobiusAdd against the old sum on two properties every Mobius sum has:
+	// left cancellation, -a + (a + b) = b, and points in the XZ plane staying in it
+	static void Mobius()
+	{
+		const int32 types[] = { 3, 5 };
+		for (int32 type : types) {
+			FScopedCurvature scope(FWarpCurvature::ForType(type));
+			const float k = getK();
+			FRandomStream rng(1234);
+			float cancelNew = 0.0f;
+			float cancelOld = 0.0f;
+			float planeNew = 0.0f;
+			float planeOld = 0.0f;
+			for (int32 i = 0; i < 10000; i++) {
+				FVector a = rng.GetUnitVector() * rng.FRandRange(0.0f, 0.5f);
+				FVector b = rng.GetUnitVector() * rng.FRandRange(0.0f, 0.5f);
+				cancelNew = FMath::Max(cancelNew, (MobiusAdd(-a, MobiusAdd(a, b)) - b).GetAbsMax());
+				cancelOld = FMath::Max(cancelOld, (MobiusAddXCross(k, -a, MobiusAddXCross(k, a, b)) - b).GetAbsMax());
+				a.Y = 0.0f;
+				b.Y = 0.0f;
+				planeNew = FMath::Max(planeNew, FMath::Abs(MobiusAdd(a, b).Y));
+				planeOld = FMath::Max(planeOld, FMath::Abs(MobiusAddXCross(k, a, b).Y));
+			}
+			UE_LOG(LogWarpBench, Log, TEXT("mobius {4,%d} k %.0f: left cancellation error %.3g (old %.3g), off-plane drift %.3g (old %.3g)"),
+				type, k, cancelNew, cancelOld, planeNew, planeOld);
+		}
+	}
+
+	// Fused compose kernel against add() followed by ToMatrix()
+	static void Compose()
+	{
+		const int32 counts[] = { 100, 1000, 10000, 100000 };
+		FRandomStream rng(1234);
+		const float k = getK();
+
+		for (int32 n : counts) {
+			TArray<GyroVectorD> locals;
+			for (int32 i = 0; i < n; i++) {
+				locals.Add(RandomGV(rng));
+			}
+			GyroVectorD world = RandomGV(rng);
+
+			TArray<FMatrix> mats;
+			mats.SetNumUninitialized(n);
+			TArray<FVector4> rows;
+			rows.SetNumUninitialized(n * 4);
+
+			double start = FPlatformTime::Seconds();
+			for (int32 i = 0; i < n; i++) {
+				mats[i] = add(locals[i], world).ToMatrix();
+			}
+			double reference = FPlatformTime::Seconds() - start;
+
+			start = FPlatformTime::Seconds();
+			for (int32 i = 0; i < n; i++) {
+				ComposeToMatrixRows(k, locals[i], world, &rows[i * 4]);
+			}
+			double fused = FPlatformTime::Seconds() - start;
+
+			float maxErr = 0.0f;
+			for (int32 i = 0; i < n; i++) {
+				for (int32 r = 0; r < 4; r++) {
+					for (int32 c = 0; c < 4; c++) {
+						maxErr = FMath::Max(maxErr, FMath::Abs(mats[i].M[r][c] - rows[i * 4 + r][c]));
+					}
+				}
+			}
+
+			UE_LOG(LogWarpBench, Log, TEXT("compose %6d objects: add+ToMatrix %.1f ns, fused %.1f ns per object, max diff %.3g"),
+				n, reference * 1e9 / n, fused * 1e9 / n, maxErr);
+		}
+	}
+
+	// Vertices per second of the CPU warp against UnitToPoincare and apply() per vertex
+	// Every frame moves the view, so the cache recomputes each time except in the last pass
+	static void VertexWarp(const TArray<FString>& Args)
+	{
+		int32 n = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 100000;
+		int32 frames = Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 60;
+		n = FMath::Max(n, 1);
+		frames = FMath::Max(frames, 1);
+		FRandomStream rng(1234);
+
+		TArray<FVector> unit;
+		unit.SetNumUninitialized(n);
+		for (int32 i = 0; i < n; i++) {
+			unit[i] = FVector(rng.FRandRange(-0.5f, 0.5f), rng.FRandRange(0.0f, 0.5f), rng.FRandRange(-0.5f, 0.5f));
+		}
+		GyroVectorD local = RandomGV(rng);
+		TArray<GyroVectorD> worlds;
+		for (int32 f = 0; f < frames; f++) {
+			worlds.Add(RandomGV(rng));
+		}
+
+		TArray<FVector> reference;
+		reference.SetNumUninitialized(n);
+		double start = FPlatformTime::Seconds();
+		for (int32 f = 0; f < frames; f++) {
+			GyroVectorD gv = add(local, worlds[f]);
+			for (int32 i = 0; i < n; i++) {
+				reference[i] = apply(gv, UnitToPoincare(unit[i], false));
+			}
+		}
+		double scalar = FPlatformTime::Seconds() - start;
+
+		double times[2];
+		float maxErr = 0.0f;
+		for (int32 parallel = 0; parallel < 2; parallel++) {
+			FWarpVertexCache cache;
+			cache.SetVertices(unit.GetData(), n, false);
+			start = FPlatformTime::Seconds();
+			for (int32 f = 0; f < frames; f++) {
+				cache.Warp(local, worlds[f], parallel != 0);
+			}
+			times[parallel] = FPlatformTime::Seconds() - start;
+			const TArray<FVector>& warped = cache.GetWarped();
+			for (int32 i = 0; i < n; i++) {
+				maxErr = FMath::Max(maxErr, (warped[i] - reference[i]).GetAbsMax());
+			}
+		}
+
+		FWarpVertexCache cache;
+		cache.SetVertices(unit.GetData(), n, false);
+		cache.Warp(local, worlds[0]);
+		start = FPlatformTime::Seconds();
+		for (int32 f = 0; f < frames; f++) {
+			cache.Warp(local, worlds[0]);
+		}
+		double cached = FPlatformTime::Seconds() - start;
+
+		double verts = (double)n * frames;
+		UE_LOG(LogWarpBench, Log, TEXT("vertex warp %d vertices x %d frames: per vertex %.1f, batched %.1f, batched parallel %.1f Mverts/s, max diff %.3g"),
+			n, frames, verts / scalar * 1e-6, verts / times[0] * 1e-6, verts / times[1] * 1e-6, maxErr);
+		UE_LOG(LogWarpBench, Log, TEXT("  unchanged transform %.3f us per warp, %d hits"), cached * 1e6 / frames, cache.GetHits());
+	}
+
+	// Horizon culling of every tile against the supertile walk, for growing maps seen from random tiles
+	// The walk should visit about log(tiles) supertiles while the flat pass tests them all
+	// The flat pass runs over an array of tiles as maps were stored before FWarpTileStore, over the store,
+	// and over the store's rings the horizon can reach, with |vec| ruling out most tiles before their gyration is read
+	static void Supertiles(const TArray<FString>& Args)
+	{
+		int32 type = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 5;
+		bool lattice3D = Args.Num() > 1 && FCString::Atoi(*Args[1]) != 0;
+		int32 depth = Args.Num() > 2 ? FCString::Atoi(*Args[2]) : 8;
+		const int32 views = 100;
+		FWarpGameModule* m = GetWarpModule();
+
+		for (int32 d = 2; d <= depth; d++) {
+			FWarpArena arena;
+			TileSet tiles;
+			if (!m->BuildTileSet(type, lattice3D, d, &arena, &tiles, false)) {
+				return;
+			}
+			TArray<uint8> data;
+			WriteTileSet(tiles, &data, false);
+			FWarpGeometry geometry;
+			geometry.curvature = FWarpCurvature::ForType(type);
+			ParseTileMap(data, &geometry);
+			geometry.lattice3D = lattice3D;
+
+			double start = FPlatformTime::Seconds();
+			BuildSupertiles(&geometry);
+			double build = FPlatformTime::Seconds() - start;
+
+			FScopedCurvature scope(geometry.curvature);
+			const float k = getK();
+			if (k >= 0.0f) {
+				UE_LOG(LogWarpBench, Log, TEXT("supertiles: {4,%s%d} has no horizon"), lattice3D ? TEXT("3,") : TEXT(""), type);
+				return;
+			}
+			const FWarpSupertiles& st = geometry.supertiles;
+			const float horizonSq = 0.995f * 0.995f / -k;
+			const double horizon = FWarpSupertiles::Distance(k, 0.995 / sqrt(-k));
+			FRandomStream rng(1234);
+			int32 n = geometry.tiles.Num();
+
+			TArray<WorldTile> array;
+			array.Reserve(n);
+			for (int32 i = 0; i < n; i++) {
+				array.Add(geometry.tiles[i]);
+			}
+			const FWarpTileStore::TAlignedArray<FVector>& vec = geometry.tiles.vec;
+
+			double old = 0.0;
+			double flat = 0.0;
+			double rings = 0.0;
+			double walk = 0.0;
+			int64 oldVisible = 0;
+			int64 flatVisible = 0;
+			int64 ringVisible = 0;
+			int64 walkVisible = 0;
+			int64 scanned = 0;
+			int64 visited = 0;
+			int64 tested = 0;
+			TArray<int32> stack;
+			for (int32 v = 0; v < views; v++) {
+				GyroVectorD world = InverseG(geometry.tiles.GV(rng.RandRange(0, FMath::Min(n, 64) - 1)));
+
+				start = FPlatformTime::Seconds();
+				for (int32 i = 0; i < n; i++) {
+					oldVisible += sqrMagnitude(add(array[i].gv, world).vec) < horizonSq ? 1 : 0;
+				}
+				old += FPlatformTime::Seconds() - start;
+
+				start = FPlatformTime::Seconds();
+				for (int32 i = 0; i < n; i++) {
+					flatVisible += sqrMagnitude(add(geometry.tiles.GV(i), world).vec) < horizonSq ? 1 : 0;
+				}
+				flat += FPlatformTime::Seconds() - start;
+
+				//Gyrations keep norms, so a visible tile is within the horizon of the view's distance from the origin
+				start = FPlatformTime::Seconds();
+				double at = FWarpSupertiles::Distance(k, world.vec.Size());
+				float outer = (float)FWarpSupertiles::Radius(k, at + horizon + 1e-3);
+				float inner = (float)FWarpSupertiles::Radius(k, FMath::Max(at - horizon - 1e-3, 0.0));
+				int32 end = geometry.tiles.WithinRadius(outer);
+				for (int32 i = 0; i < end; i++) {
+					float r = sqrMagnitude(vec[i]);
+					if (r <= outer * outer && r >= inner * inner) {
+						ringVisible += sqrMagnitude(add(geometry.tiles.GV(i), world).vec) < horizonSq ? 1 : 0;
+						scanned++;
+					}
+				}
+				rings += FPlatformTime::Seconds() - start;
+
+				start = FPlatformTime::Seconds();
+				stack.Reset();
+				stack.Add(0);
+				while (stack.Num() > 0) {
+					const FWarpSupertile& node = st.nodes[stack.Pop(false)];
+					visited++;
+					if (node.unbounded == node.count) {
+						continue;
+					}
+					double dist = FWarpSupertiles::Distance(k, sqrt(sqrMagnitude(add(node.centre, world).vec)));
+					if (dist - node.radius > horizon + 1e-3) {
+						continue;
+					}
+					if (node.unbounded == 0 && dist + node.radius < horizon - 1e-3) {
+						walkVisible += node.count;
+					}
+					else if (node.numChildren > 0) {
+						for (int32 c = node.child; c < node.child + node.numChildren; c++) {
+							stack.Add(c);
+						}
+					}
+					else {
+						for (int32 j = node.first; j < node.first + node.count; j++) {
+							walkVisible += sqrMagnitude(add(geometry.tiles.GV(st.order[j]), world).vec) < horizonSq ? 1 : 0;
+						}
+						tested += node.count;
+					}
+				}
+				walk += FPlatformTime::Seconds() - start;
+			}
+
+			UE_LOG(LogWarpBench, Log, TEXT("supertiles {4,%s%d} depth %d: %d tiles, %d supertiles built in %.2f ms"),
+				lattice3D ? TEXT("3,") : TEXT(""), type, d, n, st.nodes.Num(), build * 1000.0);
+			UE_LOG(LogWarpBench, Log, TEXT("  flat over tile array %.1f us, over store %.1f us, over reachable rings %.1f us with %.1f tiles tested, %lld and %lld visible tiles differ"),
+				old * 1e6 / views, flat * 1e6 / views, rings * 1e6 / views, (double)scanned / views,
+				FMath::Abs(flatVisible - oldVisible), FMath::Abs(flatVisible - ringVisible));
+			UE_LOG(LogWarpBench, Log, TEXT("  walk %.1f us per view, %.1f supertiles and %.1f tiles tested, %lld visible tiles differ"),
+				walk * 1e6 / views, (double)visited / views, (double)tested / views, FMath::Abs(flatVisible - walkVisible));
+		}
+	}
+
+	// Path requests per second on the active geometry: A* one at a time for latency, then batches on the thread pool
+	// The batches draw goals from a few common ones, so distance fields take over after the first requests
+	static void Paths(const TArray<FString>& Args)
+	{
+		int32 count = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 4096;
+		int32 goals = Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 8;
+		count = FMath::Max(count, 1);
+		goals = FMath::Max(goals, 1);
+
+		FWarpPathfinderPtr pathfinder = GetWarpModule()->GetPathfinder();
+		if (!pathfinder.IsValid()) {
+			UE_LOG(LogWarpBench, Log, TEXT("paths: no active geometry"));
+			return;
+		}
+		int32 n = pathfinder->GetGeometry()->tiles.Num();
+		FRandomStream rng(1234);
+
+		TArray<FIntPoint> random;
+		TArray<FIntPoint> common;
+		for (int32 i = 0; i < count; i++) {
+			random.Add(FIntPoint(rng.RandRange(0, n - 1), rng.RandRange(0, n - 1)));
+			common.Add(FIntPoint(rng.RandRange(0, n - 1), rng.RandRange(0, goals - 1) * (n / goals)));
+		}
+
+		TArray<double> latency;
+		int32 complete = 0;
+		int64 length = 0;
+		int32 expansions = pathfinder->GetExpansions();
+		double start = FPlatformTime::Seconds();
+		for (const FIntPoint& request : random) {
+			double t = FPlatformTime::Seconds();
+			FWarpPath path = pathfinder->FindPath(request.X, request.Y);
+			latency.Add(FPlatformTime::Seconds() - t);
+			complete += path.bComplete ? 1 : 0;
+			length += path.Tiles.Num();
+		}
+		double serial = FPlatformTime::Seconds() - start;
+		latency.Sort();
+		UE_LOG(LogWarpBench, Log, TEXT("paths %d tiles, %d random requests: %.0f per second, p50 %.1f us, p99 %.1f us, max %.1f us"),
+			n, count, count / serial, latency[count / 2] * 1e6, latency[count * 99 / 100] * 1e6, latency.Last() * 1e6);
+		UE_LOG(LogWarpBench, Log, TEXT("  %d complete, mean length %.1f, %.1f expansions per request"),
+			complete, (double)length / count, (double)(pathfinder->GetExpansions() - expansions) / count);
+
+		for (const TArray<FIntPoint>* requests : { &random, &common }) {
+			int32 hits = pathfinder->GetFieldHits();
+			start = FPlatformTime::Seconds();
+			TArray<FWarpPath> paths = pathfinder->FindPathsAsync(*requests).Get();
+			double batch = FPlatformTime::Seconds() - start;
+			UE_LOG(LogWarpBench, Log, TEXT("  batch of %d %s requests: %.0f per second, %d from distance fields (%d cached)"),
+				paths.Num(), requests == &random ? TEXT("random") : TEXT("common-goal"), paths.Num() / batch,
+				pathfinder->GetFieldHits() - hits, pathfinder->NumFields());
+		}
+	}
+
+	// Heap allocations and time per generation depth, serial and parallel
+	// Tile storage comes from one arena, so counts should not grow with the tile count
+	static void Generate(const TArray<FString>& Args)
+	{
+		int32 type = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 5;
+		bool lattice3D = Args.Num() > 1 && FCString::Atoi(*Args[1]) != 0;
+		int32 depth = Args.Num() > 2 ? FCString::Atoi(*Args[2]) : 8;
+
+		FWarpGameModule* m = GetWarpModule();
+		bool savedParallel = m->bParallelGeneration;
+
+		for (int32 d = 2; d <= depth; d++) {
+			for (int32 parallel = 0; parallel < 2; parallel++) {
+				m->bParallelGeneration = parallel != 0;
+
+				int32 num = 0;
+				int64 owner, other;
+				double start = FPlatformTime::Seconds();
+				{
+					FWarpScopedAllocCount count;
+					{
+						FWarpArena arena;
+						TileSet tiles;
+						m->BuildTileSet(type, lattice3D, d, &arena, &tiles, false);
+						num = tiles.Num();
+					}
+					owner = count.Owner();
+					other = count.Other();
+				}
+				double elapsed = FPlatformTime::Seconds() - start;
+
+				UE_LOG(LogWarpBench, Log, TEXT("generate {4,%s%d} depth %2d %-8s %8d tiles  %lld allocs (+%lld other threads)  %.1f ms"),
+					lattice3D ? TEXT("3,") : TEXT(""), type, d, parallel ? TEXT("parallel") : TEXT("serial"), num, owner, other, elapsed * 1000.0);
+			}
+		}
+
+		m->bParallelGeneration = savedParallel;
+	}
+
+	// Full against symmetry-reduced generation: time, and every tile's path and position compared
+	static void Symmetry(const TArray<FString>& Args)
+	{
+		int32 type = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 5;
+		bool lattice3D = Args.Num() > 1 && FCString::Atoi(*Args[1]) != 0;
+		int32 depth = Args.Num() > 2 ? FCString::Atoi(*Args[2]) : 8;
+
+		FWarpGameModule* m = GetWarpModule();
+		bool savedSymmetric = m->bSymmetricGeneration;
+
+		FWarpArena arenas[2];
+		TileSet tiles[2];
+		double ms[2];
+		for (int32 symmetric = 0; symmetric < 2; symmetric++) {
+			m->bSymmetricGeneration = symmetric != 0;
+			double start = FPlatformTime::Seconds();
+			m->BuildTileSet(type, lattice3D, depth, &arenas[symmetric], &tiles[symmetric], false);
+			ms[symmetric] = (FPlatformTime::Seconds() - start) * 1000.0;
+		}
+		m->bSymmetricGeneration = savedSymmetric;
+
+		int32 n = FMath::Min(tiles[0].Num(), tiles[1].Num());
+		int32 pathDiffs = 0;
+		float maxErr = 0.0f;
+		for (int32 i = 0; i < n; i++) {
+			const Tile& a = tiles[0][i];
+			const Tile& b = tiles[1][i];
+			pathDiffs += (a.parent != b.parent || a.move != b.move || a.len != b.len) ? 1 : 0;
+			if (TileIndex::IsFinite(a.gv.vec)) {
+				maxErr = FMath::Max(maxErr, (a.gv.vec - b.gv.vec).GetAbsMax());
+			}
+		}
+
+		UE_LOG(LogWarpBench, Log, TEXT("generate {4,%s%d} depth %d: full %d tiles %.1f ms, symmetric %d tiles %.1f ms (%.2fx), %d paths differ, max position diff %.3g"),
+			lattice3D ? TEXT("3,") : TEXT(""), type, depth, tiles[0].Num(), ms[0], tiles[1].Num(), ms[1], ms[0] / FMath::Max(ms[1], 1e-6),
+			pathDiffs, maxErr);
+	}
+
+	// Raw against compressed tile maps: size, parse time and error
+	static void MapFormat(const TArray<FString>& Args)
+	{
+		int32 type = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 5;
+		bool lattice3D = Args.Num() > 1 && FCString::Atoi(*Args[1]) != 0;
+		int32 depth = Args.Num() > 2 ? FCString::Atoi(*Args[2]) : 8;
+		const int32 runs = 10;
+
+		FWarpGameModule* m = GetWarpModule();
+		FWarpArena arena;
+		TileSet tiles;
+		if (!m->BuildTileSet(type, lattice3D, depth, &arena, &tiles, false)) {
+			return;
+		}
+
+		TArray<uint8> raw;
+		TArray<uint8> packed;
+		double start = FPlatformTime::Seconds();
+		WriteTileSet(tiles, &raw, false);
+		double rawWrite = FPlatformTime::Seconds() - start;
+		start = FPlatformTime::Seconds();
+		WriteTileSet(tiles, &packed, true);
+		double packedWrite = FPlatformTime::Seconds() - start;
+
+		FWarpGeometry rawGeometry;
+		FWarpGeometry packedGeometry;
+		double rawParse = 0.0;
+		double packedParse = 0.0;
+		for (int32 r = 0; r < runs; r++) {
+			rawGeometry = FWarpGeometry();
+			packedGeometry = FWarpGeometry();
+			rawGeometry.curvature = packedGeometry.curvature = FWarpCurvature::ForType(type);
+
+			start = FPlatformTime::Seconds();
+			ParseTileMap(raw, &rawGeometry);
+			rawParse += FPlatformTime::Seconds() - start;
+
+			start = FPlatformTime::Seconds();
+			ParseTileMap(packed, &packedGeometry);
+			packedParse += FPlatformTime::Seconds() - start;
+		}
+
+		float vecErr = 0.0f;
+		float gyrErr = 0.0f;
+		int32 cellErr = 0;
+		for (int32 i = 0; i < rawGeometry.tiles.Num() && i < packedGeometry.tiles.Num(); i++) {
+			GyroVectorD a = rawGeometry.tiles.GV(i);
+			GyroVectorD b = packedGeometry.tiles.GV(i);
+			if (TileIndex::IsFinite(a.vec)) {
+				vecErr = FMath::Max(vecErr, (a.vec - b.vec).GetAbsMax());
+			}
+			//q and -q are the same rotation
+			float d = FMath::Min((a.gyr - b.gyr).Size(), (a.gyr + b.gyr).Size());
+			gyrErr = FMath::Max(gyrErr, d);
+			cellErr += rawGeometry.tiles.cell[i] != packedGeometry.tiles.cell[i] ? 1 : 0;
+		}
+
+		UE_LOG(LogWarpBench, Log, TEXT("map {4,%s%d} depth %d, %d tiles: raw %d bytes, compressed %d bytes (%.1fx)"),
+			lattice3D ? TEXT("3,") : TEXT(""), type, depth, tiles.Num(), raw.Num(), packed.Num(), (float)raw.Num() / FMath::Max(packed.Num(), 1));
+		UE_LOG(LogWarpBench, Log, TEXT("  write raw %.2f ms, compressed %.2f ms; parse raw %.2f ms, compressed %.2f ms"),
+			rawWrite * 1000.0, packedWrite * 1000.0, rawParse * 1000.0 / runs, packedParse * 1000.0 / runs);
+		UE_LOG(LogWarpBench, Log, TEXT("  max error vec %.3g, gyr %.3g, %d cells differ, %d/%d tiles"),
+			vecErr, gyrErr, cellErr, packedGeometry.tiles.Num(), rawGeometry.tiles.Num());
+
+		//The origin is generated with a zero gyration, both formats must read it back as the identity
+		for (const FWarpGeometry* geometry : { &rawGeometry, &packedGeometry }) {
+			FQuat origin = geometry->tiles.Num() > 0 ? geometry->tiles.gyr[0] : FQuat(0, 0, 0, 0);
+			float err = FMath::Min((origin - FQuat::Identity).Size(), (origin + FQuat::Identity).Size());
+			if (err > 1e-5f) {
+				UE_LOG(LogWarpBench, Error, TEXT("  %s origin tile gyration is (%g, %g, %g, %g), not the identity"),
+					geometry == &rawGeometry ? TEXT("raw") : TEXT("compressed"), origin.X, origin.Y, origin.Z, origin.W);
+			}
+		}
+	}
+
+	// Random walk through the active geometry with wall collision, timed per 120 Hz step
+	static void Collision(const TArray<FString>& Args)
+	{
+		int32 steps = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 100000;
+
+		FWarpGameModule* m = GetWarpModule();
+		FWarpGeometryPtr geometry = m->GetGeometry();
+		if (!geometry.IsValid()) {
+			UE_LOG(LogWarpBench, Warning, TEXT("No active geometry, load a map first"));
+			return;
+		}
+
+		FWarpCollision collision(&AWarpHyperComponent::StepGV, &AWarpHyperComponent::ViewGV);
+		GyroVectorD sim;
+		collision.Reset(geometry, sim);
+
+		//Walking speed at the base height, turning a little every step so the walk reaches walls
+		FRandomStream random(1234);
+		const float stepLength = 2.0f * 0.1f / 120.0f;
+		float heading = 0.0f;
+		TArray<double> times;
+		times.Reserve(steps);
+		int32 hits = 0;
+		int32 changes = 0;
+		for (int32 i = 0; i < steps; i++) {
+			heading += random.FRandRange(-0.3f, 0.3f);
+			FVector move = HyperTranslate(FVector(FMath::Cos(heading), FMath::Sin(heading), 0.0f) * stepLength);
+			int32 before = collision.GetTile();
+
+			double start = FPlatformTime::Seconds();
+			FVector resolved = collision.Slide(sim, move);
+			sim = AWarpHyperComponent::StepGV(sim, resolved);
+			collision.Update(sim);
+			times.Add(FPlatformTime::Seconds() - start);
+
+			hits += collision.GetLastHits() > 0 ? 1 : 0;
+			changes += collision.GetTile() != before ? 1 : 0;
+		}
+
+		times.Sort();
+		double total = 0.0;
+		for (double t : times) {
+			total += t;
+		}
+		UE_LOG(LogWarpBench, Log, TEXT("collision %d steps, %d tiles: avg %.2f us, p99 %.2f us, max %.2f us; %d steps hit walls, %d tile changes"),
+			steps, geometry->tiles.Num(), total * 1e6 / FMath::Max(steps, 1), times.Num() ? times[times.Num() * 99 / 100] * 1e6 : 0.0,
+			times.Num() ? times.Last() * 1e6 : 0.0, hits, changes);
+	}
+
+	// Grow a lazy map to full depth with the player always on its edge, then compare with eager generation
+	static void Lazy(const TArray<FString>& Args)
+	{
+		int32 type = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 5;
+		bool lattice3D = Args.Num() > 1 && FCString::Atoi(*Args[1]) != 0;
+		int32 depth = Args.Num() > 2 ? FCString::Atoi(*Args[2]) : 8;
+
+		FWarpGameModule* m = GetWarpModule();
+		FWarpGeometryPtr previous = m->GetGeometry();
+
+		double start = FPlatformTime::Seconds();
+		if (!m->StartLazyMap(type, lattice3D, 2, depth)) {
+			return;
+		}
+		int32 frames = 0;
+		int32 rings = 0;
+		double longest = 0.0;
+		while (!m->IsLazyMapComplete()) {
+			FWarpGeometryPtr active = m->GetGeometry();
+			double frame = FPlatformTime::Seconds();
+			rings += m->UpdateLazyMap(active->tiles.Num() - 1).IsValid() ? 1 : 0;
+			longest = FMath::Max(longest, FPlatformTime::Seconds() - frame);
+			frames++;
+			FPlatformProcess::Sleep(0.001f);
+		}
+		double lazyTime = FPlatformTime::Seconds() - start;
+		FWarpGeometryPtr grown = m->GetGeometry();
+
+		FWarpArena arena;
+		TileSet tiles;
+		start = FPlatformTime::Seconds();
+		m->BuildTileSet(type, lattice3D, depth, &arena, &tiles, false);
+		double eagerTime = FPlatformTime::Seconds() - start;
+
+		//The eager set in the order a published map has, cells follow from the parents as in the lazy map
+		FWarpGeometry eager;
+		eager.lattice3D = lattice3D;
+		eager.curvature = FWarpCurvature::ForType(type);
+		float cw = eager.curvature.CELL_WIDTH;
+		TArray<FIntVector> cells;
+		cells.SetNumUninitialized(tiles.Num());
+		for (int32 i = 0; i < tiles.Num(); i++) {
+			const Tile& t = tiles[i];
+			cells[i] = (t.parent >= 0 ? cells[t.parent] : FIntVector(0, 0, 0)) + MoveCell(t.move);
+			eager.tiles.Add(cells[i], FVector2D(cells[i].X * cw, cells[i].Z * cw), t.gv, t.len - 1);
+		}
+		FinalizeTiles(&eager);
+
+		int32 mismatches = 0;
+		for (int32 i = 0; i < eager.tiles.Num() && i < grown->tiles.Num(); i++) {
+			GyroVectorD a = eager.tiles.GV(i);
+			GyroVectorD b = grown->tiles.GV(i);
+			bool same = (a.vec == b.vec || (!TileIndex::IsFinite(a.vec) && !TileIndex::IsFinite(b.vec))) && a.gyr == b.gyr;
+			mismatches += same ? 0 : 1;
+		}
+
+		//Lazy snapshots only link the tiles on their edge, eager maps link every tile
+		BuildNeighbours(&eager);
+		int32 links = 0;
+		if (eager.neighbours.Num() == grown->neighbours.Num()) {
+			for (int32 i = 0; i < eager.neighbours.Num(); i++) {
+				links += eager.neighbours[i] != grown->neighbours[i] ? 1 : 0;
+			}
+		}
+		else {
+			links = -1;
+		}
+
+		UE_LOG(LogWarpBench, Log, TEXT("lazy {4,%s%d} depth %d: %d tiles in %d frames, %d rings published, longest frame %.3f ms, total %.1f ms"),
+			lattice3D ? TEXT("3,") : TEXT(""), type, depth, grown->tiles.Num(), frames, rings, longest * 1000.0, lazyTime * 1000.0);
+		UE_LOG(LogWarpBench, Log, TEXT("  eager %d tiles in %.1f ms, %d tiles differ, %d neighbour links differ (-1 for a different count)"),
+			tiles.Num(), eagerTime * 1000.0, mismatches + FMath::Abs(tiles.Num() - grown->tiles.Num()), links);
+
+		m->StopLazyMap();
+		if (previous.IsValid()) {
+			m->ActivateGeometry(previous);
+		}
+	}
+
+	// Crowd step and compose at 60 Hz, on one core and across workers
+	static void Agents(const TArray<FString>& Args, UWorld* World)
+	{
+		int32 count = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 10000;
+		int32 frames = Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 600;
+		if (!World) {
+			return;
+		}
+
+		AWarpAgentManager* agents = AWarpAgentManager::Get(World);
+		bool savedParallel = agents->bParallelStep;
+		const float dt = 1.0f / 60.0f;
+		GyroVectorD worldGV(FVector(0, 0, 0), FQuat::Identity);
+
+		for (int32 parallel = 0; parallel < 2; parallel++) {
+			agents->Empty();
+			agents->SpawnCrowd(count, 1234);
+			agents->bParallelStep = parallel != 0;
+
+			double step = 0.0;
+			double compose = 0.0;
+			for (int32 f = 0; f < frames; f++) {
+				double start = FPlatformTime::Seconds();
+				agents->Step(dt);
+				double mid = FPlatformTime::Seconds();
+				agents->ComposeTransforms(worldGV);
+				compose += FPlatformTime::Seconds() - mid;
+				step += mid - start;
+			}
+			double frameMs = (step + compose) * 1000.0 / FMath::Max(frames, 1);
+			UE_LOG(LogWarpBench, Log, TEXT("agents %d %-8s step %.3f ms, compose %.3f ms per frame, %.1f%% of a 60 Hz frame"),
+				agents->Num(), parallel ? TEXT("parallel") : TEXT("serial"), step * 1000.0 / FMath::Max(frames, 1),
+				compose * 1000.0 / FMath::Max(frames, 1), frameMs * 6.0);
+		}
+
+		agents->Empty();
+		agents->bParallelStep = savedParallel;
+	}
+
+}
+
+static FAutoConsoleCommand WarpBenchLazyCommand(
+	TEXT("Warp.Bench.Lazy"),
+	TEXT("Warp.Bench.Lazy <N> <3D 0|1> <depth>: grow a lazy map to depth and compare it with eager generation"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&WarpBench::Lazy));
+
+static FAutoConsoleCommand WarpBenchAgentsCommand(
+	TEXT("Warp.Bench.Agents"),
+	TEXT("Warp.Bench.Agents <count> <frames>: time crowd steps and transforms at 60 Hz"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&WarpBench::Agents));
+
+static FAutoConsoleCommand WarpBenchCollisionCommand(
+	TEXT("Warp.Bench.Collision"),
+	TEXT("Warp.Bench.Collision <steps>: time wall collision for a random walk in the active geometry"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&WarpBench::Collision));
+
+static FAutoConsoleCommand WarpBenchMapFormatCommand(
+	TEXT("Warp.Bench.MapFormat"),
+	TEXT("Warp.Bench.MapFormat <N> <3D 0|1> <depth>: compare raw and compressed tile maps"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&WarpBench::MapFormat));
+
+static FAutoConsoleCommand WarpBenchGenerateCommand(
+	TEXT("Warp.Bench.Generate"),
+	TEXT("Warp.Bench.Generate <N> <3D 0|1> <depth>: count allocations and time per generation depth"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&WarpBench::Generate));
+
+static FAutoConsoleCommand WarpBenchSymmetryCommand(
+	TEXT("Warp.Bench.Symmetry"),
+	TEXT("Warp.Bench.Symmetry <N> <3D 0|1> <depth>: compare full and symmetry-reduced generation"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&WarpBench::Symmetry));
+
+static FAutoConsoleCommand WarpBenchPathsCommand(
+	TEXT("Warp.Bench.Paths"),
+	TEXT("Warp.Bench.Paths <requests> <goals>: path requests per second and latency on the active geometry"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&WarpBench::Paths));
+
+static FAutoConsoleCommand WarpBenchSupertilesCommand(
+	TEXT("Warp.Bench.Supertiles"),
+	TEXT("Warp.Bench.Supertiles <N> <3D 0|1> <depth>: compare flat and supertile horizon culling per map depth"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&WarpBench::Supertiles));
+
+static FAutoConsoleCommand WarpBenchVertexWarpCommand(
+	TEXT("Warp.Bench.VertexWarp"),
+	TEXT("Warp.Bench.VertexWarp <vertices> <frames>: vertices per second of the CPU mesh warp, serial and parallel"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&WarpBench::VertexWarp));
+
+static FAutoConsoleCommand WarpBenchMobiusCommand(
+	TEXT("Warp.Bench.Mobius"),
+	TEXT("Check the Mobius sum for left cancellation and plane preservation against the sum before the cross term fix"),
+	FConsoleCommandDelegate::CreateStatic(&WarpBench::Mobius));
+
+static FAutoConsoleCommand WarpBenchComposeCommand(
+	TEXT("Warp.Bench.Compose"),
+	TEXT("Compare the fused compose-to-matrix kernel with add() and ToMatrix()"),
+	FConsoleCommandDelegate::CreateStatic(&WarpBench::Compose));
+
+static FAutoConsoleCommand WarpBenchTrigCommand(
+	TEXT("Warp.Bench.Trig"),
+	TEXT("Compare exact, fast and table curvature trig functions for accuracy and speed"),
+	FConsoleCommandDelegate::CreateStatic(&WarpBench::Trig));
@@ -0,0 +1,405 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "WarpBenchmarkDriver.h"
+#include "Warp.h"
+#include "WarpCharacter.h"
+#include "WarpHyperComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/StaticMeshActor.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Kismet/GameplayStatics.h"
+#include "Math/RandomStream.h"
+#include "Misc/App.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "UObject/ConstructorHelpers.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogWarpBench, Log, All);
+
+//Spawn benchmark objects, "Warp.Bench.Spawn 0" clears them
+static FAutoConsoleCommand WarpBenchSpawnCommand(
+	TEXT("Warp.Bench.Spawn"),
+	TEXT("Warp.Bench.Spawn <count>"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World) {
+		if (Args.Num() < 1 || !World) {
+			return;
+		}
+		AWarpBenchmarkDriver::Get(World)->SpawnScene(FCString::Atoi(*Args[0]));
+	}));
+
+static FAutoConsoleCommand WarpRecordCommand(
+	TEXT("Warp.Record"),
+	TEXT("Warp.Record <start|stop> [file]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World) {
+		if (Args.Num() < 1 || !World) {
+			return;
+		}
+		AWarpBenchmarkDriver* Driver = AWarpBenchmarkDriver::Get(World);
+		if (Args[0] == TEXT("start")) {
+			Driver->StartRecording();
+		}
+		else {
+			Driver->StopRecording(Args.Num() > 1 ? Args[1] : TEXT("input.bin"));
+		}
+	}));
+
+static FAutoConsoleCommand WarpReplayCommand(
+	TEXT("Warp.Replay"),
+	TEXT("Warp.Replay <file>"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World) {
+		if (!World) {
+			return;
+		}
+		AWarpBenchmarkDriver::Get(World)->StartReplay(Args.Num() > 0 ? Args[0] : TEXT("input.bin"));
+	}));
+
+//e.g. "Warp.Bench.Scene walk.bin 600 100 1000 10000 100000"
+static FAutoConsoleCommand WarpBenchSceneCommand(
+	TEXT("Warp.Bench.Scene"),
+	TEXT("Warp.Bench.Scene <file> <frames, 0 for the whole recording> [object counts...]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World) {
+		if (Args.Num() < 1 || !World) {
+			return;
+		}
+		TArray<int32> Counts;
+		for (int32 i = 2; i < Args.Num(); i++) {
+			Counts.Add(FCString::Atoi(*Args[i]));
+		}
+		if (Counts.Num() == 0) {
+			Counts = { 100, 1000, 10000, 100000 };
+		}
+		AWarpBenchmarkDriver::Get(World)->RunBenchmark(Args[0], Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 0, Counts);
+	}));
+
+AWarpBenchmarkDriver::AWarpBenchmarkDriver()
+{
+
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.TickGroup = TG_PrePhysics;
+
+	static ConstructorHelpers::FObjectFinder<UStaticMesh> Cube(TEXT("/Engine/BasicShapes/Cube.Cube"));
+	ObjectMesh = Cube.Object;
+	ObjectMaterial = nullptr;
+
+}
+
+AWarpBenchmarkDriver* AWarpBenchmarkDriver::Get(UWorld* World)
+{
+	TArray<AActor*> found;
+	UGameplayStatics::GetAllActorsOfClass(World, AWarpBenchmarkDriver::StaticClass(), found);
+	if (found.Num() > 0) {
+		return Cast<AWarpBenchmarkDriver>(found[0]);
+	}
+	return World->SpawnActor<AWarpBenchmarkDriver>();
+}
+
+void AWarpBenchmarkDriver::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (Mode == EWarpBenchMode::Replaying || Mode == EWarpBenchMode::Benchmark) {
+		SetFixedFrameRate(false);
+	}
+	Mode = EWarpBenchMode::Idle;
+
+	Super::EndPlay(EndPlayReason);
+}
+
+//Order this tick between the player controller and the hyper component
+bool AWarpBenchmarkDriver::FindTargets()
+{
+	Character = Cast<AWarpCharacter>(UGameplayStatics::GetPlayerPawn(GetWorld(), 0));
+
+	TArray<AActor*> found;
+	UGameplayStatics::GetAllActorsOfClass(GetWorld(), AWarpHyperComponent::StaticClass(), found);
+	Hyper = found.Num() > 0 ? Cast<AWarpHyperComponent>(found[0]) : nullptr;
+
+	APlayerController* Controller = GetWorld()->GetFirstPlayerController();
+	if (Controller) {
+		AddTickPrerequisiteActor(Controller);
+	}
+	if (Hyper) {
+		Hyper->AddTickPrerequisiteActor(this);
+	}
+
+	if (!Character || !Hyper) {
+		UE_LOG(LogWarpBench, Warning, TEXT("Benchmark needs a WarpCharacter and a WarpHyperComponent in the level"));
+		return false;
+	}
+	return true;
+}
+
+void AWarpBenchmarkDriver::SpawnScene(int32 Count)
+{
+	ClearScene();
+
+	FWarpGeometryPtr Geometry = GetWarpModule()->GetGeometry();
+	if (!Geometry.IsValid() || Geometry->tiles.Num() == 0) {
+		UE_LOG(LogWarpBench, Warning, TEXT("No tile map loaded, cannot spawn benchmark objects"));
+		return;
+	}
+
+	//Objects sit at random points inside random tiles, in the level units the hyper component reads
+	FRandomStream Rng(Seed);
+	float Scale = Geometry->curvature.CELL_WIDTH * 1000.0f;
+	FActorSpawnParameters Params;
+	Params.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	Spawned.Reserve(Count);
+	for (int32 i = 0; i < Count; i++) {
+		const FIntVector& Cell = Geometry->tiles.cell[Rng.RandRange(0, Geometry->tiles.Num() - 1)];
+		FVector Location = FVector(
+			Cell.X + Rng.FRandRange(0.1f, 0.9f),
+			Geometry->lattice3D ? Cell.Y + Rng.FRandRange(0.1f, 0.9f) : 0.0f,
+			Cell.Z + Rng.FRandRange(0.1f, 0.9f)) * Scale;
+
+		AStaticMeshActor* Object = GetWorld()->SpawnActor<AStaticMeshActor>(Location, FRotator::ZeroRotator, Params);
+		if (!Object) {
+			continue;
+		}
+		UStaticMeshComponent* Mesh = Object->GetStaticMeshComponent();
+		Mesh->SetMobility(EComponentMobility::Movable);
+		Mesh->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		Mesh->SetStaticMesh(ObjectMesh);
+		if (ObjectMaterial) {
+			Mesh->SetMaterial(0, ObjectMaterial);
+		}
+		Object->Tags.Add(TEXT("Hyperbolic"));
+		Spawned.Add(Object);
+	}
+
+	if (Hyper || FindTargets()) {
+		Hyper->GatherObjects();
+	}
+	UE_LOG(LogWarpBench, Log, TEXT("Spawned %d benchmark objects over %d tiles"), Spawned.Num(), Geometry->tiles.Num());
+}
+
+void AWarpBenchmarkDriver::ClearScene()
+{
+	for (AActor* Object : Spawned) {
+		if (IsValid(Object)) {
+			Object->Destroy();
+		}
+	}
+	bool bHadObjects = Spawned.Num() > 0;
+	Spawned.Reset();
+
+	if (bHadObjects && Hyper) {
+		Hyper->GatherObjects();
+	}
+}
+
+void AWarpBenchmarkDriver::StartRecording()
+{
+	if (Mode != EWarpBenchMode::Idle) {
+		UE_LOG(LogWarpBench, Warning, TEXT("Cannot record while a recording, replay or benchmark is running"));
+		return;
+	}
+	if (!FindTargets()) {
+		return;
+	}
+	Recording.Reset();
+	RecordStart = FPlatformTime::Seconds();
+	Mode = EWarpBenchMode::Recording;
+	UE_LOG(LogWarpBench, Log, TEXT("Recording input"));
+}
+
+bool AWarpBenchmarkDriver::StopRecording(const FString& Path)
+{
+	if (Mode != EWarpBenchMode::Recording) {
+		return false;
+	}
+	Mode = EWarpBenchMode::Idle;
+
+	double Elapsed = FPlatformTime::Seconds() - RecordStart;
+	Recording.FrameRate = Elapsed > 0.0 ? (float)(Recording.NumFrames() / Elapsed) : 60.0f;
+
+	bool bSaved = Recording.Save(Path);
+	UE_LOG(LogWarpBench, Log, TEXT("Recorded %d frames at %.1f fps to %s%s"), Recording.NumFrames(), Recording.FrameRate,
+		*FWarpInputRecording::ResolvePath(Path), bSaved ? TEXT("") : TEXT(" (save failed)"));
+	return bSaved;
+}
+
+bool AWarpBenchmarkDriver::StartReplay(const FString& Path)
+{
+	//Starting over a running mode would save its fixed time step as the one to restore
+	if (Mode != EWarpBenchMode::Idle) {
+		UE_LOG(LogWarpBench, Warning, TEXT("Cannot replay while a recording, replay or benchmark is running"));
+		return false;
+	}
+	if (!Recording.Load(Path) || Recording.NumFrames() == 0) {
+		UE_LOG(LogWarpBench, Warning, TEXT("Cannot replay %s"), *FWarpInputRecording::ResolvePath(Path));
+		return false;
+	}
+	if (!FindTargets()) {
+		return false;
+	}
+	Hyper->ResetSimulation();
+	SetFixedFrameRate(true);
+	Frame = 0;
+	Mode = EWarpBenchMode::Replaying;
+	return true;
+}
+
+bool AWarpBenchmarkDriver::RunBenchmark(const FString& Path, int32 Frames, const TArray<int32>& Counts)
+{
+	if (Mode != EWarpBenchMode::Idle) {
+		UE_LOG(LogWarpBench, Warning, TEXT("Cannot benchmark while a recording, replay or benchmark is running"));
+		return false;
+	}
+	if (!Recording.Load(Path) || Recording.NumFrames() == 0) {
+		UE_LOG(LogWarpBench, Warning, TEXT("Cannot replay %s"), *FWarpInputRecording::ResolvePath(Path));
+		return false;
+	}
+	if (!FindTargets() || Counts.Num() == 0) {
+		return false;
+	}
+
+	BenchCounts = Counts;
+	BenchIndex = 0;
+	BenchFrames = Frames > 0 ? Frames : Recording.NumFrames();
+	SetFixedFrameRate(true);
+	Mode = EWarpBenchMode::Benchmark;
+	BeginBenchmarkRun();
+	return true;
+}
+
+//Fixed engine delta time makes the simulation see the same steps on every replay
+void AWarpBenchmarkDriver::SetFixedFrameRate(bool bEnable)
+{
+	if (bEnable) {
+		bSavedFixedTimeStep = FApp::UseFixedTimeStep();
+		SavedFixedDeltaTime = FApp::GetFixedDeltaTime();
+		FApp::SetUseFixedTimeStep(true);
+		FApp::SetFixedDeltaTime(1.0 / FMath::Max(Recording.FrameRate, 1.0f));
+	}
+	else {
+		FApp::SetUseFixedTimeStep(bSavedFixedTimeStep);
+		FApp::SetFixedDeltaTime(SavedFixedDeltaTime);
+	}
+}
+
+void AWarpBenchmarkDriver::ApplyReplayFrame()
+{
+	FWarpInputFrame Input = Frame >= 0 ? Recording.Get(Frame % Recording.NumFrames()) : FWarpInputFrame();
+	Character->lastForward = Input.Forward;
+	Character->lastRight = Input.Right;
+	Character->lastPitch = Input.Pitch;
+	Character->lastYaw = Input.Yaw;
+}
+
+void AWarpBenchmarkDriver::BeginBenchmarkRun()
+{
+	SpawnScene(BenchCounts[BenchIndex]);
+	FrameMs.Reset(BenchFrames);
+	TickMs.Reset(BenchFrames);
+	Frame = -WarmupFrames;
+	LastFrameTime = FPlatformTime::Seconds();
+}
+
+static float Percentile(const TArray<float>& Sorted, float P)
+{
+	if (Sorted.Num() == 0) {
+		return 0.0f;
+	}
+	int32 ix = FMath::Clamp(FMath::CeilToInt(P * Sorted.Num()) - 1, 0, Sorted.Num() - 1);
+	return Sorted[ix];
+}
+
+static float Average(const TArray<float>& Values)
+{
+	double Sum = 0.0;
+	for (float v : Values) {
+		Sum += v;
+	}
+	return Values.Num() > 0 ? (float)(Sum / Values.Num()) : 0.0f;
+}
+
+void AWarpBenchmarkDriver::EndBenchmarkRun()
+{
+	FrameMs.Sort();
+	TickMs.Sort();
+
+	int32 Count = BenchCounts[BenchIndex];
+	float FrameAvg = Average(FrameMs);
+	float TickAvg = Average(TickMs);
+	UE_LOG(LogWarpBench, Log, TEXT("scene %6d objects, %d frames: frame avg %.2f p50 %.2f p99 %.2f max %.2f ms, hyper tick avg %.3f p99 %.3f ms"),
+		Count, FrameMs.Num(), FrameAvg, Percentile(FrameMs, 0.5f), Percentile(FrameMs, 0.99f), FrameMs.Last(), TickAvg, Percentile(TickMs, 0.99f));
+
+	//One line per run for tracking regressions across builds
+	FString CsvPath = FPaths::ProfilingDir() / TEXT("WarpBench.csv");
+	if (!IFileManager::Get().FileExists(*CsvPath)) {
+		FFileHelper::SaveStringToFile(TEXT("time,objects,frames,frame_avg_ms,frame_p50_ms,frame_p99_ms,frame_max_ms,tick_avg_ms,tick_p99_ms\n"), *CsvPath);
+	}
+	FString Line = FString::Printf(TEXT("%s,%d,%d,%.3f,%.3f,%.3f,%.3f,%.4f,%.4f\n"),
+		*FDateTime::Now().ToString(), Count, FrameMs.Num(), FrameAvg, Percentile(FrameMs, 0.5f), Percentile(FrameMs, 0.99f), FrameMs.Last(),
+		TickAvg, Percentile(TickMs, 0.99f));
+	FFileHelper::SaveStringToFile(Line, *CsvPath, FFileHelper::EEncodingOptions::AutoDetect, &IFileManager::Get(), FILEWRITE_Append);
+
+	BenchIndex++;
+	if (BenchIndex < BenchCounts.Num()) {
+		BeginBenchmarkRun();
+		return;
+	}
+
+	ClearScene();
+	SetFixedFrameRate(false);
+	Mode = EWarpBenchMode::Idle;
+	UE_LOG(LogWarpBench, Log, TEXT("Benchmark done, results in %s"), *CsvPath);
+}
+
+void AWarpBenchmarkDriver::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (!Character || !Hyper) {
+		return;
+	}
+
+	switch (Mode) {
+		case EWarpBenchMode::Recording: {
+			FWarpInputFrame Input;
+			Input.Forward = Character->GetLastForward();
+			Input.Right = Character->GetLastRight();
+			Input.Pitch = Character->GetLastPitch();
+			Input.Yaw = Character->GetLastYaw();
+			Recording.Add(Input);
+			break;
+		}
+
+		case EWarpBenchMode::Replaying: {
+			ApplyReplayFrame();
+			if (++Frame >= Recording.NumFrames()) {
+				SetFixedFrameRate(false);
+				Mode = EWarpBenchMode::Idle;
+				UE_LOG(LogWarpBench, Log, TEXT("Replay done, %d frames"), Frame);
+			}
+			break;
+		}
+
+		case EWarpBenchMode::Benchmark: {
+			//The hyper component ticks after this, so its cost is read a frame late
+			double Now = FPlatformTime::Seconds();
+			if (Frame > 0) {
+				FrameMs.Add((float)((Now - LastFrameTime) * 1000.0));
+				TickMs.Add((float)(Hyper->GetLastTickSeconds() * 1000.0));
+			}
+			LastFrameTime = Now;
+
+			//Warm up with no input, then replay from the origin
+			if (Frame == 0) {
+				Hyper->ResetSimulation();
+			}
+			ApplyReplayFrame();
+			if (++Frame > BenchFrames) {
+				EndBenchmarkRun();
+			}
+			break;
+		}
+
+		default:
+			break;
+	}
+}
@@ -0,0 +1,106 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "WarpInputRecording.h"
+#include "WarpBenchmarkDriver.generated.h"
+
+class AWarpCharacter;
+class AWarpHyperComponent;
+class UStaticMesh;
+class UMaterialInterface;
+
+enum class EWarpBenchMode : uint8
+{
+	Idle,
+	Recording,
+	Replaying,
+	Benchmark,
+};
+
+//Synthetic Hyperbolic scenes and recorded input for reproducible profiling
+//Ticks after the player controller and before the hyper component, so it sees this frame's
+//input when recording and overrides it before anything reads it when replaying
+UCLASS()
+class WARP_API AWarpBenchmarkDriver : public AActor
+{
+	GENERATED_BODY()
+
+	EWarpBenchMode Mode = EWarpBenchMode::Idle;
+	FWarpInputRecording Recording;
+	int32 Frame = 0;
+
+	UPROPERTY(Transient)
+	TArray<AActor*> Spawned;
+
+	UPROPERTY(Transient)
+	AWarpCharacter* Character = nullptr;
+
+	UPROPERTY(Transient)
+	AWarpHyperComponent* Hyper = nullptr;
+
+	//Benchmark runs, one per object count
+	TArray<int32> BenchCounts;
+	int32 BenchIndex = 0;
+	int32 BenchFrames = 0;
+	TArray<float> FrameMs;
+	TArray<float> TickMs;
+	double LastFrameTime = 0.0;
+
+	double RecordStart = 0.0;
+	bool bSavedFixedTimeStep = false;
+	double SavedFixedDeltaTime = 0.0;
+
+	bool FindTargets();
+	void ApplyReplayFrame();
+	void SetFixedFrameRate(bool bEnable);
+	void BeginBenchmarkRun();
+	void EndBenchmarkRun();
+
+public:
+	AWarpBenchmarkDriver();
+
+	/** Mesh of spawned benchmark objects */
+	UPROPERTY(EditAnywhere, Category = Benchmark)
+	UStaticMesh* ObjectMesh;
+
+	/** Material with the hyperRot parameters, the mesh material when unset */
+	UPROPERTY(EditAnywhere, Category = Benchmark)
+	UMaterialInterface* ObjectMaterial;
+
+	/** Seed for object placement, the same seed gives the same scene */
+	UPROPERTY(EditAnywhere, Category = Benchmark)
+	int32 Seed = 1234;
+
+	/** Frames skipped before measuring each run */
+	UPROPERTY(EditAnywhere, Category = Benchmark)
+	int32 WarmupFrames = 30;
+
+	//Find the driver in the world, spawning one if needed
+	static AWarpBenchmarkDriver* Get(UWorld* World);
+
+	//Spawn Count Hyperbolic-tagged objects over random tiles of the active map
+	void SpawnScene(int32 Count);
+	void ClearScene();
+
+	//Record the player's input every frame, the average frame rate is kept with it
+	void StartRecording();
+	bool StopRecording(const FString& Path);
+
+	//Play a recording back at a fixed step of its frame rate
+	bool StartReplay(const FString& Path);
+
+	//Replay a recording once per object count and log frame time, p99 and hyper Tick cost
+	//Results are appended to Saved/Profiling/WarpBench.csv
+	bool RunBenchmark(const FString& Path, int32 Frames, const TArray<int32>& Counts);
+
+	EWarpBenchMode GetMode() const { return Mode; }
+
+protected:
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+public:
+	virtual void Tick(float DeltaTime) override;
+};
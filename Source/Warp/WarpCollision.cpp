@@ -0,0 +1,244 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "WarpCollision.h"
+
+//Face order matches FWarpGeometry::neighbours, R L U D B F
+static const int32 FACE_AXIS[FWarpGeometry::FACES] = { 0, 0, 2, 2, 1, 1 };
+static const float FACE_SIGN[FWarpGeometry::FACES] = { 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f };
+
+void FWarpCollision::Reset(FWarpGeometryPtr InGeometry, const GyroVectorD& sim)
+{
+	geometry = InGeometry;
+	tile = INDEX_NONE;
+	numCandidates = 0;
+	if (!geometry.IsValid() || geometry->neighbours.Num() == 0) {
+		return;
+	}
+
+	numFaces = geometry->lattice3D ? 6 : 4;
+
+	//The midpoint between neighbour centres, Klein coordinates are doubled except in flat space
+	face = geometry->curvature.K == 0.0f ? geometry->curvature.CELL_WIDTH * 0.5f : geometry->curvature.CELL_WIDTH;
+
+	//Gyrations keep norms, so the centre of the player's tile is within a corner's distance of the player's distance from the origin
+	//Only tiles in that shell are tested, closed maps are small and a player outside every tile checks them all
+	const FWarpTileStore& tiles = geometry->tiles;
+	const float k = geometry->curvature.K;
+	GyroVectorD view = View(sim);
+	float best = FLT_MAX;
+	if (k <= 0.0f) {
+		double klein = face * FMath::Sqrt(numFaces * 0.5);
+		double corner = FWarpSupertiles::Distance(k, k == 0.0f ? klein : klein / (1.0 + sqrt(1.0 + k * klein * klein))) + 1e-3;
+		double at = FWarpSupertiles::Distance(k, view.vec.Size());
+		float outer = (float)FWarpSupertiles::Radius(k, at + corner);
+		float inner = (float)FWarpSupertiles::Radius(k, FMath::Max(at - corner, 0.0));
+		int32 end = tiles.WithinRadius(outer);
+		for (int32 t = 0; t < end; t++) {
+			float r = sqrMagnitude(tiles.vec[t]);
+			if (r > outer * outer || r < inner * inner) {
+				continue;
+			}
+			float depth = Depth(LocalKlein(t, view));
+			if (depth < best) {
+				best = depth;
+				tile = t;
+			}
+		}
+	}
+	if (best > face) {
+		for (int32 t = 0; t < tiles.Num(); t++) {
+			float depth = Depth(LocalKlein(t, view));
+			if (depth < best) {
+				best = depth;
+				tile = t;
+			}
+		}
+	}
+	Gather();
+}
+
+void FWarpCollision::Rebind(FWarpGeometryPtr InGeometry)
+{
+	geometry = InGeometry;
+	if (tile != INDEX_NONE && geometry.IsValid() && tile < geometry->tiles.Num() && geometry->neighbours.Num() > 0) {
+		Gather();
+	}
+	else {
+		tile = INDEX_NONE;
+		numCandidates = 0;
+	}
+}
+
+void FWarpCollision::Gather()
+{
+	numCandidates = 0;
+	candidates[numCandidates++] = tile;
+	for (int32 f = 0; f < numFaces; f++) {
+		int32 n = geometry->Neighbour(tile, f);
+		if (n != INDEX_NONE) {
+			candidates[numCandidates++] = n;
+		}
+	}
+}
+
+//Player position in the Klein frame of tile t, the player sits at the view origin
+FVector FWarpCollision::LocalKlein(int32 t, const GyroVectorD& view) const
+{
+	return PoincareToKlein(-add(geometry->tiles.GV(t), view).vec);
+}
+
+//How far out of the tile cube a point is, at most face inside it
+float FWarpCollision::Depth(const FVector& k) const
+{
+	float depth = FMath::Max(FMath::Abs(k.X), FMath::Abs(k.Z));
+	return geometry->lattice3D ? FMath::Max(depth, FMath::Abs(k.Y)) : depth;
+}
+
+FWarpSweepHit FWarpCollision::Sweep(const GyroVectorD& sim, FVector displacement) const
+{
+	FWarpSweepHit best;
+	if (tile == INDEX_NONE) {
+		return best;
+	}
+
+	GyroVectorD view0 = View(sim);
+	GyroVectorD view1 = View(Step(sim, displacement));
+
+	//Walls are moved in by the radius, faces are widened by it so corners have no gaps
+	const float limit = face * (1.0f - Radius);
+	const float extent = face * (1.0f + Radius);
+
+	for (int32 c = 0; c < numCandidates; c++) {
+		int32 t = candidates[c];
+		FVector k0 = LocalKlein(t, view0);
+		FVector k1 = LocalKlein(t, view1);
+
+		for (int32 f = 0; f < numFaces; f++) {
+			if (geometry->Neighbour(t, f) != INDEX_NONE) {
+				continue;
+			}
+			int32 axis = FACE_AXIS[f];
+			float a0 = FACE_SIGN[f] * k0[axis];
+			float a1 = FACE_SIGN[f] * k1[axis];
+
+			//Only moves ending past the wall and heading into it
+			if (a1 <= limit || a1 <= a0) {
+				continue;
+			}
+			float time = a0 >= limit ? 0.0f : (limit - a0) / (a1 - a0);
+			if (time >= best.Time) {
+				continue;
+			}
+
+			FVector p = k0 + (k1 - k0) * time;
+			bool inside = true;
+			for (int32 other = 0; other < 3; other++) {
+				if (other != axis && (other != 1 || geometry->lattice3D) && FMath::Abs(p[other]) > extent) {
+					inside = false;
+				}
+			}
+			if (inside) {
+				best.bHit = true;
+				best.Time = time;
+				best.Tile = t;
+				best.Face = f;
+			}
+		}
+	}
+	return best;
+}
+
+//Displacement that moves the player to a Klein point of tile t
+//One damped Gauss-Newton step from the blocked displacement, moves are short enough for it to be close
+FVector FWarpCollision::Solve(const GyroVectorD& sim, FVector displacement, int32 t, const FVector& target) const
+{
+	const float h = 1e-4f;
+	FVector k = LocalKlein(t, View(Step(sim, displacement)));
+	FVector J[3];
+	for (int32 j = 0; j < 3; j++) {
+		FVector d = displacement;
+		d[j] += h;
+		J[j] = (LocalKlein(t, View(Step(sim, d))) - k) / h;
+	}
+
+	//Clamped axes of the move give zero columns, damping keeps the system solvable
+	FVector r = target - k;
+	FVector A[3];
+	FVector b;
+	for (int32 i = 0; i < 3; i++) {
+		A[i] = FVector(FVector::DotProduct(J[0], J[i]), FVector::DotProduct(J[1], J[i]), FVector::DotProduct(J[2], J[i]));
+		b[i] = FVector::DotProduct(J[i], r);
+	}
+	float lambda = 1e-6f * (A[0].X + A[1].Y + A[2].Z) + 1e-12f;
+	A[0].X += lambda;
+	A[1].Y += lambda;
+	A[2].Z += lambda;
+
+	//Cramer's rule on the columns
+	float det = FVector::DotProduct(A[0], FVector::CrossProduct(A[1], A[2]));
+	if (FMath::Abs(det) < 1e-20f) {
+		return FVector(0, 0, 0);
+	}
+	FVector x(
+		FVector::DotProduct(b, FVector::CrossProduct(A[1], A[2])),
+		FVector::DotProduct(A[0], FVector::CrossProduct(b, A[2])),
+		FVector::DotProduct(A[0], FVector::CrossProduct(A[1], b)));
+	return displacement + x / det;
+}
+
+FVector FWarpCollision::Slide(const GyroVectorD& sim, FVector displacement)
+{
+	double start = FPlatformTime::Seconds();
+	lastHits = 0;
+
+	FVector d = displacement;
+	for (int32 i = 0; i < MaxSlides && tile != INDEX_NONE; i++) {
+		FWarpSweepHit hit = Sweep(sim, d);
+		if (!hit.bHit) {
+			break;
+		}
+		lastHits++;
+
+		//Out of slides, stop at the wall
+		if (i == MaxSlides - 1) {
+			d *= hit.Time;
+			break;
+		}
+
+		//Keep the motion along the wall and drop the part into it, in the frame of the tile that was hit
+		int32 axis = FACE_AXIS[hit.Face];
+		FVector target = LocalKlein(hit.Tile, View(Step(sim, d)));
+		target[axis] = FACE_SIGN[hit.Face] * face * (1.0f - Radius) * 0.999f;
+		d = Solve(sim, d, hit.Tile, target);
+	}
+
+	lastQuerySeconds = FPlatformTime::Seconds() - start;
+	return d;
+}
+
+void FWarpCollision::Update(const GyroVectorD& sim)
+{
+	if (tile == INDEX_NONE) {
+		return;
+	}
+
+	double start = FPlatformTime::Seconds();
+	GyroVectorD view = View(sim);
+	float best = Depth(LocalKlein(tile, view));
+	if (best > face) {
+		int32 next = tile;
+		for (int32 c = 1; c < numCandidates; c++) {
+			float depth = Depth(LocalKlein(candidates[c], view));
+			if (depth < best) {
+				best = depth;
+				next = candidates[c];
+			}
+		}
+		if (next != tile) {
+			tile = next;
+			Gather();
+		}
+	}
+	lastQuerySeconds += FPlatformTime::Seconds() - start;
+}
@@ -0,0 +1,81 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Warp.h"
+
+using namespace WarpMath;
+
+//Sim state after moving by a displacement, and the view transform a sim state is rendered with
+typedef GyroVectorD (*FWarpStepFunc)(const GyroVectorD& from, FVector displacement);
+typedef GyroVectorD (*FWarpViewFunc)(const GyroVectorD& sim);
+
+//Earliest wall crossed by a move, Time is the fraction of the move made before contact
+struct FWarpSweepHit
+{
+	bool bHit = false;
+	float Time = 1.0f;
+	int32 Tile = INDEX_NONE;
+	int32 Face = INDEX_NONE;
+};
+
+//Player collision against the walls of the tiling
+//Every tile is a cube in its own Klein frame, where walls are flat and a short move is a straight segment,
+//so a sweep is segment/plane tests against the faces of nearby tiles that have no neighbour
+class WARP_API FWarpCollision
+{
+public:
+	//Player radius as a fraction of the tile half-width
+	float Radius = 0.15f;
+
+	//Walls a move can slide along before it stops at the next one
+	int32 MaxSlides = 3;
+
+	FWarpCollision(FWarpStepFunc InStep, FWarpViewFunc InView) : Step(InStep), View(InView) {}
+
+	//Start tracking the player in a geometry, the tile is found by a full scan
+	void Reset(FWarpGeometryPtr InGeometry, const GyroVectorD& sim);
+
+	//Move to a geometry that extends the current one with the same tile indices, keeping the tile
+	void Rebind(FWarpGeometryPtr InGeometry);
+
+	//Displacement that keeps a move out of walls by sliding along them
+	FVector Slide(const GyroVectorD& sim, FVector displacement);
+
+	//First wall crossed when moving from sim by displacement
+	FWarpSweepHit Sweep(const GyroVectorD& sim, FVector displacement) const;
+
+	//Follow the player into the tile it moved to
+	void Update(const GyroVectorD& sim);
+
+	int32 GetTile() const { return tile; }
+	int32 GetLastHits() const { return lastHits; }
+	double GetLastQuerySeconds() const { return lastQuerySeconds; }
+
+	//Position in the Klein frame of the current tile
+	FVector GetLocalKlein(const GyroVectorD& sim) const { return LocalKlein(tile, View(sim)); }
+
+private:
+	FWarpStepFunc Step;
+	FWarpViewFunc View;
+
+	FWarpGeometryPtr geometry;
+	int32 tile = INDEX_NONE;
+	int32 numFaces = 4;
+
+	//Klein distance from a tile centre to its faces
+	float face = 1.0f;
+
+	//Current tile and the tiles across its faces
+	int32 candidates[1 + FWarpGeometry::FACES];
+	int32 numCandidates = 0;
+
+	int32 lastHits = 0;
+	double lastQuerySeconds = 0.0;
+
+	void Gather();
+	FVector LocalKlein(int32 t, const GyroVectorD& view) const;
+	float Depth(const FVector& k) const;
+	FVector Solve(const GyroVectorD& sim, FVector displacement, int32 t, const FVector& target) const;
+};
@@ -1,19 +1,19 @@
-// Copyright Epic Games, Inc. All Rights Reserved.
-
-#pragma once
-
-#include "CoreMinimal.h"
-#include "GameFramework/GameModeBase.h"
-#include "WarpGameMode.generated.h"
-
-UCLASS(minimalapi)
-class AWarpGameMode : public AGameModeBase
-{
-	GENERATED_BODY()
-
-public:
-	AWarpGameMode();
-};
-
-
-
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/GameModeBase.h"
+#include "WarpGameMode.generated.h"
+
+UCLASS(minimalapi)
+class AWarpGameMode : public AGameModeBase
+{
+	GENERATED_BODY()
+
+public:
+	AWarpGameMode();
+};
+
+
+
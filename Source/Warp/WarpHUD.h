@@ -1,25 +1,25 @@
-// Copyright Epic Games, Inc. All Rights Reserved.
-
-#pragma once 
-
-#include "CoreMinimal.h"
-#include "GameFramework/HUD.h"
-#include "WarpHUD.generated.h"
-
-UCLASS()
-class AWarpHUD : public AHUD
-{
-	GENERATED_BODY()
-
-public:
-	AWarpHUD();
-
-	/** Primary draw call for the HUD */
-	virtual void DrawHUD() override;
-
-private:
-	/** Crosshair asset pointer */
-	class UTexture2D* CrosshairTex;
-
-};
-
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once 
+
+#include "CoreMinimal.h"
+#include "GameFramework/HUD.h"
+#include "WarpHUD.generated.h"
+
+UCLASS()
+class AWarpHUD : public AHUD
+{
+	GENERATED_BODY()
+
+public:
+	AWarpHUD();
+
+	/** Primary draw call for the HUD */
+	virtual void DrawHUD() override;
+
+private:
+	/** Crosshair asset pointer */
+	class UTexture2D* CrosshairTex;
+
+};
+
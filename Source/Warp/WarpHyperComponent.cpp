@@ -1,257 +1,928 @@
-// Fill out your copyright notice in the Description page of Project Settings.
-
-
-#include "WarpHyperComponent.h"
-
-// Sets default values for this component's properties
-AWarpHyperComponent::AWarpHyperComponent(const FObjectInitializer& ObjectInitializer)
-{
-
-	PrimaryActorTick.bCanEverTick = true;
-	
-}
-
-//Lock and unlock rotations
-void AWarpHyperComponent::Lock() 
-{
-	isLocked = true;
-	LOCKED_MAX_X = 10.0f;
-	LOCKED_MAX_Z = 10.0f;
-	lockedRotationX = 0.0f;
-	lockedRotationZ = 0.0f;
-	targetRotationX = rotationX;
-	targetRotationZ = rotationZ;
-	targetQuaternion = xzQuaternion;
-}
-
-void AWarpHyperComponent::Unlock()
-{
-	isLocked = false;
-}
-
-// Called when the game starts
-void AWarpHyperComponent::BeginPlay()
-{
-	Super::BeginPlay();
-
-	mainModule = &FModuleManager::GetModuleChecked<FWarpGameModule>("Warp");
-
-	TArray<AActor*> objects;
-	UGameplayStatics::GetAllActorsWithTag(GetWorld(), tag, objects);
-
-	TArray<FVector> objPositions;
-
-	for (AActor* obj : objects)
-	{
-		TArray<UStaticMeshComponent*> Components;
-		obj->GetComponents<UStaticMeshComponent>(Components);
-		
-		for (int32 i = 0; i < Components.Num(); i++)
-		{
-			UStaticMeshComponent* StaticMeshComponent = Components[i];
-			UMaterialInterface* StaticMaterial = StaticMeshComponent->GetMaterial(i);
-			UMaterialInstanceDynamic* DynMaterial = UMaterialInstanceDynamic::Create(StaticMaterial, nullptr);
-			StaticMeshComponent->SetMaterial(i, DynMaterial);
-			objPositions.Add(StaticMeshComponent->GetComponentLocation());
-			dynMaterials.Add(DynMaterial);
-			mcomp.Add(StaticMeshComponent);
-		
-		}
-	}
-
-	TArray<WorldTile>* tiles = mainModule->GetTilemap();
-
-	float CW = mainModule->GetCellW();
-
-	//Apply position shift
-	for (int i = 0; i < objPositions.Num(); i++)
-	{
-		FVector pos = objPositions[i] / 1000;
-		bool is_found = false;
-		for (WorldTile tile : *tiles)
-		{
-
-			if ((tile.xz.X <= pos.X && pos.X < tile.xz.X + CW) && (tile.xz.Y <= pos.Z && pos.Z < tile.xz.Y + CW)) {
-				localGVByPos.Add(i, tile.gv);
-				is_found = true;
-				break;
-			}
-		}
-		if (!is_found) {
-			localGVByPos.Add(i, GyroVectorD());
-		}
-	}
-
-	height *= mainModule->GetKlein() / 0.5774f;
-	
-}
-
-float ModPi(float a, float b) {
-	if (a - b > 180.0f) {
-		a -= 360.0f;
-	}
-	else if (a - b < -180.0f) {
-		a += 360.0f;
-	}
-	return a;
-}
-
-// Called every frame
-// Update parameters for materials
-void AWarpHyperComponent::Tick(float DeltaTime)
-{
-	Super::Tick(DeltaTime);
-
-	FString Output;
-	FVector4 pos;
-
-	if (actor) {
-
-		//Update raw rotations
-		if (IsLocked()) {
-			//Update raw rotations
-			FVector2D lookXY = FVector2D(actor->GetLastPitch(), actor->GetLastYaw());
-
-			rotationZ += lookXY.Y * SENSITIVITY_LOOK;
-			rotationX += lookXY.X * SENSITIVITY_LOOK;
-
-			//Clamp raw rotations to valid ranges
-			float lockedMinZ = std::max(-LOCKED_MAX_Z, -90.0f - rotationZ);
-			float lockedMaxZ = std::min(LOCKED_MAX_Z, 90.0f - rotationZ);
-			lockedRotationZ = clamp(lockedMinZ, lockedMaxZ, lockedRotationZ);
-			lockedRotationX = clamp(-LOCKED_MAX_X, LOCKED_MAX_X, lockedRotationX);
-
-			//Apply locked look smoothing (time dependent)
-			rotationX = ModPi(rotationX, targetRotationX);
-			float smooth_look_locked = 0.0f;
-
-			rotationX = rotationX * smooth_look_locked + targetRotationX * (1 - smooth_look_locked);
-			rotationZ = rotationZ * smooth_look_locked + targetRotationZ * (1 - smooth_look_locked);
-		}
-		else {
-
-			//Update if there was any locked rotation
-			rotationX += lockedRotationX;
-			rotationZ += lockedRotationZ;
-			lockedRotationX = 0.0f;
-			lockedRotationZ = 0.0f;
-
-			//Update raw rotations
-			FVector2D lookXY = FVector2D(actor->GetLastPitch(), actor->GetLastYaw());
-			rotationZ += lookXY.Y * SENSITIVITY_LOOK;
-			rotationX += lookXY.X * SENSITIVITY_LOOK;
-
-		}
-
-
-		//Clamp raw rotations to valid ranges
-		rotationZ = clamp(-90.0f, 90.0f, rotationZ);
-		while (rotationX > 180.0f) { rotationX -= 360.0f; }
-		while (rotationX < -180.0f) { rotationX += 360.0f; }
-
-		//Apply smoothing (time dependent)
-		smoothRotationX = ModPi(smoothRotationX, rotationX + lockedRotationX);
-		float clampedRotationZ = clamp(-90.0f, 90.0f, rotationZ + lockedRotationZ);
-		float smooth_look = pow(2.0f, -DeltaTime / 0.025f);
-		smoothRotationX = smoothRotationX * smooth_look + (rotationX + lockedRotationX) * (1 - smooth_look);
-		smoothRotationZ = smoothRotationZ * smooth_look + clampedRotationZ * (1 - smooth_look);
-
-		//Get the rotation you will be at next as a Quaternion
-		FQuat zQuaternion;
-		FQuat xQuaternion;
-		if (IsLocked()) {
-			zQuaternion = Quaternion.AngleAxis(smoothRotationZ, Vector3.left);
-			xQuaternion = Quaternion.AngleAxis(smoothRotationX, Vector3.up);
-			xzQuaternion = Quaternion.Slerp(targetQuaternion, xzQuaternion, smooth_look);
-			focusRot = xzQuaternion * xQuaternion * zQuaternion;
-		}
-		else {
-			zQuaternion = Quaternion.AngleAxis(smoothRotationZ * Time.deltaTime * 100.0f, Vector3.left);
-			xQuaternion = Quaternion.AngleAxis(smoothRotationX * Time.deltaTime * 100.0f, Vector3.up);
-			xzQuaternion *= xQuaternion * zQuaternion;
-			rotationX = 0.0f;
-			rotationZ = 0.0f;
-			focusRot = xzQuaternion;
-		}
-		
-		xQuaternion = xzQuaternion;
-		xzQuaternion = xQuaternion * zQuaternion;
-
-		actor->AddControllerPitchInput(actor->GetLastPitch());
-		actor->AddControllerYawInput(actor->GetLastYaw());
-
-		//Always work to dampen movement, even when locked.
-		float smooth_move = pow(2.0f, -DeltaTime / LAG_MOVE);
-		velocity.X *= smooth_move;
-		velocity.Z *= smooth_move;
-
-		FVector displacement = FVector(0, 0, 0);
-		if (!IsLocked()) {
-
-			FVector2D move = FVector2D(actor->GetLastRight(), actor->GetLastForward());
-
-			inputDelta = ClampMagnitude(FVector(move.X, move.Y, 0.0f), 1.0f);
-
-			inputDelta = xQuaternion * inputDelta;
-
-			inputDelta *= walkingSpeed * height;
-
-			velocity += inputDelta * (1 - smooth_move);
-			
-			//Apply gravity
-			velocity.Z += GRAVITY * height * DeltaTime;
-			inputDelta = HyperTranslate(velocity * DeltaTime);
-
-			displacement = inputDelta * 0.9f;
-
-			velocity = FVector(0, 0, 0);
-
-			velocity.Z = std::max(velocity.Z, 0.0f);
-
-			//Map that world displacement to a hyperbolic one (in high precision since this only happens once per frame)
-			FVector outputDelta = displacement;
-			GyroVectorD gv = worldGV;
-			gv = sub(gv, outputDelta);
-			gv.vec.Z = std::min(gv.vec.Z, 0.0f);
-			gv.AlignUpVector();
-			worldGV = gv;
-
-			float headDelta = 0.0f;
-
-			camHeight = TanK(height + headDelta);
-
-		}
-	}
-	else {
-		TArray<AActor*> objects;
-		TSubclassOf<AWarpCharacter> classToFind;
-		classToFind = AWarpCharacter::StaticClass();
-		UGameplayStatics::GetAllActorsOfClass(GetWorld(), classToFind, objects);
-	}
-	
-	//Update world gyrovector
-	FVector4 displacement = FVector4(0, 0, 0, 0);
-	FVector4 outputDelta = displacement;
-	worldGV = sub(outputDelta, worldGV);
-	worldGV.vec.Y = std::min(worldGV.vec.Y, 0.0f);
-	worldGV.AlignUpVector();
-
-	//Set parameters for each non-euqlidean material
-	for (int32 i = 0; i < dynMaterials.Num(); i++)
-	{
-		localGV = localGVByPos[i];
-		composedGV = add(localGV, worldGV);
-		FMatrix mat = composedGV.ToMatrix();
-
-		UMaterialInstanceDynamic* materialInstanceDynamic = dynMaterials[i];
-
-		materialInstanceDynamic->SetVectorParameterValue(hyp0, FLinearColor(mat.M[0][0], mat.M[0][1], mat.M[0][2], mat.M[0][3]));
-		materialInstanceDynamic->SetVectorParameterValue(hyp1, FLinearColor(mat.M[1][0], mat.M[1][1], mat.M[1][2], mat.M[1][3]));
-		materialInstanceDynamic->SetVectorParameterValue(hyp2, FLinearColor(mat.M[2][0], mat.M[2][1], mat.M[2][2], mat.M[2][3]));
-		materialInstanceDynamic->SetVectorParameterValue(hyp3, FLinearColor(mat.M[3][0], mat.M[3][1], mat.M[3][2], mat.M[3][3]));
-		materialInstanceDynamic->SetScalarParameterValue("N", (float) mainModule->GetN());
-		materialInstanceDynamic->SetScalarParameterValue("camHeight", camHeight);
-	}
-	
-}
-
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "WarpHyperComponent.h"
+#include "Async/Async.h"
+#include "EngineUtils.h"
+#include "Engine/StaticMesh.h"
+#include "StaticMeshResources.h"
+#include "Algo/BinarySearch.h"
+#include "Algo/StableSort.h"
+
+//Debug check that steady-state frames stay off the heap, swaps GMalloc around every Tick while set
+static TAutoConsoleVariable<int32> CVarCountTickAllocs(
+	TEXT("Warp.CountTickAllocs"),
+	0,
+	TEXT("Count heap allocations in each hyper component Tick, 2 also logs every Tick that allocates"));
+
+//Switch every hyper component to a geometry loaded with Warp.PreloadGeometry
+static FAutoConsoleCommand SwitchGeometryCommand(
+	TEXT("Warp.SwitchGeometry"),
+	TEXT("Warp.SwitchGeometry <N> <3D 0|1>"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World) {
+		if (Args.Num() < 2 || !World) {
+			return;
+		}
+		for (TActorIterator<AWarpHyperComponent> It(World); It; ++It) {
+			if (!It->SwitchGeometry(FCString::Atoi(*Args[0]), FCString::Atoi(*Args[1]) != 0)) {
+				UE_LOG(LogUnrealMath, Warning, TEXT("Geometry %s is not loaded, preload it first"), *Args[0]);
+			}
+		}
+	}));
+
+//Material instance counters of every hyper component
+static FAutoConsoleCommand MaterialStatsCommand(
+	TEXT("Warp.MaterialStats"),
+	TEXT("Log live, pooled and created material instances of hyperbolic objects"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World) {
+		if (!World) {
+			return;
+		}
+		for (TActorIterator<AWarpHyperComponent> It(World); It; ++It) {
+			UE_LOG(LogUnrealMath, Log, TEXT("%d objects: %d material instances live (%.1f KB), %d pooled, %d created, %d hidden"),
+				It->NumObjects(), It->GetLiveMaterials(), It->GetMaterialBytes() / 1024.0, It->GetPooledMaterials(),
+				It->GetMaterialsCreated(), It->GetNumCulled());
+		}
+	}));
+
+//Horizon test of an object, decided by its supertile or left to the object
+static const int32 HORIZON_OUT = 0;
+static const int32 HORIZON_IN = 1;
+static const int32 HORIZON_TEST = 2;
+
+//Local gyrovector of each object from the tile under it, (0) outside the map
+static TArray<GyroVectorD> ResolveLocalGVs(const FWarpGeometry* geometry, const TArray<FVector>& positions)
+{
+	TArray<GyroVectorD> localGVs;
+	localGVs.SetNumUninitialized(positions.Num());
+	for (int i = 0; i < positions.Num(); i++)
+	{
+		int32 ix = geometry ? geometry->FindTileAt(positions[i] / 1000) : INDEX_NONE;
+		localGVs[i] = ix != INDEX_NONE ? geometry->tiles.GV(ix) : GyroVectorD();
+	}
+	return localGVs;
+}
+
+// Sets default values for this component's properties
+AWarpHyperComponent::AWarpHyperComponent(const FObjectInitializer& ObjectInitializer)
+{
+
+	PrimaryActorTick.bCanEverTick = true;
+	SetSimRate(SIM_RATE);
+	
+}
+
+void AWarpHyperComponent::SetSimRate(float Hz)
+{
+	SIM_RATE = FMath::Max(Hz, 1.0f);
+	simStep = 1.0f / SIM_RATE;
+	//Damping per step is fixed, so it is computed once instead of per frame
+	simSmoothMove = pow(2.0f, -simStep / LAG_MOVE);
+}
+
+void AWarpHyperComponent::SetMoveInput(FVector2D move, FQuat rotation)
+{
+	moveInput = move;
+	moveRotation = rotation;
+}
+
+//Catch up with real time in whole steps, the remainder is kept for interpolation
+void AWarpHyperComponent::AdvanceSimulation(float DeltaTime)
+{
+	//Drop time that cannot be caught up on (hitches, breakpoints) so a frame never runs more than MAX_SIM_STEPS
+	simAccumulator = FMath::Min(simAccumulator + DeltaTime, MAX_SIM_STEPS * simStep);
+	while (simAccumulator >= simStep) {
+		prevSimGV = simGV;
+		SimulateStep(simStep);
+		simAccumulator -= simStep;
+	}
+}
+
+//Run steps back to back, for headless runs or simulating ahead of rendering
+void AWarpHyperComponent::RunSimulation(float Seconds)
+{
+	int32 steps = FMath::FloorToInt(Seconds / simStep);
+	for (int32 i = 0; i < steps; i++) {
+		prevSimGV = simGV;
+		SimulateStep(simStep);
+	}
+}
+
+//One movement step of dt seconds, always called with the fixed step
+void AWarpHyperComponent::SimulateStep(float dt)
+{
+	//Always work to dampen movement, even when locked.
+	velocity.X *= simSmoothMove;
+	velocity.Z *= simSmoothMove;
+
+	FVector displacement = FVector(0, 0, 0);
+	if (!IsLocked()) {
+
+		inputDelta = ClampMagnitude(FVector(moveInput.X, moveInput.Y, 0.0f), 1.0f);
+
+		inputDelta = moveRotation * inputDelta;
+
+		inputDelta *= walkingSpeed * height;
+
+		velocity += inputDelta * (1 - simSmoothMove);
+		
+		//Apply gravity
+		velocity.Z += GRAVITY * height * dt;
+		inputDelta = HyperTranslate(velocity * dt);
+
+		displacement = inputDelta * 0.9f;
+
+		velocity = FVector(0, 0, 0);
+
+		velocity.Z = std::max(velocity.Z, 0.0f);
+
+		//Map that world displacement to a hyperbolic one (in high precision since this only happens once per step)
+		FVector outputDelta = displacement;
+		if (bCollide) {
+			collision.Radius = CollisionRadius;
+			outputDelta = collision.Slide(simGV, outputDelta);
+		}
+		simGV = StepGV(simGV, outputDelta);
+		collision.Update(simGV);
+
+		float headDelta = 0.0f;
+
+		camHeight = TanK(height + headDelta);
+
+	}
+}
+
+GyroVectorD AWarpHyperComponent::StepGV(const GyroVectorD& from, FVector displacement)
+{
+	GyroVectorD gv = sub(from, displacement);
+	gv.vec.Z = std::min(gv.vec.Z, 0.0f);
+	gv.AlignUpVector();
+	return gv;
+}
+
+GyroVectorD AWarpHyperComponent::ViewGV(const GyroVectorD& sim)
+{
+	GyroVectorD gv = sub(FVector(0, 0, 0), sim);
+	gv.vec.Y = std::min(gv.vec.Y, 0.0f);
+	gv.AlignUpVector();
+	return gv;
+}
+
+//Lock and unlock rotations
+void AWarpHyperComponent::Lock() 
+{
+	isLocked = true;
+	LOCKED_MAX_X = 10.0f;
+	LOCKED_MAX_Z = 10.0f;
+	lockedRotationX = 0.0f;
+	lockedRotationZ = 0.0f;
+	targetRotationX = rotationX;
+	targetRotationZ = rotationZ;
+	targetQuaternion = xzQuaternion;
+}
+
+void AWarpHyperComponent::Unlock()
+{
+	isLocked = false;
+}
+
+bool AWarpHyperComponent::SwitchGeometry(int type, bool lattice3D)
+{
+	FWarpGeometryPtr next = mainModule ? mainModule->FindGeometry(type, lattice3D) : nullptr;
+	if (!next.IsValid()) {
+		return false;
+	}
+	if (next == geometry || next == nextGeometry) {
+		return true;
+	}
+
+	ResolveAsync(next);
+	return true;
+}
+
+void AWarpHyperComponent::ResolveAsync(FWarpGeometryPtr next)
+{
+	TArray<FVector> positions;
+	positions.SetNumUninitialized(objects.Num());
+	for (int32 i = 0; i < objects.Num(); i++) {
+		positions[i] = objects[i].position;
+	}
+	nextGeometry = next;
+	nextLocalGVs = Async(EAsyncExecution::ThreadPool, [next, positions]() {
+		return ResolveLocalGVs(next.Get(), positions);
+	});
+}
+
+//Collect Hyperbolic-tagged meshes and resolve their tiles, again whenever objects are added
+void AWarpHyperComponent::GatherObjects()
+{
+	TArray<UStaticMeshComponent*> components;
+	TArray<int32> slots;
+	CollectObjects(&components, &slots);
+
+	ClearObjects();
+	for (int32 i = 0; i < components.Num(); i++) {
+		AddObject(components[i], slots[i], components[i]->GetComponentLocation());
+	}
+
+	//Apply position shift, cells are looked up by lattice coordinate in 2D and 3D maps
+	geometry = mainModule->GetGeometry();
+	ResolveTiles();
+	collision.Reset(geometry, simGV);
+
+	//A pending switch was resolved for the old object list
+	if (nextGeometry.IsValid()) {
+		ResolveAsync(nextGeometry);
+	}
+}
+
+//Static meshes of every Hyperbolic actor, each drives its first material slot
+void AWarpHyperComponent::CollectObjects(TArray<UStaticMeshComponent*>* components, TArray<int32>* slots)
+{
+	TArray<AActor*> actors;
+	UGameplayStatics::GetAllActorsWithTag(GetWorld(), tag, actors);
+
+	for (AActor* obj : actors)
+	{
+		TArray<UStaticMeshComponent*> Components;
+		obj->GetComponents<UStaticMeshComponent>(Components);
+		
+		for (int32 i = 0; i < Components.Num(); i++)
+		{
+			components->Add(Components[i]);
+			slots->Add(0);
+		}
+	}
+}
+
+void AWarpHyperComponent::ClearObjects()
+{
+	//Objects hidden by culling are shown again until their tiles are resolved
+	for (FWarpObjectState& object : objects) {
+		if (!object.visible && IsValid(object.component)) {
+			object.component->SetVisibility(true);
+		}
+	}
+	objects.Reset();
+	movables.Reset();
+	objectOrder.Reset();
+	supertileStates.Reset();
+	vertexCaches.Reset();
+}
+
+//Add a mesh, its material instance is made when it is first visible unless it already has one
+int32 AWarpHyperComponent::AddObject(UStaticMeshComponent* StaticMeshComponent, int32 slot, FVector position)
+{
+	UMaterialInterface* StaticMaterial = StaticMeshComponent->GetMaterial(slot);
+	UMaterialInstanceDynamic* DynMaterial = Cast<UMaterialInstanceDynamic>(StaticMaterial);
+	FWarpObjectState object;
+	object.component = StaticMeshComponent;
+	object.material = DynMaterial;
+	object.baseMaterial = DynMaterial ? DynMaterial->Parent : StaticMaterial;
+	object.position = position;
+	object.slot = slot;
+	object.movable = StaticMeshComponent->Mobility == EComponentMobility::Movable;
+	int32 ix = objects.Add(object);
+	if (object.movable) {
+		movables.Add(ix);
+	}
+	return ix;
+}
+
+//Actors destroyed at runtime leave objects behind, indices into objects are rebuilt without them
+bool AWarpHyperComponent::CompactObjects()
+{
+	int32 kept = 0;
+	for (int32 i = 0; i < objects.Num(); i++) {
+		FWarpObjectState& object = objects[i];
+		if (!IsValid(object.component)) {
+			if (object.material && materialPool.Num() < MaterialPoolSize) {
+				materialPool.Add(object.material);
+			}
+			continue;
+		}
+		if (kept != i) {
+			objects[kept] = MoveTemp(object);
+		}
+		kept++;
+	}
+	if (kept == objects.Num()) {
+		return false;
+	}
+
+	objects.SetNum(kept, false);
+	movables.Reset();
+	for (int32 i = 0; i < objects.Num(); i++) {
+		if (objects[i].movable) {
+			movables.Add(i);
+		}
+	}
+	vertexCaches.Reset();
+	BuildSupertileStates();
+
+	//A pending switch was resolved for the old object list
+	if (nextGeometry.IsValid()) {
+		ResolveAsync(nextGeometry);
+	}
+	return true;
+}
+
+//Give a visible object a material instance, from the pool when one with the same parent is there
+void AWarpHyperComponent::AcquireMaterial(int32 ix)
+{
+	FWarpObjectState& object = objects[ix];
+	if (!IsValid(object.component)) {
+		return;
+	}
+	UMaterialInterface* parent = object.baseMaterial;
+	UMaterialInstanceDynamic* DynMaterial = nullptr;
+	for (int32 i = materialPool.Num() - 1; i >= 0; i--) {
+		if (materialPool[i] && materialPool[i]->Parent == parent) {
+			DynMaterial = materialPool[i];
+			materialPool.RemoveAtSwap(i, 1, false);
+			break;
+		}
+	}
+	if (!DynMaterial) {
+		DynMaterial = UMaterialInstanceDynamic::Create(parent, this);
+		materialsCreated++;
+	}
+	object.component->SetMaterial(object.slot, DynMaterial);
+	object.material = DynMaterial;
+}
+
+//Put the original material back and keep the instance for another object
+void AWarpHyperComponent::ReleaseMaterial(int32 ix)
+{
+	FWarpObjectState& object = objects[ix];
+	UMaterialInstanceDynamic* DynMaterial = object.material;
+	object.material = nullptr;
+	if (IsValid(object.component)) {
+		object.component->SetMaterial(object.slot, object.baseMaterial);
+	}
+	if (materialPool.Num() < MaterialPoolSize) {
+		materialPool.Add(DynMaterial);
+	}
+}
+
+int32 AWarpHyperComponent::GetLiveMaterials()
+{
+	int32 live = 0;
+	for (const FWarpObjectState& object : objects) {
+		live += object.material ? 1 : 0;
+	}
+	return live;
+}
+
+SIZE_T AWarpHyperComponent::GetMaterialBytes()
+{
+	SIZE_T bytes = 0;
+	for (const FWarpObjectState& object : objects) {
+		if (object.material) {
+			bytes += object.material->GetResourceSizeBytes(EResourceSizeMode::EstimatedTotal);
+		}
+	}
+	return bytes;
+}
+
+//Mesh vertices are read once per object, the cache redoes the transform only when add(local, world) changed
+const TArray<FVector>* AWarpHyperComponent::GetWarpedVertices(int32 ix)
+{
+	if (!objects.IsValidIndex(ix)) {
+		return nullptr;
+	}
+	const FWarpObjectState& object = objects[ix];
+	FWarpVertexCache* cache = vertexCaches.Find(ix);
+	if (!cache) {
+		UStaticMesh* mesh = IsValid(object.component) ? object.component->GetStaticMesh() : nullptr;
+		if (!mesh || !mesh->RenderData.IsValid() || mesh->RenderData->LODResources.Num() == 0) {
+			return nullptr;
+		}
+		//Outside the editor the vertex data stays on the CPU only with Allow CPU Access set on the mesh
+		const FPositionVertexBuffer& buffer = mesh->RenderData->LODResources[0].VertexBuffers.PositionVertexBuffer;
+		if (!buffer.GetVertexData() || buffer.GetNumVertices() == 0) {
+			return nullptr;
+		}
+		const FTransform& transform = object.component->GetComponentTransform();
+		TArray<FVector> unit;
+		unit.SetNumUninitialized(buffer.GetNumVertices());
+		for (uint32 i = 0; i < buffer.GetNumVertices(); i++) {
+			unit[i] = transform.TransformVector(buffer.VertexPosition(i)) / 1000;
+		}
+		cache = &vertexCaches.Add(ix);
+		cache->SetVertices(unit.GetData(), unit.Num(), bWarpTanKHeight);
+	}
+	return &cache->Warp(object.localGV, worldGV);
+}
+
+//Objects from the editor bake, false when there is none for the active geometry
+bool AWarpHyperComponent::LoadBakedObjects()
+{
+	geometry = mainModule->GetGeometry();
+	if (BakedObjects.Num() == 0 || !geometry.IsValid() || geometry->type != BakedType ||
+		geometry->lattice3D != bBakedLattice3D || geometry->tiles.Num() != BakedTiles || BakedLayout != FWarpTileStore::LAYOUT ||
+		BakedMapHash != (int32)geometry->tiles.Hash()) {
+		return false;
+	}
+
+	ClearObjects();
+	objects.Reserve(BakedObjects.Num());
+	for (const FWarpBakedObject& baked : BakedObjects) {
+		if (!IsValid(baked.Component)) {
+			continue;
+		}
+		int32 ix = AddObject(baked.Component, baked.MaterialIndex, baked.Position);
+		objects[ix].localGV = GyroVectorD(baked.Vec, baked.Gyr);
+		objects[ix].tile = baked.Tile;
+		objects[ix].cell = geometry->CellAt(baked.Position / 1000);
+	}
+	BuildSupertileStates();
+	collision.Reset(geometry, simGV);
+	return true;
+}
+
+void AWarpHyperComponent::BakeObjects()
+{
+	FWarpGeometryPtr baked = GetWarpModule()->GetGeometry();
+	Modify();
+	BakedObjects.Reset();
+	if (!baked.IsValid()) {
+		return;
+	}
+
+	TArray<UStaticMeshComponent*> components;
+	TArray<int32> slots;
+	CollectObjects(&components, &slots);
+	for (int32 i = 0; i < components.Num(); i++) {
+		FWarpBakedObject object;
+		object.Component = components[i];
+		object.MaterialIndex = slots[i];
+		object.Position = components[i]->GetComponentLocation();
+		object.Tile = baked->FindTileAt(object.Position / 1000);
+		GyroVectorD gv = object.Tile != INDEX_NONE ? baked->tiles.GV(object.Tile) : GyroVectorD();
+		object.Vec = gv.vec;
+		object.Gyr = gv.gyr;
+		BakedObjects.Add(object);
+	}
+	BakedType = baked->type;
+	bBakedLattice3D = baked->lattice3D;
+	BakedTiles = baked->tiles.Num();
+	BakedLayout = FWarpTileStore::LAYOUT;
+	BakedMapHash = (int32)baked->tiles.Hash();
+}
+
+#if WITH_EDITOR
+void AWarpHyperComponent::PreSave(const ITargetPlatform* TargetPlatform)
+{
+	Super::PreSave(TargetPlatform);
+
+	//Saving or cooking the level refreshes the bake, so it never goes stale against moved objects
+	UWorld* World = GetWorld();
+	if (bBakeOnSave && World && !World->IsGameWorld()) {
+		BakeObjects();
+	}
+}
+#endif
+
+//Tile and local gyrovector of each object in the current geometry, everything starts visible
+//localGVs comes from a switch resolved on the thread pool, otherwise the tiles are searched here
+void AWarpHyperComponent::ResolveTiles(const TArray<GyroVectorD>* localGVs)
+{
+	for (int32 i = 0; i < objects.Num(); i++) {
+		FWarpObjectState& object = objects[i];
+		object.cell = geometry.IsValid() ? geometry->CellAt(object.position / 1000) : FIntVector::ZeroValue;
+		object.tile = geometry.IsValid() ? geometry->FindTileAt(object.position / 1000) : INDEX_NONE;
+		if (localGVs && localGVs->IsValidIndex(i)) {
+			object.localGV = (*localGVs)[i];
+		}
+		else {
+			object.localGV = object.tile != INDEX_NONE ? geometry->tiles.GV(object.tile) : GyroVectorD();
+		}
+		if (!object.visible && IsValid(object.component)) {
+			object.component->SetVisibility(true);
+		}
+		object.visible = true;
+	}
+	BuildSupertileStates();
+}
+
+//Only a cell change costs more than the position read and the cell it falls in
+void AWarpHyperComponent::UpdateMovables()
+{
+	numRetiled = 0;
+	if (!bTrackMovables || !geometry.IsValid() || nextGeometry.IsValid()) {
+		return;
+	}
+	for (int32 ix : movables) {
+		FWarpObjectState& object = objects[ix];
+		if (!IsValid(object.component)) {
+			continue;
+		}
+		FVector position = object.component->GetComponentLocation();
+		FIntVector cell = geometry->CellAt(position / 1000);
+		object.position = position;
+		if (cell != object.cell) {
+			MoveObject(ix, cell);
+			numRetiled++;
+		}
+	}
+}
+
+//A step into the next cell follows the face crossed, so the object stays on its side where several tiles share a cell
+//Jumps, and steps into a wall, look the cell up
+void AWarpHyperComponent::MoveObject(int32 ix, FIntVector cell)
+{
+	static const FIntVector faces[] = {
+		FIntVector(1, 0, 0), FIntVector(-1, 0, 0), FIntVector(0, 0, 1), FIntVector(0, 0, -1), FIntVector(0, 1, 0), FIntVector(0, -1, 0),
+	};
+	FWarpObjectState& object = objects[ix];
+	FIntVector delta = cell - object.cell;
+	int32 tile = INDEX_NONE;
+	for (int32 f = 0; f < FWarpGeometry::FACES && object.tile != INDEX_NONE; f++) {
+		if (delta == faces[f]) {
+			tile = geometry->Neighbour(object.tile, f);
+			break;
+		}
+	}
+	if (tile == INDEX_NONE) {
+		const int32* found = geometry->cell_tiles.Find(cell);
+		tile = found ? *found : INDEX_NONE;
+	}
+	object.cell = cell;
+	object.tile = tile;
+	object.localGV = tile != INDEX_NONE ? geometry->tiles.GV(tile) : GyroVectorD();
+}
+
+//Objects in the order of their tiles' supertiles, so each supertile's objects are one range of objectOrder
+void AWarpHyperComponent::BuildSupertileStates()
+{
+	objectOrder.Reset();
+	supertileStates.Reset();
+	for (int32 i = 0; i < objects.Num(); i++) {
+		objectOrder.Add(i);
+	}
+	if (!geometry.IsValid() || !geometry->supertiles.IsValid()) {
+		return;
+	}
+
+	const FWarpSupertiles& supertiles = geometry->supertiles;
+	//Movable objects change tile, so they are kept out with the ones off the map
+	auto rankOf = [this, &supertiles](int32 i) {
+		int32 tile = objects[i].tile;
+		return supertiles.rank.IsValidIndex(tile) && !objects[i].movable ? supertiles.rank[tile] : MAX_int32;
+	};
+	Algo::StableSortBy(objectOrder, rankOf);
+
+	supertileStates.SetNum(supertiles.nodes.Num());
+	for (int32 i = 0; i < supertiles.nodes.Num(); i++) {
+		const FWarpSupertile& node = supertiles.nodes[i];
+		supertileStates[i].begin = Algo::LowerBoundBy(objectOrder, node.first, rankOf);
+		supertileStates[i].end = Algo::LowerBoundBy(objectOrder, node.first + node.count, rankOf);
+	}
+}
+
+//Back to the origin at rest, so replays start from the same state
+void AWarpHyperComponent::ResetSimulation()
+{
+	simGV = GyroVectorD();
+	prevSimGV = GyroVectorD();
+	worldGV = GyroVectorD();
+	simAccumulator = 0.0f;
+	velocity = FVector(0, 0, 0);
+	inputDelta = FVector(0, 0, 0);
+	moveInput = FVector2D(0, 0);
+	rotationX = rotationZ = 0.0f;
+	smoothRotationX = smoothRotationZ = 0.0f;
+	lockedRotationX = lockedRotationZ = 0.0f;
+	collision.Reset(geometry, simGV);
+}
+
+// Called when the game starts
+void AWarpHyperComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	mainModule = &FModuleManager::GetModuleChecked<FWarpGameModule>("Warp");
+
+	if (!LoadBakedObjects()) {
+		GatherObjects();
+	}
+
+	height = BASE_HEIGHT * mainModule->GetKlein() / 0.5774f;
+
+	//Find the character once, later ones are bound as they spawn instead of searched for every frame
+	for (TActorIterator<AWarpCharacter> It(GetWorld()); It; ++It) {
+		BindCharacter(*It);
+		break;
+	}
+	actorSpawnedHandle = GetWorld()->AddOnActorSpawnedHandler(FOnActorSpawned::FDelegate::CreateUObject(this, &AWarpHyperComponent::OnActorSpawned));
+	
+}
+
+void AWarpHyperComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	GetWorld()->RemoveOnActorSpawnedHandler(actorSpawnedHandle);
+	BindCharacter(nullptr);
+	allocCount.Reset();
+	Super::EndPlay(EndPlayReason);
+}
+
+void AWarpHyperComponent::BindCharacter(AWarpCharacter* character)
+{
+	if (actor) {
+		actor->OnDestroyed.RemoveDynamic(this, &AWarpHyperComponent::OnCharacterDestroyed);
+	}
+	actor = character;
+	if (actor) {
+		actor->OnDestroyed.AddDynamic(this, &AWarpHyperComponent::OnCharacterDestroyed);
+	}
+}
+
+void AWarpHyperComponent::OnActorSpawned(AActor* spawned)
+{
+	AWarpCharacter* character = Cast<AWarpCharacter>(spawned);
+	if (character && !actor) {
+		BindCharacter(character);
+	}
+}
+
+void AWarpHyperComponent::OnCharacterDestroyed(AActor* destroyed)
+{
+	if (destroyed == actor) {
+		BindCharacter(nullptr);
+	}
+}
+
+float ModPi(float a, float b) {
+	if (a - b > 180.0f) {
+		a -= 360.0f;
+	}
+	else if (a - b < -180.0f) {
+		a += 360.0f;
+	}
+	return a;
+}
+
+// Called every frame
+// Update parameters for materials
+void AWarpHyperComponent::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	double tickStart = FPlatformTime::Seconds();
+	const int32 countAllocs = CVarCountTickAllocs.GetValueOnGameThread();
+	if (countAllocs > 0 && !allocCount.IsSet()) {
+		allocCount.Emplace();
+	}
+	else if (countAllocs <= 0 && allocCount.IsSet()) {
+		allocCount.Reset();
+		lastTickAllocs = 0;
+	}
+	const int64 allocStart = allocCount.IsSet() ? allocCount->Owner() : 0;
+
+	CompactObjects();
+
+	//A lazily generated map grew a ring, tiles keep their indices so only objects off the old edge change
+	FWarpGeometryPtr grown = mainModule->UpdateLazyMap(collision.GetTile());
+	if (grown.IsValid() && !nextGeometry.IsValid()) {
+		geometry = grown;
+		ResolveTiles();
+		collision.Rebind(geometry);
+	}
+
+	//Finish a geometry switch once its tiles are resolved, curvature, tiles and objects change in the same frame
+	if (nextGeometry.IsValid() && nextLocalGVs.IsReady()) {
+		TArray<GyroVectorD> localGVs = nextLocalGVs.Get();
+		nextLocalGVs = TFuture<TArray<GyroVectorD>>();
+		geometry = nextGeometry;
+		nextGeometry.Reset();
+		mainModule->ActivateGeometry(geometry);
+		height = BASE_HEIGHT * mainModule->GetKlein() / 0.5774f;
+		ResolveTiles(&localGVs);
+		collision.Reset(geometry, simGV);
+	}
+
+	if (actor) {
+
+		//Update raw rotations
+		if (IsLocked()) {
+			//Update raw rotations
+			FVector2D lookXY = FVector2D(actor->GetLastPitch(), actor->GetLastYaw());
+
+			rotationZ += lookXY.Y * SENSITIVITY_LOOK;
+			rotationX += lookXY.X * SENSITIVITY_LOOK;
+
+			//Clamp raw rotations to valid ranges
+			float lockedMinZ = std::max(-LOCKED_MAX_Z, -90.0f - rotationZ);
+			float lockedMaxZ = std::min(LOCKED_MAX_Z, 90.0f - rotationZ);
+			lockedRotationZ = clamp(lockedMinZ, lockedMaxZ, lockedRotationZ);
+			lockedRotationX = clamp(-LOCKED_MAX_X, LOCKED_MAX_X, lockedRotationX);
+
+			//Apply locked look smoothing (time dependent)
+			rotationX = ModPi(rotationX, targetRotationX);
+			float smooth_look_locked = 0.0f;
+
+			rotationX = rotationX * smooth_look_locked + targetRotationX * (1 - smooth_look_locked);
+			rotationZ = rotationZ * smooth_look_locked + targetRotationZ * (1 - smooth_look_locked);
+		}
+		else {
+
+			//Update if there was any locked rotation
+			rotationX += lockedRotationX;
+			rotationZ += lockedRotationZ;
+			lockedRotationX = 0.0f;
+			lockedRotationZ = 0.0f;
+
+			//Update raw rotations
+			FVector2D lookXY = FVector2D(actor->GetLastPitch(), actor->GetLastYaw());
+			rotationZ += lookXY.Y * SENSITIVITY_LOOK;
+			rotationX += lookXY.X * SENSITIVITY_LOOK;
+
+		}
+
+
+		//Clamp raw rotations to valid ranges
+		rotationZ = clamp(-90.0f, 90.0f, rotationZ);
+		while (rotationX > 180.0f) { rotationX -= 360.0f; }
+		while (rotationX < -180.0f) { rotationX += 360.0f; }
+
+		//Apply smoothing (time dependent)
+		smoothRotationX = ModPi(smoothRotationX, rotationX + lockedRotationX);
+		float clampedRotationZ = clamp(-90.0f, 90.0f, rotationZ + lockedRotationZ);
+		float smooth_look = pow(2.0f, -DeltaTime / 0.025f);
+		smoothRotationX = smoothRotationX * smooth_look + (rotationX + lockedRotationX) * (1 - smooth_look);
+		smoothRotationZ = smoothRotationZ * smooth_look + clampedRotationZ * (1 - smooth_look);
+
+		//Get the rotation you will be at next as a Quaternion
+		FQuat zQuaternion;
+		FQuat xQuaternion;
+		if (IsLocked()) {
+			zQuaternion = Quaternion.AngleAxis(smoothRotationZ, Vector3.left);
+			xQuaternion = Quaternion.AngleAxis(smoothRotationX, Vector3.up);
+			xzQuaternion = Quaternion.Slerp(targetQuaternion, xzQuaternion, smooth_look);
+			focusRot = xzQuaternion * xQuaternion * zQuaternion;
+		}
+		else {
+			zQuaternion = Quaternion.AngleAxis(smoothRotationZ * Time.deltaTime * 100.0f, Vector3.left);
+			xQuaternion = Quaternion.AngleAxis(smoothRotationX * Time.deltaTime * 100.0f, Vector3.up);
+			xzQuaternion *= xQuaternion * zQuaternion;
+			rotationX = 0.0f;
+			rotationZ = 0.0f;
+			focusRot = xzQuaternion;
+		}
+		
+		xQuaternion = xzQuaternion;
+		xzQuaternion = xQuaternion * zQuaternion;
+
+		actor->AddControllerPitchInput(actor->GetLastPitch());
+		actor->AddControllerYawInput(actor->GetLastYaw());
+
+		//Movement input is sampled per frame and consumed by the fixed-rate simulation
+		SetMoveInput(FVector2D(actor->GetLastRight(), actor->GetLastForward()), xQuaternion);
+	}
+
+	//Step movement at the simulation rate and render between its last two states
+	AdvanceSimulation(DeltaTime);
+	GyroVectorD simView = SlerpReverse(prevSimGV, simGV, simAccumulator / simStep);
+	
+	//Update world gyrovector
+	worldGV = ViewGV(simView);
+
+	//Props that moved out of their cell take the gyrovector of their new tile
+	UpdateMovables();
+
+	//Set parameters for each non-euqlidean material
+	float k = getK();
+	FVector4 rows[4];
+	//Objects in tiles the player's tile cannot see are hidden and not updated
+	int32 playerTile = collision.GetTile();
+	const FWarpVisibility* pvs = bCullInvisible && playerTile != INDEX_NONE && geometry.IsValid() && geometry->visibility.IsValid() ? &geometry->visibility : nullptr;
+	numCulled = 0;
+	supertilesVisited = 0;
+	tickCount++;
+
+	//Past the horizon an object is smaller than a pixel, only hyperbolic space has one
+	const float horizonSq = k < 0.0f ? HorizonRadius * HorizonRadius / -k : FLT_MAX;
+	const float now = GetWorld()->GetTimeSeconds();
+	const float n = (float) mainModule->GetN();
+
+	//horizon is HORIZON_IN or HORIZON_OUT when the object's supertile was decided as a whole
+	auto updateObject = [&](int32 i, int32 horizon) {
+		FWarpObjectState& object = objects[i];
+		if (!IsValid(object.component)) {
+			return;
+		}
+		const GyroVectorD& local = object.localGV;
+		bool visible = horizon != HORIZON_OUT && (!pvs || object.tile == INDEX_NONE || pvs->Visible(playerTile, object.tile));
+		if (visible && horizon == HORIZON_TEST && horizonSq < FLT_MAX) {
+			visible = sqrMagnitude(add(local, worldGV).vec) < horizonSq;
+		}
+		if (visible != object.visible) {
+			object.visible = visible;
+			object.component->SetVisibility(visible);
+			object.hiddenSince = now;
+		}
+		if (!visible) {
+			numCulled++;
+			if (object.material && now - object.hiddenSince > MaterialReleaseSeconds) {
+				ReleaseMaterial(i);
+			}
+			return;
+		}
+		if (!object.material) {
+			AcquireMaterial(i);
+		}
+
+		ComposeToMatrixRows(k, local, worldGV, rows);
+
+		UMaterialInstanceDynamic* materialInstanceDynamic = object.material;
+
+		materialInstanceDynamic->SetVectorParameterValue(hyp0, FLinearColor(rows[0].X, rows[0].Y, rows[0].Z, rows[0].W));
+		materialInstanceDynamic->SetVectorParameterValue(hyp1, FLinearColor(rows[1].X, rows[1].Y, rows[1].Z, rows[1].W));
+		materialInstanceDynamic->SetVectorParameterValue(hyp2, FLinearColor(rows[2].X, rows[2].Y, rows[2].Z, rows[2].W));
+		materialInstanceDynamic->SetVectorParameterValue(hyp3, FLinearColor(rows[3].X, rows[3].Y, rows[3].Z, rows[3].W));
+		materialInstanceDynamic->SetScalarParameterValue(paramN, n);
+		materialInstanceDynamic->SetScalarParameterValue(paramCamHeight, camHeight);
+	};
+
+	const FWarpSupertiles* supertiles = bSupertileCulling && horizonSq < FLT_MAX && geometry.IsValid() &&
+		supertileStates.Num() == geometry->supertiles.nodes.Num() && supertileStates.Num() > 0 ? &geometry->supertiles : nullptr;
+	if (!supertiles) {
+		for (int32 i = 0; i < objects.Num(); i++) {
+			updateObject(i, HORIZON_TEST);
+		}
+	}
+	else {
+		//Supertiles wholly past or within the horizon are decided from their bounds, only ones across it are opened
+		//One that stays past the horizon is skipped until its objects' materials are due for release
+		const double horizon = FWarpSupertiles::Distance(k, HorizonRadius / sqrt(-k));
+		const double slack = 1e-3;
+		supertileStack.Reset();
+		supertileStack.Add(0);
+		while (supertileStack.Num() > 0) {
+			int32 ix = supertileStack.Pop(false);
+			const FWarpSupertile& node = supertiles->nodes[ix];
+			FWarpSupertileState& state = supertileStates[ix];
+			if (state.begin == state.end) {
+				continue;
+			}
+			supertilesVisited++;
+
+			int32 result = HORIZON_OUT;
+			if (node.unbounded < node.count) {
+				double d = FWarpSupertiles::Distance(k, sqrt(sqrMagnitude(add(node.centre, worldGV).vec)));
+				if (d - node.radius > horizon + slack) {
+					result = HORIZON_OUT;
+				}
+				else if (node.unbounded == 0 && d + node.radius < horizon - slack) {
+					result = HORIZON_IN;
+				}
+				else if (node.numChildren > 0) {
+					for (int32 c = node.child; c < node.child + node.numChildren; c++) {
+						supertileStack.Add(c);
+					}
+					continue;
+				}
+				else {
+					result = HORIZON_TEST;
+				}
+			}
+
+			if (result == HORIZON_OUT) {
+				bool steady = state.outTick != 0 && state.outTick == tickCount - 1;
+				state.outTick = tickCount;
+				if (!steady) {
+					state.hiddenSince = now;
+					state.released = false;
+				}
+				else if (state.released || now - state.hiddenSince <= MaterialReleaseSeconds) {
+					numCulled += state.end - state.begin;
+					continue;
+				}
+				else {
+					state.released = true;
+				}
+			}
+			for (int32 j = state.begin; j < state.end; j++) {
+				updateObject(objectOrder[j], result);
+			}
+		}
+
+		//Objects off the map and movable ones are not in any supertile
+		for (int32 j = supertileStates[0].end; j < objectOrder.Num(); j++) {
+			updateObject(objectOrder[j], HORIZON_TEST);
+		}
+	}
+
+	lastTickSeconds = FPlatformTime::Seconds() - tickStart;
+
+	//Frames that acquire materials, switch geometry or grow the map allocate, steady ones should not
+	if (allocCount.IsSet()) {
+		lastTickAllocs = allocCount->Owner() - allocStart;
+		if (countAllocs > 1 && lastTickAllocs > 0) {
+			UE_LOG(LogUnrealMath, Log, TEXT("Hyper component Tick made %lld allocations"), lastTickAllocs);
+		}
+	}
+	
+}
+
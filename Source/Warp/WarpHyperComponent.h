@@ -1,92 +1,352 @@
-// Fill out your copyright notice in the Description page of Project Settings.
-
-#pragma once
-
-#include "CoreMinimal.h"
-#include "Components/ActorComponent.h"
-#include "Materials/MaterialInstanceConstant.h"
-#include "Materials/MaterialInstanceDynamic.h"
-#include "UObject/UObjectGlobals.h"
-#include "Kismet/GameplayStatics.h"
-#include "Misc/DateTime.h"
-#include "Camera/CameraComponent.h"
-#include "Warp.h"
-#include "WarpCharacter.h"
-#include <algorithm>
-#include "WarpHyperComponent.generated.h"
-
-using namespace WarpMath;
-
-UCLASS()
-class WARP_API AWarpHyperComponent : public AActor
-{
-	GENERATED_BODY()
-
-    TArray<UMaterialInstanceDynamic*> dynMaterials;
-    TMap<int32, GyroVectorD> localGVByPos;
-
-	TArray<UStaticMeshComponent*> mcomp;
-
-    FWarpGameModule* mainModule;
-
-    FName tag = TEXT("Hyperbolic");
-
-    FName hyp0 = TEXT("hyperRot0");
-    FName hyp1 = TEXT("hyperRot1");
-    FName hyp2 = TEXT("hyperRot2");
-    FName hyp3 = TEXT("hyperRot3");
-
-    GyroVectorD worldGV = GyroVectorD(FVector4(0,0,0,0));
-    GyroVectorD localGV = GyroVectorD(FVector4(0, 0, 0, 0));
-    GyroVectorD composedGV = GyroVectorD(FVector4(0, 0, 0, 0));
-
-    AWarpCharacter* actor;
-
-	float SENSITIVITY_LOOK = 1.0f;
-
-	float rotationX = 0.0f;
-	float rotationZ = 0.0f;
-	float lockedRotationX = 0.0f;
-	float lockedRotationZ = 0.0f;
-
-	float smoothRotationX = 0.0f;
-	float smoothRotationZ = 0.0f;
-	
-	float LAG_MOVE = 0.05f;
-
-	float walkingSpeed = 2.0f;
-	float height = 0.1f;
-	float GRAVITY = -4.0f;
-
-	FQuat xzQuaternion = FQuat(0, 0, 0, 0);
-	float LOCKED_MAX_X = 10.0f;
-	float LOCKED_MAX_Z = 10.0f;
-
-	FVector velocity = FVector(0, 0, 0);
-	FVector inputDelta = FVector(0, 0, 0);
-
-	float targetRotationX = 0.0f;
-	float targetRotationZ = 0.0f;
-	FQuat targetQuaternion = FQuat(0, 0, 0, 0);
-
-	float camHeight = 0.0f;
-
-	bool isLocked = false;
-
-public:	
-	// Sets default values for this component's properties
-	AWarpHyperComponent(const FObjectInitializer& ObjectInitializer);
-	bool IsLocked() { return isLocked; };
-	void Lock();
-	void Unlock();
-
-protected:
-	// Called when the game starts
-	virtual void BeginPlay() override;
-
-public:	
-	// Called every frame
-	virtual void Tick(float DeltaTime) override;
-
-		
-};
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "Materials/MaterialInstanceConstant.h"
+#include "Materials/MaterialInstanceDynamic.h"
+#include "UObject/UObjectGlobals.h"
+#include "Kismet/GameplayStatics.h"
+#include "Misc/DateTime.h"
+#include "Camera/CameraComponent.h"
+#include "Async/Future.h"
+#include "Warp.h"
+#include "WarpCharacter.h"
+#include "WarpCollision.h"
+#include "WarpVertexWarp.h"
+#include "WarpAllocCounter.h"
+#include <algorithm>
+#include "WarpHyperComponent.generated.h"
+
+using namespace WarpMath;
+
+//Tile data of one hyperbolic mesh, baked in the editor so level start skips the actor and tile searches
+USTRUCT()
+struct FWarpBakedObject
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	UStaticMeshComponent* Component = nullptr;
+
+	UPROPERTY()
+	int32 MaterialIndex = 0;
+
+	UPROPERTY()
+	FVector Position = FVector::ZeroVector;
+
+	UPROPERTY()
+	int32 Tile = INDEX_NONE;
+
+	//Local gyrovector of the tile, (0) outside the map
+	UPROPERTY()
+	FVector Vec = FVector::ZeroVector;
+
+	UPROPERTY()
+	FQuat Gyr = FQuat(0, 0, 0, 0);
+};
+
+//Per-object state of the hyper component
+//Material instances are made on first visibility, material holds null until then
+//The slot and material they replace are kept to restore when the instance is released
+USTRUCT()
+struct FWarpObjectState
+{
+	GENERATED_BODY()
+
+	GyroVectorD localGV;
+
+	//Seen by GC, so a component destroyed at runtime reads as invalid instead of dangling
+	UPROPERTY()
+	UStaticMeshComponent* component = nullptr;
+
+	UPROPERTY()
+	UMaterialInstanceDynamic* material = nullptr;
+
+	UPROPERTY()
+	UMaterialInterface* baseMaterial = nullptr;
+
+	FVector position = FVector::ZeroVector;
+	int32 slot = 0;
+	//Tile under the object and whether it is drawn, for the potentially visible set
+	int32 tile = INDEX_NONE;
+	//Cell the tile was resolved for, a Movable object is moved to another tile when it leaves it
+	FIntVector cell = FIntVector::ZeroValue;
+	bool movable = false;
+	float hiddenSince = 0.0f;
+	bool visible = true;
+};
+
+//Per-supertile state of the hyper component, its objects are objectOrder[begin, end)
+//outTick is the last Tick that found the whole supertile past the horizon
+struct FWarpSupertileState
+{
+	int32 begin = 0;
+	int32 end = 0;
+	uint32 outTick = 0;
+	float hiddenSince = 0.0f;
+	bool released = false;
+};
+
+UCLASS()
+class WARP_API AWarpHyperComponent : public AActor
+{
+	GENERATED_BODY()
+
+    //Everything Tick reads or writes per object, in one contiguous array
+    UPROPERTY(Transient)
+    TArray<FWarpObjectState> objects;
+    int32 numCulled = 0;
+
+    //Objects with Movable mobility, checked against their cells every Tick
+    TArray<int32> movables;
+    int32 numRetiled = 0;
+    void UpdateMovables();
+    void MoveObject(int32 ix, FIntVector cell);
+
+    //Drop objects whose component was destroyed, true when any were
+    bool CompactObjects();
+
+    //Objects sorted by supertile, and the supertiles Tick walks down to find the ones across the horizon
+    TArray<int32> objectOrder;
+    TArray<FWarpSupertileState> supertileStates;
+    TArray<int32> supertileStack;
+    int32 supertilesVisited = 0;
+    uint32 tickCount = 0;
+    void BuildSupertileStates();
+
+    //Released instances waiting for reuse, held here so they are not collected
+    UPROPERTY(Transient)
+    TArray<UMaterialInstanceDynamic*> materialPool;
+    int32 materialsCreated = 0;
+
+    void AcquireMaterial(int32 ix);
+    void ReleaseMaterial(int32 ix);
+
+    //CPU-warped meshes by object, made on the first GetWarpedVertices for that object
+    TMap<int32, FWarpVertexCache> vertexCaches;
+
+    //Geometry the objects are resolved in, and the one waiting for its tiles during a switch
+    FWarpGeometryPtr geometry;
+    FWarpGeometryPtr nextGeometry;
+    TFuture<TArray<GyroVectorD>> nextLocalGVs;
+
+    FWarpGameModule* mainModule;
+
+    FName tag = TEXT("Hyperbolic");
+
+    FName hyp0 = TEXT("hyperRot0");
+    FName hyp1 = TEXT("hyperRot1");
+    FName hyp2 = TEXT("hyperRot2");
+    FName hyp3 = TEXT("hyperRot3");
+    FName paramN = TEXT("N");
+    FName paramCamHeight = TEXT("camHeight");
+
+    GyroVectorD worldGV = GyroVectorD(FVector4(0,0,0,0));
+
+    //Bound on BeginPlay or when a character spawns, cleared when it is destroyed
+    AWarpCharacter* actor = nullptr;
+    FDelegateHandle actorSpawnedHandle;
+
+    void BindCharacter(AWarpCharacter* character);
+    void OnActorSpawned(AActor* spawned);
+    UFUNCTION()
+    void OnCharacterDestroyed(AActor* destroyed);
+
+	float SENSITIVITY_LOOK = 1.0f;
+
+	float rotationX = 0.0f;
+	float rotationZ = 0.0f;
+	float lockedRotationX = 0.0f;
+	float lockedRotationZ = 0.0f;
+
+	float smoothRotationX = 0.0f;
+	float smoothRotationZ = 0.0f;
+	
+	float LAG_MOVE = 0.05f;
+
+	float walkingSpeed = 2.0f;
+	const float BASE_HEIGHT = 0.1f;
+	float height = 0.1f;
+	float GRAVITY = -4.0f;
+
+	FQuat xzQuaternion = FQuat(0, 0, 0, 0);
+	float LOCKED_MAX_X = 10.0f;
+	float LOCKED_MAX_Z = 10.0f;
+
+	FVector velocity = FVector(0, 0, 0);
+	FVector inputDelta = FVector(0, 0, 0);
+
+	float targetRotationX = 0.0f;
+	float targetRotationZ = 0.0f;
+	FQuat targetQuaternion = FQuat(0, 0, 0, 0);
+
+	float camHeight = 0.0f;
+
+	bool isLocked = false;
+
+	//Fixed-rate movement simulation, rendering interpolates between the last two states
+	float SIM_RATE = 120.0f;
+	int32 MAX_SIM_STEPS = 8;
+	float simStep = 1.0f / 120.0f;
+	float simSmoothMove = 0.0f;
+	float simAccumulator = 0.0f;
+	GyroVectorD simGV;
+	GyroVectorD prevSimGV;
+	FVector2D moveInput = FVector2D(0, 0);
+	FQuat moveRotation = FQuat::Identity;
+
+	double lastTickSeconds = 0.0;
+	int64 lastTickAllocs = 0;
+
+	//Installed while Warp.CountTickAllocs is set, so GMalloc is not swapped under other threads every frame
+	TOptional<FWarpScopedAllocCount> allocCount;
+
+	//Walls of the tiling, tracked in the geometry the objects are resolved in
+	FWarpCollision collision = FWarpCollision(&AWarpHyperComponent::StepGV, &AWarpHyperComponent::ViewGV);
+
+	void ResolveAsync(FWarpGeometryPtr next);
+	void ResolveTiles(const TArray<GyroVectorD>* localGVs = nullptr);
+
+	void CollectObjects(TArray<UStaticMeshComponent*>* components, TArray<int32>* slots);
+	void ClearObjects();
+	int32 AddObject(UStaticMeshComponent* component, int32 slot, FVector position);
+	bool LoadBakedObjects();
+
+public:	
+	// Sets default values for this component's properties
+	AWarpHyperComponent(const FObjectInitializer& ObjectInitializer);
+	bool IsLocked() { return isLocked; };
+	void Lock();
+	void Unlock();
+	GyroVectorD GetWorldGV() { return worldGV; };
+
+	//Switch to a preloaded geometry, false if it is not loaded yet
+	//Objects keep the current geometry until their tiles are resolved on the thread pool
+	bool SwitchGeometry(int type, bool lattice3D);
+	bool IsSwitching() { return nextGeometry.IsValid(); }
+
+	//Movement runs at a fixed rate independent of Tick, it can also be driven without rendering
+	void SetSimRate(float Hz);
+	float GetSimRate() { return SIM_RATE; }
+	void SetMoveInput(FVector2D move, FQuat rotation);
+	void AdvanceSimulation(float DeltaTime);
+	void RunSimulation(float Seconds);
+	void SimulateStep(float dt);
+	GyroVectorD GetSimGV() { return simGV; }
+	void ResetSimulation();
+
+	//Sim state after a displacement with the floor clamp, and the world gyrovector it is rendered with
+	static GyroVectorD StepGV(const GyroVectorD& from, FVector displacement);
+	static GyroVectorD ViewGV(const GyroVectorD& sim);
+
+	/** Slide the player along walls where the tiling has no neighbouring tile */
+	UPROPERTY(EditAnywhere, Category = Collision)
+	bool bCollide = true;
+
+	/** Player radius as a fraction of the tile half-width */
+	UPROPERTY(EditAnywhere, Category = Collision)
+	float CollisionRadius = 0.15f;
+
+	const FWarpCollision& GetCollision() { return collision; }
+
+	/** Skip objects in tiles the player's tile cannot see, when the map has visibility baked */
+	UPROPERTY(EditAnywhere, Category = Visibility)
+	bool bCullInvisible = true;
+
+	//Objects skipped by the last Tick
+	int32 GetNumCulled() { return numCulled; }
+
+	/** Objects beyond this fraction of the Poincare ball radius are too small to see and count as hidden */
+	UPROPERTY(EditAnywhere, Category = Visibility)
+	float HorizonRadius = 0.995f;
+
+	/** Move Movable meshes to the tile under them when they leave its cell */
+	UPROPERTY(EditAnywhere, Category = Visibility)
+	bool bTrackMovables = true;
+
+	//Movable objects that changed tile in the last Tick
+	int32 GetNumRetiled() { return numRetiled; }
+
+	/** Cull or show whole supertiles against the horizon, so objects far past it are not visited every frame */
+	UPROPERTY(EditAnywhere, Category = Visibility)
+	bool bSupertileCulling = true;
+
+	//Supertiles the last Tick tested against the horizon
+	int32 GetSupertilesVisited() { return supertilesVisited; }
+
+	/** Seconds an object stays hidden before its material instance is released */
+	UPROPERTY(EditAnywhere, Category = Visibility)
+	float MaterialReleaseSeconds = 5.0f;
+
+	/** Released material instances kept for reuse */
+	UPROPERTY(EditAnywhere, Category = Visibility)
+	int32 MaterialPoolSize = 64;
+
+	//Material instance counters: live on objects, waiting in the pool, created so far, and estimated bytes of the live ones
+	int32 GetLiveMaterials();
+	int32 GetPooledMaterials() { return materialPool.Num(); }
+	int32 GetMaterialsCreated() { return materialsCreated; }
+	SIZE_T GetMaterialBytes();
+
+	//Rebuild the object list after Hyperbolic actors were spawned or destroyed
+	void GatherObjects();
+
+	/** Objects baked for the geometry below, BeginPlay uses them instead of searching actors and tiles */
+	UPROPERTY(VisibleAnywhere, Category = Baking)
+	TArray<FWarpBakedObject> BakedObjects;
+
+	UPROPERTY(VisibleAnywhere, Category = Baking)
+	int32 BakedType = 0;
+
+	UPROPERTY(VisibleAnywhere, Category = Baking)
+	bool bBakedLattice3D = false;
+
+	UPROPERTY(VisibleAnywhere, Category = Baking)
+	int32 BakedTiles = 0;
+
+	UPROPERTY(VisibleAnywhere, Category = Baking)
+	int32 BakedLayout = 0;
+
+	UPROPERTY(VisibleAnywhere, Category = Baking)
+	int32 BakedMapHash = 0;
+
+	/** Rebake whenever the level is saved or cooked */
+	UPROPERTY(EditAnywhere, Category = Baking)
+	bool bBakeOnSave = true;
+
+	//Store the tile and local gyrovector of every Hyperbolic mesh for the active geometry
+	UFUNCTION(CallInEditor, Category = Baking)
+	void BakeObjects();
+
+#if WITH_EDITOR
+	virtual void PreSave(const class ITargetPlatform* TargetPlatform) override;
+#endif
+	int32 NumObjects() { return objects.Num(); }
+
+	//Vertices of an object's mesh in the Poincare ball as its material draws them, recomputed only after it moved in view
+	//Vertices are taken about the object's pivot in map units (world / 1000), null when the mesh is not readable on the CPU
+	const TArray<FVector>* GetWarpedVertices(int32 ix);
+
+	/** Apply TanK to vertex heights when warping meshes on the CPU, as UnitToKlein does */
+	UPROPERTY(EditAnywhere, Category = Warp)
+	bool bWarpTanKHeight = false;
+
+	//Wall time of the last Tick, for benchmarks
+	double GetLastTickSeconds() { return lastTickSeconds; }
+
+	//Heap allocations made by the last Tick on the game thread, counted while Warp.CountTickAllocs is set
+	int64 GetLastTickAllocs() { return lastTickAllocs; }
+
+protected:
+	// Called when the game starts
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+public:	
+	// Called every frame
+	virtual void Tick(float DeltaTime) override;
+
+		
+};
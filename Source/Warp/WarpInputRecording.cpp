@@ -0,0 +1,79 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "WarpInputRecording.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+static int16 Quantize(float Value)
+{
+	return (int16)FMath::Clamp(FMath::RoundToInt(Value * FWarpInputRecording::SCALE), -32767, 32767);
+}
+
+void FWarpInputRecording::Add(const FWarpInputFrame& Frame)
+{
+	Samples.Add(Quantize(Frame.Forward));
+	Samples.Add(Quantize(Frame.Right));
+	Samples.Add(Quantize(Frame.Pitch));
+	Samples.Add(Quantize(Frame.Yaw));
+}
+
+FWarpInputFrame FWarpInputRecording::Get(int32 Frame) const
+{
+	FWarpInputFrame Out;
+	if (Frame >= 0 && Frame < NumFrames()) {
+		const int16* s = &Samples[Frame * 4];
+		Out.Forward = s[0] / SCALE;
+		Out.Right = s[1] / SCALE;
+		Out.Pitch = s[2] / SCALE;
+		Out.Yaw = s[3] / SCALE;
+	}
+	return Out;
+}
+
+bool FWarpInputRecording::Save(const FString& Path) const
+{
+	TArray<uint8> Bytes;
+	FMemoryWriter Ar(Bytes);
+
+	uint32 Magic = MAGIC;
+	uint32 Version = VERSION;
+	float Rate = FrameRate;
+	int32 Count = Samples.Num();
+	Ar << Magic << Version << Rate << Count;
+	Ar.Serialize((void*)Samples.GetData(), Count * sizeof(int16));
+
+	return FFileHelper::SaveArrayToFile(Bytes, *ResolvePath(Path));
+}
+
+bool FWarpInputRecording::Load(const FString& Path)
+{
+	TArray<uint8> Bytes;
+	if (!FFileHelper::LoadFileToArray(Bytes, *ResolvePath(Path))) {
+		return false;
+	}
+	FMemoryReader Ar(Bytes);
+
+	uint32 Magic = 0;
+	uint32 Version = 0;
+	int32 Count = 0;
+	Ar << Magic << Version << FrameRate << Count;
+	if (Magic != MAGIC || Version != VERSION || Count < 0 || Count * (int64)sizeof(int16) > Ar.TotalSize() - Ar.Tell()) {
+		Samples.Reset();
+		return false;
+	}
+
+	Samples.SetNumUninitialized(Count);
+	Ar.Serialize(Samples.GetData(), Count * sizeof(int16));
+	return true;
+}
+
+FString FWarpInputRecording::ResolvePath(const FString& Name)
+{
+	if (FPaths::IsRelative(Name)) {
+		return FPaths::ProjectSavedDir() / TEXT("WarpInput") / Name;
+	}
+	return Name;
+}
@@ -0,0 +1,42 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+//Character input of one frame, as read by AWarpHyperComponent
+struct FWarpInputFrame
+{
+	float Forward = 0.0f;
+	float Right = 0.0f;
+	float Pitch = 0.0f;
+	float Yaw = 0.0f;
+};
+
+//Recorded character input, one frame per engine tick at a fixed frame rate
+//Axes are stored as int16 fixed point, 8 bytes per frame
+struct FWarpInputRecording
+{
+	//Fixed point scale, mouse deltas above 32 per frame are clipped
+	static constexpr float SCALE = 1024.0f;
+
+	float FrameRate = 60.0f;
+
+	int32 NumFrames() const { return Samples.Num() / 4; }
+	void Reset() { Samples.Reset(); }
+
+	void Add(const FWarpInputFrame& Frame);
+	FWarpInputFrame Get(int32 Frame) const;
+
+	bool Save(const FString& Path) const;
+	bool Load(const FString& Path);
+
+	//Recordings live in Saved/WarpInput unless given a full path
+	static FString ResolvePath(const FString& Name);
+
+private:
+	static const uint32 MAGIC = 0x49505257;	//"WRPI"
+	static const uint32 VERSION = 1;
+
+	TArray<int16> Samples;
+};
@@ -0,0 +1,305 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "WarpMapFormat.h"
+#include "Warp.h"
+#include "Misc/Compression.h"
+
+namespace WarpMapFormat {
+
+    static const uint32 MAGIC = 0x5A505257;    //"WRPZ", raw maps start with a length byte of 1
+    static const uint32 VERSION = 2;    //Version 1 stored the antipode's inf or NaN after the planes
+
+    static const int32 VEC_MAX = (1 << 23) - 1;
+    static const uint32 GYR_MAX = (1 << 20) - 1;
+    static const float GYR_RANGE = 0.70710678f;
+
+    //Move codes, the high bit marks the tile at infinity
+    static const char MOVES[] = { 'C', 'R', 'L', 'U', 'D', 'B', 'F' };
+    static const uint8 AT_INFINITY = 0x80;
+
+    //Most raw bytes one tile can take: move, parent varint, position deltas, gyration and version 1 raw floats
+    static const int64 MAX_TILE_BYTES = 1 + 5 + 3 * sizeof(uint32) + sizeof(uint64) + 3 * sizeof(float);
+
+    struct FHeader {
+        uint32 magic;
+        uint32 version;
+        int32 count;
+        float scale;
+        int32 rawSize;
+        int32 packedSize;
+    };
+
+    static uint8 MoveCode(char c) {
+        for (uint8 i = 0; i < sizeof(MOVES); ++i) {
+            if (MOVES[i] == c) {
+                return i;
+            }
+        }
+        return 0;
+    }
+
+    static void PutVarint(TArray<uint8>* out, uint32 v) {
+        while (v >= 0x80) {
+            out->Add((uint8)(v | 0x80));
+            v >>= 7;
+        }
+        out->Add((uint8)v);
+    }
+
+    static bool GetVarint(const uint8* data, int32 size, int32* it, uint32* v) {
+        *v = 0;
+        for (int32 shift = 0; shift < 35; shift += 7) {
+            if (*it >= size) {
+                return false;
+            }
+            uint8 b = data[(*it)++];
+            *v |= (uint32)(b & 0x7F) << shift;
+            if (b < 0x80) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static uint32 ZigZag(int32 v) { return ((uint32)v << 1) ^ (uint32)(v >> 31); }
+    static int32 UnZigZag(uint32 v) { return (int32)(v >> 1) ^ -(int32)(v & 1); }
+
+    //Byte planes put the mostly zero high bytes of small values next to each other
+    template<typename T>
+    static void PutPlanes(TArray<uint8>* out, const TArray<T>& values) {
+        for (int32 b = 0; b < (int32)sizeof(T); ++b) {
+            for (T v : values) {
+                out->Add((uint8)(v >> (8 * b)));
+            }
+        }
+    }
+
+    template<typename T>
+    static T GetPlaned(const uint8* planes, int32 count, int32 i) {
+        T v = 0;
+        for (int32 b = 0; b < (int32)sizeof(T); ++b) {
+            v |= (T)planes[b * count + i] << (8 * b);
+        }
+        return v;
+    }
+
+    static uint64 PackQuat(FQuat q) {
+        //Generation leaves the origin's gyration as the zero quaternion, which is the identity
+        q = q.SizeSquared() > SMALL_NUMBER ? q.GetNormalized() : FQuat::Identity;
+        float c[4] = { q.X, q.Y, q.Z, q.W };
+        int32 largest = 0;
+        for (int32 i = 1; i < 4; ++i) {
+            if (FMath::Abs(c[i]) > FMath::Abs(c[largest])) {
+                largest = i;
+            }
+        }
+        //q and -q are the same rotation, flip so the dropped component is positive
+        float sign = c[largest] < 0.0f ? -1.0f : 1.0f;
+        uint64 bits = (uint64)largest;
+        int32 shift = 2;
+        for (int32 i = 0; i < 4; ++i) {
+            if (i == largest) {
+                continue;
+            }
+            float v = FMath::Clamp(c[i] * sign, -GYR_RANGE, GYR_RANGE);
+            uint64 u = (uint64)FMath::RoundToInt((v + GYR_RANGE) / (2.0f * GYR_RANGE) * GYR_MAX);
+            bits |= u << shift;
+            shift += 20;
+        }
+        return bits;
+    }
+
+    static FQuat UnpackQuat(uint64 bits) {
+        int32 largest = (int32)(bits & 3);
+        float c[4];
+        float sum = 0.0f;
+        int32 shift = 2;
+        for (int32 i = 0; i < 4; ++i) {
+            if (i == largest) {
+                continue;
+            }
+            float u = (float)((bits >> shift) & GYR_MAX);
+            c[i] = u / GYR_MAX * (2.0f * GYR_RANGE) - GYR_RANGE;
+            sum += c[i] * c[i];
+            shift += 20;
+        }
+        c[largest] = FMath::Sqrt(FMath::Max(0.0f, 1.0f - sum));
+        return FQuat(c[0], c[1], c[2], c[3]);
+    }
+
+    bool IsCompressed(const TArray<uint8>& data) {
+        return data.Num() >= (int32)sizeof(FHeader) && *(const uint32*)data.GetData() == MAGIC;
+    }
+
+    void Write(const TileSet& tiles, TArray<uint8>* out) {
+
+        int32 n = tiles.Num();
+
+        float scale = 0.0f;
+        for (int32 i = 0; i < n; ++i) {
+            FVector v = tiles[i].gv.vec;
+            if (TileIndex::IsFinite(v)) {
+                scale = FMath::Max(scale, v.GetAbsMax());
+            }
+        }
+        if (scale <= 0.0f) {
+            scale = 1.0f;
+        }
+
+        TArray<int32> quant;
+        quant.SetNumZeroed(n * 3);
+        TArray<uint8> moves;
+        TArray<uint32> deltas;
+        TArray<uint64> gyrs;
+        moves.Reserve(n);
+        deltas.Reserve(n * 3);
+        gyrs.Reserve(n);
+
+        for (int32 i = 0; i < n; ++i) {
+            const Tile& tile = tiles[i];
+            FVector v = tile.gv.vec;
+            uint8 code = MoveCode(tile.move);
+
+            if (TileIndex::IsFinite(v)) {
+                //Deltas are taken between quantized values so errors never add up along a path
+                for (int32 c = 0; c < 3; ++c) {
+                    quant[i * 3 + c] = FMath::RoundToInt(v[c] / scale * VEC_MAX);
+                    int32 base = tile.parent >= 0 ? quant[tile.parent * 3 + c] : 0;
+                    deltas.Add(ZigZag(quant[i * 3 + c] - base));
+                }
+            }
+            else {
+                code |= AT_INFINITY;
+            }
+            moves.Add(code);
+            gyrs.Add(PackQuat(code & AT_INFINITY ? FQuat::Identity : tile.gv.gyr));
+        }
+
+        TArray<uint8> raw;
+        raw.Reserve(n * 24);
+        raw.Append(moves);
+        //BFS order appends children frontier by frontier, so parent indices never decrease
+        int32 prevParent = 0;
+        for (int32 i = 1; i < n; ++i) {
+            PutVarint(&raw, (uint32)(tiles[i].parent - prevParent));
+            prevParent = tiles[i].parent;
+        }
+        PutPlanes(&raw, deltas);
+        PutPlanes(&raw, gyrs);
+
+        int32 bound = FCompression::CompressMemoryBound(NAME_Zlib, raw.Num());
+        out->SetNumUninitialized(sizeof(FHeader) + bound);
+        int32 packedSize = bound;
+        if (!FCompression::CompressMemory(NAME_Zlib, out->GetData() + sizeof(FHeader), packedSize, raw.GetData(), raw.Num(), COMPRESS_BiasMemory)) {
+            out->Reset();
+            return;
+        }
+        out->SetNum(sizeof(FHeader) + packedSize, false);
+
+        FHeader header = { MAGIC, VERSION, n, scale, raw.Num(), packedSize };
+        FMemory::Memcpy(out->GetData(), &header, sizeof(FHeader));
+    }
+
+    bool Read(const TArray<uint8>& data, FWarpGeometry* geometry) {
+
+        if (!IsCompressed(data)) {
+            return false;
+        }
+        FHeader header;
+        FMemory::Memcpy(&header, data.GetData(), sizeof(FHeader));
+        if ((header.version != VERSION && header.version != 1) || header.count <= 0 || header.rawSize <= 0 ||
+            header.packedSize > data.Num() - (int32)sizeof(FHeader) || header.rawSize > header.count * MAX_TILE_BYTES) {
+            return false;
+        }
+
+        TArray<uint8> raw;
+        raw.SetNumUninitialized(header.rawSize);
+        if (!FCompression::UncompressMemory(NAME_Zlib, raw.GetData(), header.rawSize, data.GetData() + sizeof(FHeader), header.packedSize)) {
+            return false;
+        }
+
+        int32 n = header.count;
+        const uint8* bytes = raw.GetData();
+        int32 size = raw.Num();
+        if (size < n) {
+            return false;
+        }
+        const uint8* moves = bytes;
+        int32 it = n;
+
+        TArray<int32> parents;
+        parents.SetNumUninitialized(n);
+        parents[0] = -1;
+        int32 parent = 0;
+        int32 infinite = 0;
+        for (int32 i = 1; i < n; ++i) {
+            uint32 d;
+            if (!GetVarint(bytes, size, &it, &d)) {
+                return false;
+            }
+            parent += (int32)d;
+            if (parent >= i) {
+                return false;
+            }
+            parents[i] = parent;
+        }
+        for (int32 i = 0; i < n; ++i) {
+            infinite += (moves[i] & AT_INFINITY) ? 1 : 0;
+        }
+
+        int32 finite = n - infinite;
+        const uint8* deltaPlanes = bytes + it;
+        const uint8* gyrPlanes = deltaPlanes + finite * 3 * sizeof(uint32);
+        const uint8* end = gyrPlanes + n * sizeof(uint64) + (header.version == 1 ? infinite * 3 * sizeof(float) : 0);
+        if (end > bytes + size) {
+            return false;
+        }
+
+        static const FIntVector conv[] = {
+            FIntVector(0, 0, 0), FIntVector(1, 0, 0), FIntVector(-1, 0, 0),
+            FIntVector(0, 0, 1), FIntVector(0, 0, -1), FIntVector(0, 1, 0), FIntVector(0, -1, 0),
+        };
+
+        TArray<int32> quant;
+        quant.SetNumZeroed(n * 3);
+        float cw = geometry->curvature.CELL_WIDTH;
+        float unit = header.scale / VEC_MAX;
+        geometry->tiles.Reserve(n);
+
+        TArray<FIntVector> cells;
+        cells.SetNumUninitialized(n);
+        TArray<int32> rings;
+        rings.SetNumUninitialized(n);
+        int32 d = 0;
+        for (int32 i = 0; i < n; ++i) {
+            uint8 code = moves[i] & ~AT_INFINITY;
+            if (code >= sizeof(MOVES)) {
+                return false;
+            }
+            int32 p = parents[i];
+            cells[i] = (p >= 0 ? cells[p] : FIntVector(0, 0, 0)) + conv[code];
+            rings[i] = p >= 0 ? rings[p] + 1 : 0;
+            geometry->lattice3D |= (code >= 5);
+
+            FVector vec;
+            if (moves[i] & AT_INFINITY) {
+                vec = TileIndex::AtInfinity();
+            }
+            else {
+                for (int32 c = 0; c < 3; ++c) {
+                    int32 base = p >= 0 ? quant[p * 3 + c] : 0;
+                    quant[i * 3 + c] = base + UnZigZag(GetPlaned<uint32>(deltaPlanes, finite * 3, d * 3 + c));
+                    vec[c] = quant[i * 3 + c] * unit;
+                }
+                d++;
+            }
+
+            FQuat quat = UnpackQuat(GetPlaned<uint64>(gyrPlanes, n, i));
+            FIntVector cell = cells[i];
+            geometry->tiles.Add(cell, FVector2D(cell.X * cw, cell.Z * cw), GyroVectorD(vec, quat), rings[i]);
+        }
+        return true;
+    }
+
+}
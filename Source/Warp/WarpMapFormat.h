@@ -0,0 +1,30 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct TileSet;
+struct FWarpGeometry;
+
+//Compressed tile map, written instead of the raw records when FWarpGameModule::bCompressMaps is set
+//
+//Coordinates are stored as parent index plus move in BFS order, cells are rebuilt by summing moves
+//Positions are 24-bit fixed point over the largest coordinate of the map, coded as deltas to the parent
+//Holonomy quaternions use smallest-three encoding with 20 bits per stored component
+//The streams are split into byte planes and deflated with zlib
+//
+//Error bounds against the raw format:
+//  gv.vec    |error| <= scale / (2 * (2^23 - 1)) per component, scale = largest |component| in the map
+//  gv.gyr    |error| <= 8e-7 for the three stored components, <= 3e-6 for the rebuilt one (before renormalizing)
+//A tile at infinity (the antipode of a spherical map) is only marked, it stores no position and an identity gyration
+namespace WarpMapFormat {
+
+    bool IsCompressed(const TArray<uint8>& data);
+
+    void Write(const TileSet& tiles, TArray<uint8>* out);
+
+    //Fill a geometry whose curvature is set with tiles in file order for FinalizeTiles, false on a corrupt file
+    bool Read(const TArray<uint8>& data, FWarpGeometry* geometry);
+
+}
@@ -1,409 +1,679 @@
-#pragma once
-
-#include "Math/Vector.h"
-#include "Math/UnrealMathUtility.h"
-#include "Math/Matrix.h"
-#include "Modules/ModuleManager.h"
-#include "CoreTypes.h"
-#include <algorithm>
-
-using namespace std;
-
-//Math function library for non-euqlidean transformations
-//Quaternions implementation
-//3D Mobius transform
-//Used in hyperbolic and spherical geometry calculations
-
-namespace WarpMath {
-
-    inline FVector VectorUp() {
-        return FVector(0, 0, 1);
-    };
-
-    inline FVector VectorLeft() {
-        return FVector(0, -1, 0);
-    };
-
-    inline static void SetTileType(int n) {
-        FWarpGameModule *m = &FModuleManager::GetModuleChecked<FWarpGameModule>("Warp");
-        m->SetTileTypeW(n);
-    };
-
-    inline static float getK() { 
-        FWarpGameModule *m = &FModuleManager::GetModuleChecked<FWarpGameModule>("Warp");
-        return m->GetK();
-    };
-
-    inline static float getKV() {
-        FWarpGameModule *m = &FModuleManager::GetModuleChecked<FWarpGameModule>("Warp");
-        return m->GetKlein();
-    };
-
-    template<class T>
-    constexpr const T& clamp(const T& lower, const T& upper, const T& n) {
-        return lower >= n ? lower : n <= upper ? n : upper;
-    }
-
-    template<typename T> inline int sgn(T val) {
-        return (T(0) < val) - (val < T(0));
-    }
-
-    inline static double sqrMagnitude(FVector a) {
-        return a.X * a.X + a.Y * a.Y + a.Z * a.Z;
-    }
-
-    inline static FVector ClampMagnitude(FVector vector, float maxLength)
-    {
-        if ( sqrMagnitude(vector) > (double) maxLength * (double) maxLength) return vector.GetSafeNormal() * maxLength;
-        return vector;
-    }
-
-    inline static FVector Project(FVector vector, FVector onNormal)
-    {
-        float sqrMag = FVector::DotProduct(onNormal, onNormal);
-        if (sqrMag < DBL_EPSILON)
-            return FVector(0, 0, 0);
-        else
-        {
-            float dot = FVector::DotProduct(vector, onNormal);
-            return FVector(onNormal.X * dot / sqrMag,
-                onNormal.Y * dot / sqrMag,
-                onNormal.Z * dot / sqrMag);
-        }
-    }
-
-    inline FVector VLerp(FVector a, FVector b, double t) {
-        return a * (1.0 - t) + b * t;
-    }
-
-    inline static FMatrix GetTranslationMatrix(FVector position)
-    {
-        return FMatrix(FPlane(1, 0, 0, 0),
-            FPlane(0, 1, 0, 0),
-            FPlane(0, 0, 1, 0),
-            FPlane(position.X, position.Y, position.Z, 1)
-        );
-    }
-
-    inline static FMatrix GetRotationMatrix(FVector anglesDeg)
-    {
-        anglesDeg = FVector(FMath::DegreesToRadians(anglesDeg[0]), FMath::DegreesToRadians(anglesDeg[1]), FMath::DegreesToRadians(anglesDeg[2]));
-
-        FMatrix rotationX = FMatrix(FPlane(1, 0, 0, 0),
-            FPlane(0, cos(anglesDeg[0]), sin(anglesDeg[0]), 0),
-            FPlane(0, -sin(anglesDeg[0]), cos(anglesDeg[0]), 0),
-            FPlane(0, 0, 0, 1));
-
-        FMatrix rotationY = FMatrix(FPlane(cos(anglesDeg[1]), 0, -sin(anglesDeg[1]), 0),
-            FPlane(0, 1, 0, 0),
-            FPlane(sin(anglesDeg[1]), 0, cos(anglesDeg[1]), 0),
-            FPlane(0, 0, 0, 1));
-
-        FMatrix rotationZ = FMatrix(FPlane(cos(anglesDeg[2]), sin(anglesDeg[2]), 0, 0),
-            FPlane(-sin(anglesDeg[2]), cos(anglesDeg[2]), 0, 0),
-            FPlane(0, 0, 1, 0),
-            FPlane(0, 0, 0, 1));
-
-        return rotationX * rotationY * rotationZ;
-    }
-
-    inline static FMatrix GetScaleMatrix(FVector scale)
-    {
-        return FMatrix(FPlane(scale.X, 0, 0, 0),
-            FPlane(0, scale.Y, 0, 0),
-            FPlane(0, 0, scale.Z, 0),
-            FPlane(0, 0, 0, 1));
-    }
-
-    inline static FMatrix TRS(FVector vec, FQuat gyr, FVector scale) {
-        return GetTranslationMatrix(vec) * GetRotationMatrix(FVector(gyr.X, gyr.Y, gyr.Z)) * GetScaleMatrix(scale);
-    }
-
-
-    //Inverse hyperbolic trig functions
-    inline double Acosh(double x) {
-        return log(x + sqrt(x * x - 1));
-    }
-
-    inline double Atanh(double x) {
-        return 0.5 * log((1.0 + x) / (1.0 - x));
-    }
-
-    //Curvature-dependent tangent
-    inline float TanK(float x) {
-        if (getK() > 0.0f) {
-            return tan(x);
-        }
-        else if (getK() < 0.0f) {
-            return (float)tanh(x);
-        }
-        else {
-            return x;
-        }
-    }
-
-    //Curvature-dependent inverse tangent
-    inline float AtanK(float x) {
-        if (getK() > 0.0f) {
-            return atan(x);
-        }
-        else if (getK() < 0.0f) {
-            return 0.5f * log((1.0f + x) / (1.0f - x));
-        }
-        else {
-            return x;
-        }
-    }
-
-    //3D Mobius add
-    inline FVector MobiusAdd(FVector a, FVector b) {
-        FVector c = getK() * FVector::CrossProduct(a, b);
-        double d = 1.0 - getK() * FVector::DotProduct(a, b);
-        FVector t = a + b;
-        float cr = FVector::CrossProduct(c, t).X;
-        return (t * d + FVector(cr, cr, cr)) / (d * d + sqrMagnitude(c));
-    }
-
-    //3D Mobius quat
-    inline FQuat MobiusGyr(FVector a, FVector b) {
-        FVector c = getK() * FVector::CrossProduct(a, b);
-        float d = 1.0f - getK() * FVector::DotProduct(a, b);
-        FQuat q = FQuat(c.X, c.Y, c.Z, d);
-        q.Normalize();
-        return q;
-    }
-
-    //3D Mobius sq dist
-    inline double MobiusDistSq(FVector a, FVector b) {
-        float a2 = sqrMagnitude(a);
-        float b2 = sqrMagnitude(b);
-        double ab = 2.0 * FVector::DotProduct(a, b);
-        return (a2 - ab + b2) / (1.0 + getK() * (ab + getK() * a2 * b2));
-    }
-
-    //Transform Klein to Poincare
-    inline FVector KleinToPoincare(FVector p) {
-        if (getK() == 0.0f) { return p; }
-        return p / (sqrt(std::max(0.0, 1.0 + getK() * sqrMagnitude(p))) + 1.0);
-    }
-
-    inline FVector PoincareToKlein(FVector p) {
-        if (getK() == 0.0f) { return p; }
-        return p * 2.0f / (1.0f - getK() * sqrMagnitude(p));
-    }
-
-    inline FVector KleinToPoincare(FVector p, FVector n) {
-        if (getK() == 0.0f) { return n.GetUnsafeNormal(); }
-        return ((1.0f + sqrt(1.0f + getK() * sqrMagnitude(p))) * n + (getK() * FVector::DotProduct(n, p)) * p).GetUnsafeNormal();
-    }
-	
-    inline FVector PoincareToKlein(FVector p, FVector n) {
-        if (getK() == 0.0f) { return n.GetUnsafeNormal(); }
-        return ((1.0f + getK() * sqrMagnitude(p)) * n - (2.0f * getK() * FVector::DotProduct(n, p)) * p).GetUnsafeNormal();
-    }
-
-    inline FVector UnitToKlein(FVector p, bool useTanKHeight) {
-        p *= getKV();
-        if (useTanKHeight) {
-            p.Y = TanK(p.Y) * sqrt(1.0f + getK() * (p.X * p.X + p.Z * p.Z));
-        }
-        return p;
-    }
-    inline FVector KleinToUnit(FVector p, bool useTanKHeight) {
-        if (useTanKHeight) {
-            p.Y = AtanK(p.Y / sqrt(1.0f + getK() * (p.X * p.X + p.Z * p.Z)));
-        }
-        return p / getKV();
-    }
-
-    inline FVector UnitToPoincare(FVector u, bool useTanKHeight) {
-        return KleinToPoincare(UnitToKlein(u, useTanKHeight));
-    }
-    inline FVector PoincareToUnit(FVector u, bool useTanKHeight) {
-        return KleinToUnit(PoincareToKlein(u), useTanKHeight);
-    }
-
-    inline float UnitToPoincareScale(FVector u, float r, bool useTanKHeight) {
-        if (getK() == 0.0f) { return r; }
-        u = UnitToKlein(u, useTanKHeight);
-        float p = sqrt(1.0f + getK() * sqrMagnitude(u));
-        return r * getKV() / (p * (p + 1));
-    }
-	
-    inline float PoincareScaleFactor(FVector p) {
-        return 1.0f + getK() * sqrMagnitude(p);
-    }
-
-    inline FVector HyperTranslate(FVector d) {
-        float mag = d.Size();
-        if (mag < 1e-5f) {
-            return FVector(0, 0, 0);
-        }
-        return d * (TanK(mag) / mag);
-    }
-	
-    inline FVector HyperTranslate(float dx, float dz) {
-        return HyperTranslate(FVector(dx, 0.0f, dz));
-    }
-	
-    inline FVector HyperTranslate(float dx, float dy, float dz) {
-        return HyperTranslate(FVector(dx, dy, dz));
-    }
-
-    inline float PoincareDist(FVector a, FVector b) {
-        return sqrMagnitude(a - b) / ((getK() + sqrMagnitude(a)) * (getK() + sqrMagnitude(b)));
-    }
-
-    inline static FVector UpVector(FVector p) {
-        float u = 1.0f + getK() * sqrMagnitude(p);
-        float v = -2.0f * getK() * p.Y;
-        return (u * VectorUp() + v * p).GetUnsafeNormal();
-    }
-
-    inline static FQuat SwingTwist(FQuat q, FVector d) {
-        FVector ra = FVector(q.X, q.Y, q.Z);
-        FVector p = Project(ra, d);
-        return FQuat(p.X, p.Y, p.Z, q.W).GetNormalized();
-    }
-	
-    inline static FVector ProjectToPlaneV(FVector p) {
-        double m = getK() * sqrMagnitude(p);
-        double d = 1.0 + m;
-        double s = 2.0 / (1.0 - m + sqrt(d * d - 4.0 * getK() * p.Y * p.Y));
-        return FVector(p.X * s, 0.0, p.Z * s);
-    }
-
-    inline void MobiusAddGyrUnnorm(FVector a, FVector b, FVector* sum, FQuat* gyr) {
-        FVector c = getK() * FVector::CrossProduct(a, b);
-        float d = 1.0f - getK() * FVector::DotProduct(a, b);
-        FVector t = a + b;
-        float cr = FVector::CrossProduct(c, t).X;
-        *sum = (t * d + FVector(cr, cr, cr)) / (d * d + sqrMagnitude(c));
-        *gyr = FQuat(-c.X, -c.Y, -c.Z, d);
-    }
-
-    inline void MobiusAddGyr(FVector a, FVector b, FVector* sum, FQuat* gyr) {
-        MobiusAddGyrUnnorm(a, b, sum, gyr);
-        gyr->Normalize();
-    }
-
-    //Gyrovector structure stores Mobius transform
-    struct GyroVectorD {
-
-        //Members
-        FVector vec;     //This is the hyperbolic offset vector or position
-        FQuat gyr;  //This is the post-rotation as a result of holonomy
-
-        //Constructors
-        GyroVectorD() { vec = FVector(0, 0, 0); gyr = FQuat(0, 0, 0, 0); }
-        GyroVectorD(double x, double y, double z) { vec = FVector(x, y, z); gyr = FQuat(0, 0, 0, 0); }
-        GyroVectorD(FVector _vec) { vec = _vec; gyr = FQuat(0, 0, 0, 0); }
-        GyroVectorD(FQuat _gyr) { vec = FVector(0, 0, 0); gyr = _gyr.GetNormalized(); }
-        GyroVectorD(FVector _vec, FQuat _gyr) { vec = _vec; gyr = _gyr.GetNormalized(); }
-
-
-        FVector Point() {
-            return gyr * vec;
-        }
-
-        //Aligns the rotation of the gyrovector so that up is up
-        void AlignUpVector() {
-            FVector newAxis = UpVector(vec);
-
-            FVector c = newAxis ^ VectorUp();
-            double _w = sqrt(sqrMagnitude(newAxis) * sqrMagnitude(VectorUp())) + FVector::DotProduct(newAxis, VectorUp());
-            FQuat newBasis = FQuat(c.X, c.Y, c.Z, _w).GetNormalized();
-
-            FQuat twist = SwingTwist(gyr, newAxis);
-            gyr = newBasis * twist;
-        }
-
-        //Projects the Gyrovector to the ground plane
-        GyroVectorD ProjectToPlane() {
-            //Remove the y-component from the Klein projection and any out-of-plane rotation
-            return GyroVectorD(ProjectToPlaneV(vec), FQuat(0.0f, gyr.Y, 0.0f, gyr.W));
-        }
-
-        //Convert to a matrix so the shader can read it
-        FMatrix ToMatrix() {
-            return TRS(vec, gyr, FVector(1, 1, 1));
-        }
-
-    };
-
-    inline void TransformNormal(FQuat gyr, FVector vec, FVector pt, FVector n, FVector* newPt, FVector* newN) {
-        FVector v;
-        FQuat q;
-        MobiusAddGyr(vec, pt, &v, &q);
-        *newPt = gyr * v;
-        FVector fv = q.Inverse() * n;
-        *newN = gyr * fv;
-    }
-
-    inline GyroVectorD add(GyroVectorD gv, FVector delta) {
-        FVector newVec;
-        FQuat newGyr;
-        MobiusAddGyr(gv.vec, gv.gyr.Inverse()  * delta, &newVec, &newGyr);
-        return GyroVectorD(newVec, gv.gyr * newGyr);
-    }
-	
-    inline GyroVectorD add(FVector delta, GyroVectorD gv) {
-        FVector newVec;
-        FQuat newGyr;
-        MobiusAddGyr(delta, gv.vec, &newVec, &newGyr);
-        return GyroVectorD(newVec, gv.gyr * newGyr);
-    }
-	
-    inline GyroVectorD add(GyroVectorD gv, FQuat rot) {
-        return GyroVectorD(gv.vec, rot * gv.gyr);
-    }
-	
-    inline GyroVectorD add(FQuat rot, GyroVectorD gv2) {
-        return GyroVectorD(rot.Inverse() * gv2.vec, gv2.gyr * rot);
-    }
-	
-    inline GyroVectorD add(GyroVectorD gv1, GyroVectorD gv2) {
-        FVector newVec;
-        FQuat newGyr;
-        MobiusAddGyr(gv1.vec, gv1.gyr.Inverse() * gv2.vec, &newVec, &newGyr);
-
-        FQuat q = gv2.gyr * gv1.gyr;
-        return GyroVectorD(newVec, q * newGyr);
-    }
-
-    //Inverse GyroVectorD
-    inline GyroVectorD InverseG(GyroVectorD gv) {
-        return GyroVectorD(-(gv.gyr * gv.vec), gv.gyr.Inverse());
-    }
-
-    //Inverse composition
-    inline GyroVectorD sub(GyroVectorD gv, FVector delta) {
-        return add(gv, (-delta));
-    }
-    inline GyroVectorD sub(FVector delta, GyroVectorD gv) {
-        return add(delta, InverseG(gv));
-    }
-    inline GyroVectorD sub(GyroVectorD gv, FQuat rot) {
-        return add(gv, rot.Inverse());
-    }
-    inline GyroVectorD sub(FQuat rot, GyroVectorD gv) {
-        return add(rot, InverseG(gv));
-    }
-    inline GyroVectorD sub(GyroVectorD gv1, GyroVectorD gv2) {
-        return add(gv1, InverseG(gv2));
-    }
-
-    //Apply the full GyroVectorD to a point
-    inline FVector apply(GyroVectorD gv, FVector pt) {
-        return gv.gyr * MobiusAdd(gv.vec, pt);
-    }
-
-    //Spherical linear interpolation
-    inline GyroVectorD Slerp(GyroVectorD a, GyroVectorD b, float t) {
-        return GyroVectorD(VLerp(a.vec, b.vec, t), FQuat::FastLerp(a.gyr, b.gyr, t));
-    }
-    inline GyroVectorD SlerpReverse(GyroVectorD a, GyroVectorD b, float t) {
-        return add(Slerp(FQuat(0, 0, 0, 0), sub(b, a), t), a);
-    }
-
+#pragma once
+
+#include "Math/Vector.h"
+#include "Math/UnrealMathUtility.h"
+#include "Math/Matrix.h"
+#include "Modules/ModuleManager.h"
+#include "CoreTypes.h"
+#include <algorithm>
+
+using namespace std;
+
+//Math function library for non-euqlidean transformations
+//Quaternions implementation
+//3D Mobius transform
+//Used in hyperbolic and spherical geometry calculations
+
+namespace WarpMath {
+
+    inline FVector VectorUp() {
+        return FVector(0, 0, 1);
+    };
+
+    inline FVector VectorLeft() {
+        return FVector(0, -1, 0);
+    };
+
+    //Module lookup is done once, FModuleManager locks on every query
+    inline static FWarpGameModule* GetWarpModule() {
+        static FWarpGameModule *m = &FModuleManager::GetModuleChecked<FWarpGameModule>("Warp");
+        return m;
+    };
+
+    inline static void SetTileType(int n) {
+        GetWarpModule()->SetTileTypeW(n);
+    };
+
+    inline static float getK() { 
+        return GetWarpModule()->GetK();
+    };
+
+    inline static float getKV() {
+        return GetWarpModule()->GetKlein();
+    };
+
+    template<class T>
+    constexpr const T& clamp(const T& lower, const T& upper, const T& n) {
+        return lower >= n ? lower : n <= upper ? n : upper;
+    }
+
+    template<typename T> inline int sgn(T val) {
+        return (T(0) < val) - (val < T(0));
+    }
+
+    inline static double sqrMagnitude(FVector a) {
+        return a.X * a.X + a.Y * a.Y + a.Z * a.Z;
+    }
+
+    inline static FVector ClampMagnitude(FVector vector, float maxLength)
+    {
+        if ( sqrMagnitude(vector) > (double) maxLength * (double) maxLength) return vector.GetSafeNormal() * maxLength;
+        return vector;
+    }
+
+    inline static FVector Project(FVector vector, FVector onNormal)
+    {
+        float sqrMag = FVector::DotProduct(onNormal, onNormal);
+        if (sqrMag < DBL_EPSILON)
+            return FVector(0, 0, 0);
+        else
+        {
+            float dot = FVector::DotProduct(vector, onNormal);
+            return FVector(onNormal.X * dot / sqrMag,
+                onNormal.Y * dot / sqrMag,
+                onNormal.Z * dot / sqrMag);
+        }
+    }
+
+    inline FVector VLerp(FVector a, FVector b, double t) {
+        return a * (1.0 - t) + b * t;
+    }
+
+    inline static FMatrix GetTranslationMatrix(FVector position)
+    {
+        return FMatrix(FPlane(1, 0, 0, 0),
+            FPlane(0, 1, 0, 0),
+            FPlane(0, 0, 1, 0),
+            FPlane(position.X, position.Y, position.Z, 1)
+        );
+    }
+
+    inline static FMatrix GetRotationMatrix(FVector anglesDeg)
+    {
+        anglesDeg = FVector(FMath::DegreesToRadians(anglesDeg[0]), FMath::DegreesToRadians(anglesDeg[1]), FMath::DegreesToRadians(anglesDeg[2]));
+
+        FMatrix rotationX = FMatrix(FPlane(1, 0, 0, 0),
+            FPlane(0, cos(anglesDeg[0]), sin(anglesDeg[0]), 0),
+            FPlane(0, -sin(anglesDeg[0]), cos(anglesDeg[0]), 0),
+            FPlane(0, 0, 0, 1));
+
+        FMatrix rotationY = FMatrix(FPlane(cos(anglesDeg[1]), 0, -sin(anglesDeg[1]), 0),
+            FPlane(0, 1, 0, 0),
+            FPlane(sin(anglesDeg[1]), 0, cos(anglesDeg[1]), 0),
+            FPlane(0, 0, 0, 1));
+
+        FMatrix rotationZ = FMatrix(FPlane(cos(anglesDeg[2]), sin(anglesDeg[2]), 0, 0),
+            FPlane(-sin(anglesDeg[2]), cos(anglesDeg[2]), 0, 0),
+            FPlane(0, 0, 1, 0),
+            FPlane(0, 0, 0, 1));
+
+        return rotationX * rotationY * rotationZ;
+    }
+
+    inline static FMatrix GetScaleMatrix(FVector scale)
+    {
+        return FMatrix(FPlane(scale.X, 0, 0, 0),
+            FPlane(0, scale.Y, 0, 0),
+            FPlane(0, 0, scale.Z, 0),
+            FPlane(0, 0, 0, 1));
+    }
+
+    inline static FMatrix TRS(FVector vec, FQuat gyr, FVector scale) {
+        return GetTranslationMatrix(vec) * GetRotationMatrix(FVector(gyr.X, gyr.Y, gyr.Z)) * GetScaleMatrix(scale);
+    }
+
+
+    //Evaluation mode of the curvature trig functions
+    enum class ETrigMode : uint8 {
+        Exact,  //libm
+        Fast,   //rational and polynomial approximations
+        Table   //lookup tables with linear interpolation
+    };
+
+    inline ETrigMode& TrigMode() {
+        static ETrigMode mode = ETrigMode::Exact;
+        return mode;
+    }
+
+    //Fast approximations
+    //Max abs error against double libm, outside the range the exact function is used:
+    //  TanhFast   |x| <= 3       1.2e-6 (2.3e-7 for |x| <= 2)
+    //  TanFast    |x| <= 1.2     6.7e-7 (relative 2.8e-7)
+    //  AtanFast   any x          1.9e-7
+    //  LogFast    [1e-3, 1e3]    3.2e-7, any positive normal float
+    //  AtanhFast  |x| <= 0.95    1.2e-7
+    //  AcoshFast  [1.001, 100]   5.1e-7
+    //Camera heights, movement steps and Klein heights stay well inside these ranges
+
+    //Lambert continued fraction for tanh, 7/6 Pade, branch-free
+    inline float TanhPade(float x) {
+        float x2 = x * x;
+        return x * (135135.0f + x2 * (17325.0f + x2 * (378.0f + x2))) / (135135.0f + x2 * (62370.0f + x2 * (3150.0f + x2 * 28.0f)));
+    }
+
+    //Same continued fraction for tan
+    inline float TanPade(float x) {
+        float x2 = x * x;
+        return x * (135135.0f - x2 * (17325.0f - x2 * (378.0f - x2))) / (135135.0f - x2 * (62370.0f - x2 * (3150.0f - x2 * 28.0f)));
+    }
+
+    //Minimax polynomial for atan on [-1, 1] (Abramowitz and Stegun 4.4.49), branch-free
+    inline float AtanPoly(float x) {
+        float x2 = x * x;
+        return x * (1.0f + x2 * (-0.3333314528f + x2 * (0.1999355085f + x2 * (-0.1420889944f + x2 * (0.1065626393f
+            + x2 * (-0.0752896400f + x2 * (0.0429096138f + x2 * (-0.0161657367f + x2 * 0.0028662257f))))))));
+    }
+
+    inline float TanhFast(float x) {
+        return FMath::Abs(x) <= 3.0f ? TanhPade(x) : (float)tanh(x);
+    }
+
+    inline float TanFast(float x) {
+        return FMath::Abs(x) <= 1.2f ? TanPade(x) : (float)tan(x);
+    }
+
+    inline float AtanFast(float x) {
+        float ax = FMath::Abs(x);
+        if (ax <= 1.0f) {
+            return AtanPoly(x);
+        }
+        float r = HALF_PI - AtanPoly(1.0f / ax);
+        return x < 0.0f ? -r : r;
+    }
+
+    //Natural log from the float exponent and a series for the mantissa
+    inline float LogFast(float x) {
+        uint32 bits;
+        FMemory::Memcpy(&bits, &x, sizeof(bits));
+        int32 e = (int32)((bits >> 23) & 255) - 127;
+        bits = (bits & 0x007FFFFF) | 0x3F800000;
+        float m;
+        FMemory::Memcpy(&m, &bits, sizeof(m));
+
+        //Keep the mantissa in [sqrt(1/2), sqrt(2)) so the series converges fast
+        if (m > 1.41421356f) {
+            m *= 0.5f;
+            e += 1;
+        }
+
+        //log(m) = 2 atanh(s) with s = (m - 1) / (m + 1)
+        float s = (m - 1.0f) / (m + 1.0f);
+        float s2 = s * s;
+        float l = 2.0f * s * (1.0f + s2 * (0.333333333f + s2 * (0.2f + s2 * (0.142857143f + s2 * 0.111111111f))));
+        return l + (float)e * 0.69314718056f;
+    }
+
+    inline float AtanhFast(float x) {
+        return 0.5f * LogFast((1.0f + x) / (1.0f - x));
+    }
+
+    inline float AcoshFast(float x) {
+        return LogFast(x + sqrt(x * x - 1.0f));
+    }
+
+    //Lookup table of an odd function on [0, range], linear interpolation
+    //Max abs error: tanh on [0, 3] 8.9e-7, tan on [0, 1.2] 7.7e-6 (4.6e-7 below 0.6), atan on [0, 1] 1.5e-7
+    struct FTrigTable {
+        static const int32 Size = 1024;
+        float range;
+        float scale;
+        float v[Size + 2];
+
+        template<typename F> FTrigTable(float _range, F f) {
+            range = _range;
+            scale = Size / _range;
+            for (int32 i = 0; i < Size + 2; ++i) {
+                v[i] = (float)f((double)_range * i / Size);
+            }
+        }
+
+        //Expects 0 <= x <= range
+        float Lookup(float x) const {
+            float t = x * scale;
+            int32 i = (int32)t;
+            return v[i] + (v[i + 1] - v[i]) * (t - (float)i);
+        }
+    };
+
+    inline const FTrigTable& TanhTable() {
+        static const FTrigTable table(3.0f, [](double x) { return tanh(x); });
+        return table;
+    }
+
+    inline const FTrigTable& TanTable() {
+        static const FTrigTable table(1.2f, [](double x) { return tan(x); });
+        return table;
+    }
+
+    inline const FTrigTable& AtanTable() {
+        static const FTrigTable table(1.0f, [](double x) { return atan(x); });
+        return table;
+    }
+
+    inline float TanhTab(float x) {
+        float ax = FMath::Abs(x);
+        if (ax > TanhTable().range) {
+            return (float)tanh(x);
+        }
+        float r = TanhTable().Lookup(ax);
+        return x < 0.0f ? -r : r;
+    }
+
+    inline float TanTab(float x) {
+        float ax = FMath::Abs(x);
+        if (ax > TanTable().range) {
+            return (float)tan(x);
+        }
+        float r = TanTable().Lookup(ax);
+        return x < 0.0f ? -r : r;
+    }
+
+    inline float AtanTab(float x) {
+        float ax = FMath::Abs(x);
+        float r = ax <= 1.0f ? AtanTable().Lookup(ax) : HALF_PI - AtanTable().Lookup(1.0f / ax);
+        return x < 0.0f ? -r : r;
+    }
+
+    //Mode-dispatched functions (no table for log, Table mode uses LogFast)
+    inline float TanhM(float x) {
+        switch (TrigMode()) {
+            case ETrigMode::Fast: return TanhFast(x);
+            case ETrigMode::Table: return TanhTab(x);
+            default: return (float)tanh(x);
+        }
+    }
+
+    inline float TanM(float x) {
+        switch (TrigMode()) {
+            case ETrigMode::Fast: return TanFast(x);
+            case ETrigMode::Table: return TanTab(x);
+            default: return (float)tan(x);
+        }
+    }
+
+    inline float AtanM(float x) {
+        switch (TrigMode()) {
+            case ETrigMode::Fast: return AtanFast(x);
+            case ETrigMode::Table: return AtanTab(x);
+            default: return (float)atan(x);
+        }
+    }
+
+    //Inverse hyperbolic trig functions
+    inline double Acosh(double x) {
+        if (TrigMode() != ETrigMode::Exact) {
+            return AcoshFast((float)x);
+        }
+        return log(x + sqrt(x * x - 1));
+    }
+
+    inline double Atanh(double x) {
+        if (TrigMode() != ETrigMode::Exact) {
+            return AtanhFast((float)x);
+        }
+        return 0.5 * log((1.0 + x) / (1.0 - x));
+    }
+
+    //Curvature-dependent tangent for a known curvature (batched loops read getK() once)
+    inline float TanK(float k, float x) {
+        if (k > 0.0f) {
+            return TanM(x);
+        }
+        else if (k < 0.0f) {
+            return TanhM(x);
+        }
+        else {
+            return x;
+        }
+    }
+
+    //Curvature-dependent tangent
+    inline float TanK(float x) {
+        return TanK(getK(), x);
+    }
+
+    //Curvature-dependent inverse tangent
+    inline float AtanK(float x) {
+        float k = getK();
+        if (k > 0.0f) {
+            return AtanM(x);
+        }
+        else if (k < 0.0f) {
+            return TrigMode() == ETrigMode::Exact ? 0.5f * log((1.0f + x) / (1.0f - x)) : AtanhFast(x);
+        }
+        else {
+            return x;
+        }
+    }
+
+    //Batched curvature tangent with the branch-free kernels, vectorizes
+    //Inputs must stay within |x| <= 3 (hyperbolic) or |x| <= 1.2 (spherical)
+    inline void TanKBatch(float k, const float* x, float* out, int32 n) {
+        if (k > 0.0f) {
+            for (int32 i = 0; i < n; ++i) { out[i] = TanPade(x[i]); }
+        }
+        else if (k < 0.0f) {
+            for (int32 i = 0; i < n; ++i) { out[i] = TanhPade(x[i]); }
+        }
+        else {
+            for (int32 i = 0; i < n; ++i) { out[i] = x[i]; }
+        }
+    }
+
+    //3D Mobius add
+    inline FVector MobiusAdd(FVector a, FVector b) {
+        FVector c = getK() * FVector::CrossProduct(a, b);
+        double d = 1.0 - getK() * FVector::DotProduct(a, b);
+        FVector t = a + b;
+        return (t * d + FVector::CrossProduct(c, t)) / (d * d + sqrMagnitude(c));
+    }
+
+    //3D Mobius quat
+    inline FQuat MobiusGyr(FVector a, FVector b) {
+        FVector c = getK() * FVector::CrossProduct(a, b);
+        float d = 1.0f - getK() * FVector::DotProduct(a, b);
+        FQuat q = FQuat(c.X, c.Y, c.Z, d);
+        q.Normalize();
+        return q;
+    }
+
+    //3D Mobius sq dist
+    inline double MobiusDistSq(FVector a, FVector b) {
+        float a2 = sqrMagnitude(a);
+        float b2 = sqrMagnitude(b);
+        double ab = 2.0 * FVector::DotProduct(a, b);
+        return (a2 - ab + b2) / (1.0 + getK() * (ab + getK() * a2 * b2));
+    }
+
+    //Mobius sq dist for a known curvature, safe off the game thread
+    inline double MobiusDistSqK(float k, FVector a, FVector b) {
+        float a2 = sqrMagnitude(a);
+        float b2 = sqrMagnitude(b);
+        double ab = 2.0 * FVector::DotProduct(a, b);
+        return (a2 - ab + b2) / (1.0 + k * (ab + k * a2 * b2));
+    }
+
+    //Transform Klein to Poincare
+    inline FVector KleinToPoincare(FVector p) {
+        if (getK() == 0.0f) { return p; }
+        return p / (sqrt(std::max(0.0, 1.0 + getK() * sqrMagnitude(p))) + 1.0);
+    }
+
+    inline FVector PoincareToKlein(FVector p) {
+        if (getK() == 0.0f) { return p; }
+        return p * 2.0f / (1.0f - getK() * sqrMagnitude(p));
+    }
+
+    inline FVector KleinToPoincare(FVector p, FVector n) {
+        if (getK() == 0.0f) { return n.GetUnsafeNormal(); }
+        return ((1.0f + sqrt(1.0f + getK() * sqrMagnitude(p))) * n + (getK() * FVector::DotProduct(n, p)) * p).GetUnsafeNormal();
+    }
+	
+    inline FVector PoincareToKlein(FVector p, FVector n) {
+        if (getK() == 0.0f) { return n.GetUnsafeNormal(); }
+        return ((1.0f + getK() * sqrMagnitude(p)) * n - (2.0f * getK() * FVector::DotProduct(n, p)) * p).GetUnsafeNormal();
+    }
+
+    inline FVector UnitToKlein(FVector p, bool useTanKHeight) {
+        p *= getKV();
+        if (useTanKHeight) {
+            p.Y = TanK(p.Y) * sqrt(1.0f + getK() * (p.X * p.X + p.Z * p.Z));
+        }
+        return p;
+    }
+    inline FVector KleinToUnit(FVector p, bool useTanKHeight) {
+        if (useTanKHeight) {
+            p.Y = AtanK(p.Y / sqrt(1.0f + getK() * (p.X * p.X + p.Z * p.Z)));
+        }
+        return p / getKV();
+    }
+
+    inline FVector UnitToPoincare(FVector u, bool useTanKHeight) {
+        return KleinToPoincare(UnitToKlein(u, useTanKHeight));
+    }
+    inline FVector PoincareToUnit(FVector u, bool useTanKHeight) {
+        return KleinToUnit(PoincareToKlein(u), useTanKHeight);
+    }
+
+    inline float UnitToPoincareScale(FVector u, float r, bool useTanKHeight) {
+        if (getK() == 0.0f) { return r; }
+        u = UnitToKlein(u, useTanKHeight);
+        float p = sqrt(1.0f + getK() * sqrMagnitude(u));
+        return r * getKV() / (p * (p + 1));
+    }
+	
+    inline float PoincareScaleFactor(FVector p) {
+        return 1.0f + getK() * sqrMagnitude(p);
+    }
+
+    inline FVector HyperTranslate(FVector d) {
+        float mag = d.Size();
+        if (mag < 1e-5f) {
+            return FVector(0, 0, 0);
+        }
+        return d * (TanK(mag) / mag);
+    }
+	
+    inline FVector HyperTranslate(float dx, float dz) {
+        return HyperTranslate(FVector(dx, 0.0f, dz));
+    }
+	
+    inline FVector HyperTranslate(float dx, float dy, float dz) {
+        return HyperTranslate(FVector(dx, dy, dz));
+    }
+
+    inline float PoincareDist(FVector a, FVector b) {
+        return sqrMagnitude(a - b) / ((getK() + sqrMagnitude(a)) * (getK() + sqrMagnitude(b)));
+    }
+
+    inline static FVector UpVector(FVector p) {
+        float u = 1.0f + getK() * sqrMagnitude(p);
+        float v = -2.0f * getK() * p.Y;
+        return (u * VectorUp() + v * p).GetUnsafeNormal();
+    }
+
+    inline static FQuat SwingTwist(FQuat q, FVector d) {
+        FVector ra = FVector(q.X, q.Y, q.Z);
+        FVector p = Project(ra, d);
+        return FQuat(p.X, p.Y, p.Z, q.W).GetNormalized();
+    }
+	
+    inline static FVector ProjectToPlaneV(FVector p) {
+        double m = getK() * sqrMagnitude(p);
+        double d = 1.0 + m;
+        double s = 2.0 / (1.0 - m + sqrt(d * d - 4.0 * getK() * p.Y * p.Y));
+        return FVector(p.X * s, 0.0, p.Z * s);
+    }
+
+    //Mobius add and gyration for a known curvature, the gyration is left unnormalized
+    inline void MobiusAddGyrUnnormK(float k, FVector a, FVector b, FVector* sum, FQuat* gyr) {
+        FVector c = k * FVector::CrossProduct(a, b);
+        float d = 1.0f - k * FVector::DotProduct(a, b);
+        FVector t = a + b;
+        *sum = (t * d + FVector::CrossProduct(c, t)) / (d * d + sqrMagnitude(c));
+        *gyr = FQuat(-c.X, -c.Y, -c.Z, d);
+    }
+
+    inline void MobiusAddGyrK(float k, FVector a, FVector b, FVector* sum, FQuat* gyr) {
+        MobiusAddGyrUnnormK(k, a, b, sum, gyr);
+        gyr->Normalize();
+    }
+
+    inline void MobiusAddGyrUnnorm(FVector a, FVector b, FVector* sum, FQuat* gyr) {
+        MobiusAddGyrUnnormK(getK(), a, b, sum, gyr);
+    }
+
+    inline void MobiusAddGyr(FVector a, FVector b, FVector* sum, FQuat* gyr) {
+        MobiusAddGyrK(getK(), a, b, sum, gyr);
+    }
+
+    //Gyrovector structure stores Mobius transform
+    struct GyroVectorD {
+
+        //Members
+        FVector vec;     //This is the hyperbolic offset vector or position
+        FQuat gyr;  //This is the post-rotation as a result of holonomy
+
+        //Constructors
+        GyroVectorD() { vec = FVector(0, 0, 0); gyr = FQuat(0, 0, 0, 0); }
+        GyroVectorD(double x, double y, double z) { vec = FVector(x, y, z); gyr = FQuat(0, 0, 0, 0); }
+        GyroVectorD(FVector _vec) { vec = _vec; gyr = FQuat(0, 0, 0, 0); }
+        GyroVectorD(FQuat _gyr) { vec = FVector(0, 0, 0); gyr = _gyr.GetNormalized(); }
+        GyroVectorD(FVector _vec, FQuat _gyr) { vec = _vec; gyr = _gyr.GetNormalized(); }
+
+
+        FVector Point() {
+            return gyr * vec;
+        }
+
+        //Aligns the rotation of the gyrovector so that up is up
+        void AlignUpVector() {
+            FVector newAxis = UpVector(vec);
+
+            FVector c = newAxis ^ VectorUp();
+            double _w = sqrt(sqrMagnitude(newAxis) * sqrMagnitude(VectorUp())) + FVector::DotProduct(newAxis, VectorUp());
+            FQuat newBasis = FQuat(c.X, c.Y, c.Z, _w).GetNormalized();
+
+            FQuat twist = SwingTwist(gyr, newAxis);
+            gyr = newBasis * twist;
+        }
+
+        //Projects the Gyrovector to the ground plane
+        GyroVectorD ProjectToPlane() {
+            //Remove the y-component from the Klein projection and any out-of-plane rotation
+            return GyroVectorD(ProjectToPlaneV(vec), FQuat(0.0f, gyr.Y, 0.0f, gyr.W));
+        }
+
+        //Convert to a matrix so the shader can read it
+        FMatrix ToMatrix() {
+            return TRS(vec, gyr, FVector(1, 1, 1));
+        }
+
+    };
+
+    inline void TransformNormal(FQuat gyr, FVector vec, FVector pt, FVector n, FVector* newPt, FVector* newN) {
+        FVector v;
+        FQuat q;
+        MobiusAddGyr(vec, pt, &v, &q);
+        *newPt = gyr * v;
+        FVector fv = q.Inverse() * n;
+        *newN = gyr * fv;
+    }
+
+    inline GyroVectorD add(GyroVectorD gv, FVector delta) {
+        FVector newVec;
+        FQuat newGyr;
+        MobiusAddGyr(gv.vec, gv.gyr.Inverse()  * delta, &newVec, &newGyr);
+        return GyroVectorD(newVec, gv.gyr * newGyr);
+    }
+	
+    inline GyroVectorD add(FVector delta, GyroVectorD gv) {
+        FVector newVec;
+        FQuat newGyr;
+        MobiusAddGyr(delta, gv.vec, &newVec, &newGyr);
+        return GyroVectorD(newVec, gv.gyr * newGyr);
+    }
+	
+    inline GyroVectorD add(GyroVectorD gv, FQuat rot) {
+        return GyroVectorD(gv.vec, rot * gv.gyr);
+    }
+	
+    inline GyroVectorD add(FQuat rot, GyroVectorD gv2) {
+        return GyroVectorD(rot.Inverse() * gv2.vec, gv2.gyr * rot);
+    }
+	
+    inline GyroVectorD add(GyroVectorD gv1, GyroVectorD gv2) {
+        FVector newVec;
+        FQuat newGyr;
+        MobiusAddGyr(gv1.vec, gv1.gyr.Inverse() * gv2.vec, &newVec, &newGyr);
+
+        FQuat q = gv2.gyr * gv1.gyr;
+        return GyroVectorD(newVec, q * newGyr);
+    }
+
+    //Inverse GyroVectorD
+    inline GyroVectorD InverseG(GyroVectorD gv) {
+        return GyroVectorD(-(gv.gyr * gv.vec), gv.gyr.Inverse());
+    }
+
+    //Inverse composition
+    inline GyroVectorD sub(GyroVectorD gv, FVector delta) {
+        return add(gv, (-delta));
+    }
+    inline GyroVectorD sub(FVector delta, GyroVectorD gv) {
+        return add(delta, InverseG(gv));
+    }
+    inline GyroVectorD sub(GyroVectorD gv, FQuat rot) {
+        return add(gv, rot.Inverse());
+    }
+    inline GyroVectorD sub(FQuat rot, GyroVectorD gv) {
+        return add(rot, InverseG(gv));
+    }
+    inline GyroVectorD sub(GyroVectorD gv1, GyroVectorD gv2) {
+        return add(gv1, InverseG(gv2));
+    }
+
+    //Fused add(local, world).ToMatrix() for per-frame object transforms
+    //Writes the four matrix rows without building gyrovectors or matrices
+    //ToMatrix() reads gyr.X/Y/Z as Euler degrees, a unit quaternion keeps them within 1 degree,
+    //so short sin/cos series replace the trig (error below 1e-10)
+    inline void ComposeToMatrixRows(float k, const GyroVectorD& local, const GyroVectorD& world, FVector4* rows) {
+        //Rotate world.vec by the inverse of local.gyr (conjugate, as FQuat::Inverse does)
+        const FQuat& lq = local.gyr;
+        const FVector& v = world.vec;
+        FVector qv = FVector(-lq.X, -lq.Y, -lq.Z);
+        FVector tv = 2.0f * FVector::CrossProduct(qv, v);
+        FVector b = v + lq.W * tv + FVector::CrossProduct(qv, tv);
+
+        //Mobius add of local.vec and b with its gyration
+        const FVector& a = local.vec;
+        FVector c = k * FVector::CrossProduct(a, b);
+        float d = 1.0f - k * FVector::DotProduct(a, b);
+        FVector t = a + b;
+        FVector p = (t * d + FVector::CrossProduct(c, t)) / (d * d + sqrMagnitude(c));
+
+        FQuat g = FQuat(-c.X, -c.Y, -c.Z, d);
+        g.Normalize();
+        FQuat q = world.gyr * local.gyr * g;
+        q.Normalize();
+
+        //Euler degrees to radians
+        const float toRad = PI / 180.0f;
+        float ax = q.X * toRad;
+        float ay = q.Y * toRad;
+        float az = q.Z * toRad;
+
+        float sa = ax * (1.0f - ax * ax * (1.0f / 6.0f));
+        float sb = ay * (1.0f - ay * ay * (1.0f / 6.0f));
+        float sc = az * (1.0f - az * az * (1.0f / 6.0f));
+        float ca = 1.0f - ax * ax * (0.5f - ax * ax * (1.0f / 24.0f));
+        float cb = 1.0f - ay * ay * (0.5f - ay * ay * (1.0f / 24.0f));
+        float cc = 1.0f - az * az * (0.5f - az * az * (1.0f / 24.0f));
+
+        //Rows of rotationX * rotationY * rotationZ
+        rows[0] = FVector4(cb * cc, cb * sc, -sb, 0.0f);
+        rows[1] = FVector4(sa * sb * cc - ca * sc, sa * sb * sc + ca * cc, sa * cb, 0.0f);
+        rows[2] = FVector4(ca * sb * cc + sa * sc, ca * sb * sc - sa * cc, ca * cb, 0.0f);
+
+        //Translation row goes through the rotation, as in TRS
+        rows[3] = FVector4(
+            p.X * rows[0].X + p.Y * rows[1].X + p.Z * rows[2].X,
+            p.X * rows[0].Y + p.Y * rows[1].Y + p.Z * rows[2].Y,
+            p.X * rows[0].Z + p.Y * rows[1].Z + p.Z * rows[2].Z,
+            1.0f);
+    }
+
+    //Apply the full GyroVectorD to a point
+    inline FVector apply(GyroVectorD gv, FVector pt) {
+        return gv.gyr * MobiusAdd(gv.vec, pt);
+    }
+
+    //Spherical linear interpolation
+    inline GyroVectorD Slerp(GyroVectorD a, GyroVectorD b, float t) {
+        return GyroVectorD(VLerp(a.vec, b.vec, t), FQuat::FastLerp(a.gyr, b.gyr, t));
+    }
+    inline GyroVectorD SlerpReverse(GyroVectorD a, GyroVectorD b, float t) {
+        return add(Slerp(FQuat(0, 0, 0, 0), sub(b, a), t), a);
+    }
+
 }
\ No newline at end of file
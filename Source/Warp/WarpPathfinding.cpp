@@ -0,0 +1,297 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "WarpPathfinding.h"
+#include "Async/Async.h"
+#include "Async/ParallelFor.h"
+#include "Algo/Reverse.h"
+
+//Open set entry, steps is the cost so far and the entry is stale once the tile was reached in fewer
+struct FWarpOpenTile
+{
+	float F;
+	float H;
+	int32 Steps;
+	int32 Tile;
+};
+
+//A* state of one thread, a tile's entries are only valid while its stamp is the current one,
+//so nothing is cleared between searches
+struct FWarpSearchScratch
+{
+	TArray<uint32> Stamp;
+	TArray<int32> Steps;
+	TArray<int32> Parent;
+	TArray<FWarpOpenTile> Open;
+	uint32 Current = 0;
+};
+
+FWarpPathfinder::FWarpPathfinder(FWarpGeometryPtr InGeometry) : geometry(InGeometry)
+{
+	k = geometry->curvature.K;
+	numFaces = geometry->lattice3D ? 6 : 4;
+	//The first step from the origin tile is CELL_WIDTH along X, every step covers the same distance
+	step = (float)FWarpSupertiles::Distance(k, geometry->curvature.CELL_WIDTH);
+}
+
+float FWarpPathfinder::Heuristic(int32 tile, int32 goal) const
+{
+	const FVector& a = geometry->tiles.vec[tile];
+	const FVector& b = geometry->tiles.vec[goal];
+	if (!TileIndex::IsFinite(a) || !TileIndex::IsFinite(b)) {
+		return 0.0f;
+	}
+	double d = FWarpSupertiles::Distance(k, sqrt(FMath::Max(MobiusDistSqK(k, a, b), 0.0)));
+	//Slightly under so rounding far from the origin cannot make it overestimate
+	return FMath::IsFinite(d) ? (float)(d / step) * 0.999f : 0.0f;
+}
+
+FWarpPath FWarpPathfinder::FindPath(int32 start, int32 goal)
+{
+	FWarpPath path;
+	queries.Increment();
+	if (!geometry->tiles.IsValidIndex(start) || !geometry->tiles.IsValidIndex(goal)) {
+		return path;
+	}
+	if (start == goal) {
+		path.Tiles.Add(start);
+		path.bComplete = true;
+		return path;
+	}
+
+	FFieldPtr field = FindField(goal);
+	if (field.IsValid()) {
+		path.bFromField = true;
+		if ((*field)[start] == INDEX_NONE) {
+			return path;
+		}
+		if (WalkField(*field, start, &path)) {
+			fieldHits.Increment();
+			return path;
+		}
+		path = FWarpPath();
+	}
+	Search(start, goal, &path);
+	return path;
+}
+
+TFuture<FWarpPath> FWarpPathfinder::FindPathAsync(int32 start, int32 goal)
+{
+	TSharedRef<FWarpPathfinder, ESPMode::ThreadSafe> self = AsShared();
+	return Async(EAsyncExecution::ThreadPool, [self, start, goal]() {
+		return self->FindPath(start, goal);
+	});
+}
+
+TFuture<TArray<FWarpPath>> FWarpPathfinder::FindPathsAsync(TArray<FIntPoint> requests)
+{
+	TSharedRef<FWarpPathfinder, ESPMode::ThreadSafe> self = AsShared();
+	return Async(EAsyncExecution::ThreadPool, [self, requests = MoveTemp(requests)]() {
+		TArray<FWarpPath> paths;
+		paths.SetNum(requests.Num());
+		ParallelFor(requests.Num(), [&](int32 i) {
+			paths[i] = self->FindPath(requests[i].X, requests[i].Y);
+		});
+		return paths;
+	});
+}
+
+void FWarpPathfinder::Search(int32 start, int32 goal, FWarpPath* path)
+{
+	static thread_local FWarpSearchScratch scratch;
+	const int32 n = geometry->tiles.Num();
+	if (scratch.Stamp.Num() < n) {
+		scratch.Stamp.SetNumZeroed(n);
+		scratch.Steps.SetNumUninitialized(n);
+		scratch.Parent.SetNumUninitialized(n);
+	}
+	if (++scratch.Current == 0) {
+		FMemory::Memzero(scratch.Stamp.GetData(), scratch.Stamp.Num() * sizeof(uint32));
+		scratch.Current = 1;
+	}
+	const uint32 stamp = scratch.Current;
+	uint32* stamps = scratch.Stamp.GetData();
+	int32* steps = scratch.Steps.GetData();
+	int32* parent = scratch.Parent.GetData();
+	TArray<FWarpOpenTile>& open = scratch.Open;
+
+	//Lowest f first, ties go to the tile nearer the goal
+	auto less = [](const FWarpOpenTile& a, const FWarpOpenTile& b) {
+		return a.F < b.F || (a.F == b.F && a.H < b.H);
+	};
+
+	float h = Heuristic(start, goal);
+	stamps[start] = stamp;
+	steps[start] = 0;
+	parent[start] = INDEX_NONE;
+	open.Reset();
+	open.HeapPush(FWarpOpenTile{ h, h, 0, start }, less);
+
+	int32 best = start;
+	float bestH = h;
+	int32 expanded = 0;
+	bool found = false;
+	while (open.Num() > 0) {
+		FWarpOpenTile top;
+		open.HeapPop(top, less, false);
+		if (top.Steps != steps[top.Tile]) {
+			continue;
+		}
+		if (top.Tile == goal) {
+			found = true;
+			break;
+		}
+		if (expanded >= MaxExpansions) {
+			break;
+		}
+		expanded++;
+		if (top.H < bestH) {
+			best = top.Tile;
+			bestH = top.H;
+		}
+
+		for (int32 f = 0; f < numFaces; f++) {
+			int32 next = geometry->Neighbour(top.Tile, f);
+			if (next == INDEX_NONE) {
+				continue;
+			}
+			int32 g = top.Steps + 1;
+			if (stamps[next] == stamp && steps[next] <= g) {
+				continue;
+			}
+			stamps[next] = stamp;
+			steps[next] = g;
+			parent[next] = top.Tile;
+			float nh = Heuristic(next, goal);
+			open.HeapPush(FWarpOpenTile{ g + nh, nh, g, next }, less);
+		}
+	}
+	expansions.Add(expanded);
+
+	path->bComplete = found;
+	for (int32 t = found ? goal : best; t != INDEX_NONE; t = parent[t]) {
+		path->Tiles.Add(t);
+	}
+	Algo::Reverse(path->Tiles);
+}
+
+//Steps from every tile to goal, breadth first over the neighbour table
+TArray<int32> FWarpPathfinder::BuildField(int32 goal) const
+{
+	const int32 n = geometry->tiles.Num();
+	TArray<int32> steps;
+	steps.Init(INDEX_NONE, n);
+	TArray<int32> queue;
+	queue.Reserve(n);
+	queue.Add(goal);
+	steps[goal] = 0;
+	for (int32 i = 0; i < queue.Num(); i++) {
+		int32 t = queue[i];
+		for (int32 f = 0; f < numFaces; f++) {
+			int32 next = geometry->Neighbour(t, f);
+			if (next != INDEX_NONE && steps[next] == INDEX_NONE) {
+				steps[next] = steps[t] + 1;
+				queue.Add(next);
+			}
+		}
+	}
+	return steps;
+}
+
+//Step to a neighbour one closer each time, false if the field has no way down (faces matched one way only)
+bool FWarpPathfinder::WalkField(const TArray<int32>& steps, int32 start, FWarpPath* path) const
+{
+	int32 t = start;
+	path->Tiles.Reserve(steps[start] + 1);
+	path->Tiles.Add(t);
+	while (steps[t] > 0) {
+		int32 down = INDEX_NONE;
+		for (int32 f = 0; f < numFaces && down == INDEX_NONE; f++) {
+			int32 next = geometry->Neighbour(t, f);
+			if (next != INDEX_NONE && steps[next] == steps[t] - 1) {
+				down = next;
+			}
+		}
+		if (down == INDEX_NONE) {
+			return false;
+		}
+		t = down;
+		path->Tiles.Add(t);
+	}
+	path->bComplete = true;
+	return true;
+}
+
+//The field of a goal if it is built, counting the request and starting the build once a goal is common
+FWarpPathfinder::FFieldPtr FWarpPathfinder::FindField(int32 goal)
+{
+	FScopeLock lock(&fieldLock);
+	FField* field = fields.Find(goal);
+	if (!field) {
+		//Request counts of goals that never got a field are dropped before they pile up
+		if (fields.Num() >= MaxFields * 16) {
+			for (auto It = fields.CreateIterator(); It; ++It) {
+				if (!It->Value.Steps.IsValid() && !It->Value.bBuilding) {
+					It.RemoveCurrent();
+				}
+			}
+		}
+		field = &fields.Add(goal);
+	}
+	field->LastUse = ++useCount;
+	if (field->Steps.IsValid()) {
+		return field->Steps;
+	}
+	field->Requests++;
+	if (!field->bBuilding && field->Requests >= FieldRequests) {
+		field->bBuilding = true;
+		TSharedRef<FWarpPathfinder, ESPMode::ThreadSafe> self = AsShared();
+		Async(EAsyncExecution::ThreadPool, [self, goal]() {
+			self->StoreField(goal, FFieldPtr(MakeShared<TArray<int32>, ESPMode::ThreadSafe>(self->BuildField(goal))));
+		});
+	}
+	return nullptr;
+}
+
+//Keep a built field, dropping the least recently used ones past MaxFields
+void FWarpPathfinder::StoreField(int32 goal, FFieldPtr steps)
+{
+	FScopeLock lock(&fieldLock);
+	FField& field = fields.FindOrAdd(goal);
+	field.Steps = steps;
+	field.bBuilding = false;
+	field.LastUse = ++useCount;
+
+	int32 built = 0;
+	for (const TPair<int32, FField>& entry : fields) {
+		built += entry.Value.Steps.IsValid() ? 1 : 0;
+	}
+	while (built > FMath::Max(MaxFields, 1)) {
+		FField* oldest = nullptr;
+		for (TPair<int32, FField>& entry : fields) {
+			if (entry.Value.Steps.IsValid() && (!oldest || entry.Value.LastUse < oldest->LastUse)) {
+				oldest = &entry.Value;
+			}
+		}
+		oldest->Steps.Reset();
+		oldest->Requests = 0;
+		built--;
+	}
+}
+
+void FWarpPathfinder::CacheField(int32 goal)
+{
+	if (geometry->tiles.IsValidIndex(goal)) {
+		StoreField(goal, FFieldPtr(MakeShared<TArray<int32>, ESPMode::ThreadSafe>(BuildField(goal))));
+	}
+}
+
+int32 FWarpPathfinder::NumFields()
+{
+	FScopeLock lock(&fieldLock);
+	int32 built = 0;
+	for (const TPair<int32, FField>& entry : fields) {
+		built += entry.Value.Steps.IsValid() ? 1 : 0;
+	}
+	return built;
+}
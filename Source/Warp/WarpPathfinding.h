@@ -0,0 +1,89 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "Warp.h"
+
+using namespace WarpMath;
+
+//Tiles from start to goal inclusive, empty when no path was found
+//A search that runs out of expansions returns the path to the tile it reached nearest the goal
+struct FWarpPath
+{
+	TArray<int32> Tiles;
+	bool bComplete = false;
+	bool bFromField = false;
+};
+
+//Pathfinding over the tile graph of one geometry, every step crosses one face to a neighbouring tile
+//
+//Tiles are regular, so each step covers the same hyperbolic distance and the distance between tile centres
+//divided by it never overestimates the steps left, A* uses that as its heuristic
+//Goals asked for often get a distance field (steps to the goal from every tile), built once on the thread pool,
+//after which a path is read by walking down the field
+//All queries are thread safe, the geometry is immutable and shared scratch is per thread
+class WARP_API FWarpPathfinder : public TSharedFromThis<FWarpPathfinder, ESPMode::ThreadSafe>
+{
+public:
+	explicit FWarpPathfinder(FWarpGeometryPtr InGeometry);
+
+	//Tiles an A* search may expand before it gives up, bounds the latency of one query
+	int32 MaxExpansions = 1 << 16;
+
+	//Queries toward a goal before its distance field is built, and fields kept (least recently used go first)
+	int32 FieldRequests = 8;
+	int32 MaxFields = 32;
+
+	FWarpPath FindPath(int32 start, int32 goal);
+
+	//On the thread pool, a batch runs as one task spread over workers
+	TFuture<FWarpPath> FindPathAsync(int32 start, int32 goal);
+	TFuture<TArray<FWarpPath>> FindPathsAsync(TArray<FIntPoint> requests);
+
+	//Lower bound on the steps from tile to goal
+	float Heuristic(int32 tile, int32 goal) const;
+
+	//Build the distance field toward goal now instead of after FieldRequests queries
+	void CacheField(int32 goal);
+	int32 NumFields();
+
+	FWarpGeometryPtr GetGeometry() const { return geometry; }
+
+	//Queries answered, ones read from a distance field, and tiles expanded by A*
+	int32 GetQueries() const { return queries.GetValue(); }
+	int32 GetFieldHits() const { return fieldHits.GetValue(); }
+	int32 GetExpansions() const { return expansions.GetValue(); }
+
+private:
+	typedef TSharedPtr<const TArray<int32>, ESPMode::ThreadSafe> FFieldPtr;
+
+	struct FField
+	{
+		FFieldPtr Steps;
+		int32 Requests = 0;
+		uint64 LastUse = 0;
+		bool bBuilding = false;
+	};
+
+	FWarpGeometryPtr geometry;
+	float k = 0.0f;
+	float step = 1.0f;
+	int32 numFaces = 4;
+
+	FCriticalSection fieldLock;
+	TMap<int32, FField> fields;
+	uint64 useCount = 0;
+
+	FThreadSafeCounter queries;
+	FThreadSafeCounter fieldHits;
+	FThreadSafeCounter expansions;
+
+	FFieldPtr FindField(int32 goal);
+	TArray<int32> BuildField(int32 goal) const;
+	void StoreField(int32 goal, FFieldPtr steps);
+	bool WalkField(const TArray<int32>& steps, int32 start, FWarpPath* path) const;
+	void Search(int32 start, int32 goal, FWarpPath* path);
+};
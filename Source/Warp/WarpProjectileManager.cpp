@@ -0,0 +1,256 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "WarpProjectileManager.h"
+#include "WarpProjectile.h"
+#include "WarpHyperComponent.h"
+#include "Async/ParallelFor.h"
+#include "Kismet/GameplayStatics.h"
+
+//Projectiles are tracked like the player, seen from their own position
+static GyroVectorD ProjectileStep(const GyroVectorD& from, FVector displacement)
+{
+	return add(from, displacement);
+}
+
+static GyroVectorD ProjectileView(const GyroVectorD& sim)
+{
+	return InverseG(sim);
+}
+
+AWarpProjectileManager::AWarpProjectileManager()
+{
+
+	PrimaryActorTick.bCanEverTick = true;
+
+}
+
+AWarpProjectileManager* AWarpProjectileManager::Get(UWorld* World)
+{
+	TArray<AActor*> found;
+	UGameplayStatics::GetAllActorsOfClass(World, AWarpProjectileManager::StaticClass(), found);
+	if (found.Num() > 0) {
+		return Cast<AWarpProjectileManager>(found[0]);
+	}
+	return World->SpawnActor<AWarpProjectileManager>();
+}
+
+void AWarpProjectileManager::BeginPlay()
+{
+	Super::BeginPlay();
+
+	//Step after the player has moved this frame
+	TArray<AActor*> found;
+	UGameplayStatics::GetAllActorsOfClass(GetWorld(), AWarpHyperComponent::StaticClass(), found);
+	if (found.Num() > 0) {
+		hyper = Cast<AWarpHyperComponent>(found[0]);
+		AddTickPrerequisiteActor(hyper);
+	}
+}
+
+void AWarpProjectileManager::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	UE_LOG(LogTemp, Log, TEXT("Projectile pool: capacity %d, high-water %d, misses %d"), Pool.Capacity, Pool.GetHighWater(), Pool.GetMisses());
+	Pool.Empty();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+AWarpProjectile* AWarpProjectileManager::AcquireProjectile(TSubclassOf<AWarpProjectile> Class, const FVector& Location, const FRotator& Rotation)
+{
+	return Pool.Acquire(GetWorld(), Class, Location, Rotation);
+}
+
+int32 AWarpProjectileManager::Spawn(GyroVectorD gv, FVector dir, float speed, AWarpProjectile* visual)
+{
+	int32 ix = projVec.Add(gv.vec);
+	projGyr.Add(gv.gyr);
+	projDir.Add(dir.GetSafeNormal());
+	projSpeed.Add(speed);
+	projAge.Add(0.0f);
+	projVisual.Add(visual);
+
+	FWarpCollision track(&ProjectileStep, &ProjectileView);
+	track.Reset(GetWarpModule()->GetGeometry(), gv);
+	projTrack.Add(track);
+
+	UMaterialInstanceDynamic* DynMaterial = nullptr;
+	if (visual) {
+		visual->SetManaged(this, ix);
+		UStaticMeshComponent* StaticMeshComponent = visual->FindComponentByClass<UStaticMeshComponent>();
+		if (StaticMeshComponent) {
+			//Pooled projectiles keep the material instance from their first flight
+			DynMaterial = Cast<UMaterialInstanceDynamic>(StaticMeshComponent->GetMaterial(0));
+			if (!DynMaterial) {
+				DynMaterial = UMaterialInstanceDynamic::Create(StaticMeshComponent->GetMaterial(0), nullptr);
+				StaticMeshComponent->SetMaterial(0, DynMaterial);
+			}
+		}
+	}
+	projMaterial.Add(DynMaterial);
+
+	return ix;
+}
+
+int32 AWarpProjectileManager::SpawnFromCamera(FVector worldDir, AWarpProjectile* visual)
+{
+	//The camera sits at the inverse of the world gyrovector
+	GyroVectorD origin = IsValid(hyper) ? InverseG(hyper->GetWorldGV()) : GyroVectorD(FVector(0, 0, 0), FQuat::Identity);
+
+	//Unreal forward/right/up to hyperbolic right/forward/up
+	FVector dir = FVector(worldDir.Y, worldDir.X, worldDir.Z);
+	return Spawn(origin, origin.gyr * dir, ProjectileSpeed, visual);
+}
+
+void AWarpProjectileManager::Remove(int32 ix)
+{
+	AWarpProjectile* visual = projVisual[ix];
+	if (IsValid(visual)) {
+		visual->SetManaged(nullptr, INDEX_NONE);
+		Pool.Release(visual);
+	}
+
+	projVec.RemoveAtSwap(ix, 1, false);
+	projGyr.RemoveAtSwap(ix, 1, false);
+	projDir.RemoveAtSwap(ix, 1, false);
+	projSpeed.RemoveAtSwap(ix, 1, false);
+	projAge.RemoveAtSwap(ix, 1, false);
+	projTrack.RemoveAtSwap(ix, 1, false);
+	projVisual.RemoveAtSwap(ix, 1, false);
+	projMaterial.RemoveAtSwap(ix, 1, false);
+
+	//The last projectile took this slot
+	if (ix < projVisual.Num() && IsValid(projVisual[ix])) {
+		projVisual[ix]->SetManaged(this, ix);
+	}
+}
+
+void AWarpProjectileManager::Kill(int32 ix)
+{
+	if (projVec.IsValidIndex(ix)) {
+		Remove(ix);
+	}
+}
+
+// Integrate every projectile along its geodesic
+// Each step is a Mobius add of the flight direction in the projectile frame, so holonomy accumulates in gyr
+void AWarpProjectileManager::Step(float DeltaTime)
+{
+	const int32 n = projVec.Num();
+	if (n == 0) {
+		return;
+	}
+
+	const float k = getK();
+	const int32 batch = std::max(BatchSize, 1);
+	const int32 batches = (n + batch - 1) / batch;
+
+	FVector* vec = projVec.GetData();
+	FQuat* gyr = projGyr.GetData();
+	const FVector* dir = projDir.GetData();
+	const float* speed = projSpeed.GetData();
+	float* age = projAge.GetData();
+	FWarpCollision* track = projTrack.GetData();
+
+	ParallelFor(batches, [=](int32 b) {
+		const int32 end = std::min(n, (b + 1) * batch);
+		for (int32 i = b * batch; i < end; i++) {
+			FVector delta = dir[i] * TanK(k, speed[i] * DeltaTime);
+			FVector newVec;
+			FQuat newGyr;
+			MobiusAddGyrK(k, vec[i], gyr[i].Inverse() * delta, &newVec, &newGyr);
+			vec[i] = newVec;
+			gyr[i] = (gyr[i] * newGyr).GetNormalized();
+			age[i] += DeltaTime;
+			track[i].Update(GyroVectorD(vec[i], gyr[i]));
+		}
+	}, !bParallelStep || batches == 1);
+
+	expired.Reset();
+	for (int32 i = 0; i < n; i++) {
+		if (age[i] >= LifeSpan) {
+			expired.Add(i);
+		}
+	}
+
+	//Swap-remove from the back so pending indices stay valid
+	for (int32 i = expired.Num() - 1; i >= 0; i--) {
+		Remove(expired[i]);
+	}
+
+	PlaceColliders();
+}
+
+// Sweep each collision sphere to the level position of its projectile, so OnHit sees what it flies into
+// Objects are drawn with their pivot at their tile centre, so the local Klein position is taken from the centre of the tile's cell
+// A hit kills the projectile and the last one takes its index, walking backwards keeps the rest in place
+void AWarpProjectileManager::PlaceColliders()
+{
+	FWarpGeometryPtr geometry = GetWarpModule()->GetGeometry();
+	if (!geometry.IsValid()) {
+		return;
+	}
+
+	const float cellW = geometry->curvature.CELL_WIDTH;
+	const bool useTanKHeight = IsValid(hyper) && hyper->bWarpTanKHeight;
+
+	for (int32 i = projVisual.Num() - 1; i >= 0; i--)
+	{
+		if (i >= projVisual.Num() || !IsValid(projVisual[i])) {
+			continue;
+		}
+		AWarpProjectile* visual = projVisual[i];
+		int32 tile = projTrack[i].GetTile();
+
+		//Outside the map there is nothing to hit
+		bool inMap = tile != INDEX_NONE && tile < geometry->tiles.Num();
+		if (visual->GetActorEnableCollision() != inMap) {
+			visual->SetActorEnableCollision(inMap);
+		}
+		if (!inMap) {
+			continue;
+		}
+
+		FIntVector cell = geometry->tiles.cell[tile];
+		FVector centre = FVector(cell.X + 0.5f, geometry->lattice3D ? cell.Y + 0.5f : 0.0f, cell.Z + 0.5f) * cellW;
+		FVector unit = KleinToUnit(projTrack[i].GetLocalKlein(GetProjectileGV(i)), useTanKHeight);
+		visual->SetActorLocation((centre + unit) * 1000, true);
+	}
+}
+
+// Push composed matrices to projectile materials
+void AWarpProjectileManager::UpdateVisuals()
+{
+	if (!IsValid(hyper)) {
+		return;
+	}
+
+	GyroVectorD worldGV = hyper->GetWorldGV();
+	float n = (float)FModuleManager::GetModuleChecked<FWarpGameModule>("Warp").GetN();
+	float k = getK();
+	FVector4 rows[4];
+
+	for (int32 i = 0; i < projMaterial.Num(); i++)
+	{
+		UMaterialInstanceDynamic* materialInstanceDynamic = projMaterial[i];
+		if (!materialInstanceDynamic) {
+			continue;
+		}
+
+		ComposeToMatrixRows(k, GetProjectileGV(i), worldGV, rows);
+
+		materialInstanceDynamic->SetVectorParameterValue(hyp0, FLinearColor(rows[0].X, rows[0].Y, rows[0].Z, rows[0].W));
+		materialInstanceDynamic->SetVectorParameterValue(hyp1, FLinearColor(rows[1].X, rows[1].Y, rows[1].Z, rows[1].W));
+		materialInstanceDynamic->SetVectorParameterValue(hyp2, FLinearColor(rows[2].X, rows[2].Y, rows[2].Z, rows[2].W));
+		materialInstanceDynamic->SetVectorParameterValue(hyp3, FLinearColor(rows[3].X, rows[3].Y, rows[3].Z, rows[3].W));
+		materialInstanceDynamic->SetScalarParameterValue("N", n);
+	}
+}
+
+void AWarpProjectileManager::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	Step(DeltaTime);
+	UpdateVisuals();
+}
@@ -0,0 +1,113 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "Materials/MaterialInstanceDynamic.h"
+#include "Warp.h"
+#include "WarpProjectilePool.h"
+#include "WarpCollision.h"
+#include "WarpProjectileManager.generated.h"
+
+class AWarpProjectile;
+class AWarpHyperComponent;
+
+using namespace WarpMath;
+
+//Simulates every live projectile along hyperbolic geodesics
+//State is kept as contiguous arrays and advanced in one batched step per frame
+UCLASS()
+class WARP_API AWarpProjectileManager : public AActor
+{
+	GENERATED_BODY()
+
+	//Projectile gyrovectors (position and holonomy)
+	TArray<FVector> projVec;
+	TArray<FQuat> projGyr;
+
+	//Unit direction of flight in the projectile frame
+	TArray<FVector> projDir;
+	TArray<float> projSpeed;
+	TArray<float> projAge;
+
+	//Tile of each projectile, followed across faces as it flies
+	TArray<FWarpCollision> projTrack;
+
+	//Optional actors used to draw projectiles, may be null
+	//Their collision spheres are moved to the level position of the projectile every step
+	UPROPERTY(Transient)
+	TArray<AWarpProjectile*> projVisual;
+
+	UPROPERTY(Transient)
+	TArray<UMaterialInstanceDynamic*> projMaterial;
+
+	//Indices of projectiles expired during the last step
+	TArray<int32> expired;
+
+	UPROPERTY(Transient)
+	AWarpHyperComponent* hyper = nullptr;
+
+	FName hyp0 = TEXT("hyperRot0");
+	FName hyp1 = TEXT("hyperRot1");
+	FName hyp2 = TEXT("hyperRot2");
+	FName hyp3 = TEXT("hyperRot3");
+
+	void Remove(int32 ix);
+	void PlaceColliders();
+	void UpdateVisuals();
+
+public:
+	AWarpProjectileManager();
+
+	/** Hyperbolic speed of new projectiles, in gyrovector units per second */
+	UPROPERTY(EditAnywhere, Category = Projectile)
+	float ProjectileSpeed = 1.5f;
+
+	/** Seconds before a projectile expires */
+	UPROPERTY(EditAnywhere, Category = Projectile)
+	float LifeSpan = 3.0f;
+
+	/** Split the integration step across worker threads */
+	UPROPERTY(EditAnywhere, Category = Projectile)
+	bool bParallelStep = true;
+
+	/** Projectiles per worker batch */
+	UPROPERTY(EditAnywhere, Category = Projectile)
+	int32 BatchSize = 256;
+
+	/** Recycled projectile actors */
+	UPROPERTY(EditAnywhere, Category = Projectile)
+	FWarpProjectilePool Pool;
+
+	//Find the manager in the world, spawning one if needed
+	static AWarpProjectileManager* Get(UWorld* World);
+
+	//Spawn pooled projectile actors ahead of the first shot
+	void Prewarm(TSubclassOf<AWarpProjectile> Class) { Pool.Prewarm(GetWorld(), Class); }
+
+	//Take a projectile actor from the pool
+	AWarpProjectile* AcquireProjectile(TSubclassOf<AWarpProjectile> Class, const FVector& Location, const FRotator& Rotation);
+
+	//Add a projectile at gyrovector gv flying along dir (projectile frame)
+	int32 Spawn(GyroVectorD gv, FVector dir, float speed, AWarpProjectile* visual);
+
+	//Add a projectile at the player camera flying along an Unreal world direction
+	int32 SpawnFromCamera(FVector worldDir, AWarpProjectile* visual);
+
+	//Remove a projectile and return its actor to the pool
+	void Kill(int32 ix);
+
+	//Advance all projectiles along their geodesics
+	void Step(float DeltaTime);
+
+	int32 Num() const { return projVec.Num(); }
+	GyroVectorD GetProjectileGV(int32 ix) const { return GyroVectorD(projVec[ix], projGyr[ix]); }
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+public:
+	virtual void Tick(float DeltaTime) override;
+};
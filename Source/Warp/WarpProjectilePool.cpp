@@ -0,0 +1,88 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "WarpProjectilePool.h"
+#include "WarpProjectile.h"
+#include "Engine/World.h"
+
+AWarpProjectile* FWarpProjectilePool::SpawnParked(UWorld* World, TSubclassOf<AWarpProjectile> Class)
+{
+	FActorSpawnParameters ActorSpawnParams;
+	ActorSpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	AWarpProjectile* Projectile = World->SpawnActor<AWarpProjectile>(Class, ParkLocation, FRotator::ZeroRotator, ActorSpawnParams);
+	if (Projectile) {
+		Projectile->Park(ParkLocation);
+	}
+	return Projectile;
+}
+
+void FWarpProjectilePool::Prewarm(UWorld* World, TSubclassOf<AWarpProjectile> Class)
+{
+	if (!World || !Class) {
+		return;
+	}
+
+	Free.Reserve(Capacity);
+	while (Free.Num() + InUse < Capacity) {
+		AWarpProjectile* Projectile = SpawnParked(World, Class);
+		if (!Projectile) {
+			break;
+		}
+		Free.Add(Projectile);
+	}
+}
+
+AWarpProjectile* FWarpProjectilePool::Acquire(UWorld* World, TSubclassOf<AWarpProjectile> Class, const FVector& Location, const FRotator& Rotation)
+{
+	AWarpProjectile* Projectile = nullptr;
+
+	//Skip projectiles destroyed behind our back (level teardown)
+	while (Free.Num() > 0 && !Projectile) {
+		Projectile = Free.Pop(false);
+		if (!IsValid(Projectile)) {
+			Projectile = nullptr;
+		}
+	}
+
+	if (!Projectile) {
+		Misses++;
+		Projectile = SpawnParked(World, Class);
+		if (!Projectile) {
+			return nullptr;
+		}
+	}
+
+	Projectile->Unpark(Location, Rotation);
+
+	InUse++;
+	HighWater = FMath::Max(HighWater, InUse);
+	return Projectile;
+}
+
+void FWarpProjectilePool::Release(AWarpProjectile* Projectile)
+{
+	if (!IsValid(Projectile)) {
+		return;
+	}
+
+	InUse = FMath::Max(InUse - 1, 0);
+
+	if (Free.Num() + InUse >= Capacity) {
+		Projectile->Destroy();
+		return;
+	}
+
+	Projectile->Park(ParkLocation);
+	Free.Add(Projectile);
+}
+
+void FWarpProjectilePool::Empty()
+{
+	for (AWarpProjectile* Projectile : Free) {
+		if (IsValid(Projectile)) {
+			Projectile->Destroy();
+		}
+	}
+	Free.Empty();
+}
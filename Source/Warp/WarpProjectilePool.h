@@ -0,0 +1,51 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "WarpProjectilePool.generated.h"
+
+class AWarpProjectile;
+
+//Pre-warmed set of projectile actors
+//Released projectiles are reset, hidden and parked instead of destroyed
+USTRUCT()
+struct FWarpProjectilePool
+{
+	GENERATED_BODY()
+
+	/** Projectiles kept alive by the pool, spawned up front by Prewarm */
+	UPROPERTY(EditAnywhere, Category = Projectile)
+	int32 Capacity = 64;
+
+	/** Where parked projectiles wait */
+	UPROPERTY(EditAnywhere, Category = Projectile)
+	FVector ParkLocation = FVector(0.0f, 0.0f, -100000.0f);
+
+	//Spawn projectiles until Capacity are free or in use
+	void Prewarm(UWorld* World, TSubclassOf<AWarpProjectile> Class);
+
+	//Take a parked projectile, spawning a new one on a miss
+	AWarpProjectile* Acquire(UWorld* World, TSubclassOf<AWarpProjectile> Class, const FVector& Location, const FRotator& Rotation);
+
+	//Park a projectile, destroying it if the pool is full
+	void Release(AWarpProjectile* Projectile);
+
+	//Destroy every parked projectile
+	void Empty();
+
+	int32 NumFree() const { return Free.Num(); }
+	int32 NumInUse() const { return InUse; }
+	int32 GetHighWater() const { return HighWater; }
+	int32 GetMisses() const { return Misses; }
+
+private:
+	UPROPERTY(Transient)
+	TArray<AWarpProjectile*> Free;
+
+	int32 InUse = 0;
+	int32 HighWater = 0;
+	int32 Misses = 0;
+
+	AWarpProjectile* SpawnParked(UWorld* World, TSubclassOf<AWarpProjectile> Class);
+};
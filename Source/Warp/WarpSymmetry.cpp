@@ -0,0 +1,130 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "WarpSymmetry.h"
+#include <algorithm>
+
+//Axes the ops permute, Y stays put in 2D
+static const int8 AXES_2D[] = { 0, 2 };
+static const int8 AXES_3D[] = { 0, 1, 2 };
+
+//Axis and sign of each move, in ExpandTile order R L U D B F
+static const int8 MOVE_AXIS[] = { 0, 0, 2, 2, 1, 1 };
+static const int8 MOVE_SIGN[] = { 1, -1, 1, -1, 1, -1 };
+
+void FWarpSymmetry::Init(bool _lattice3D) {
+    lattice3D = _lattice3D;
+    const int8* axes = lattice3D ? AXES_3D : AXES_2D;
+    const int32 n = lattice3D ? 3 : 2;
+    FMemory::Memset(lookup, 0xFF, sizeof(lookup));
+
+    //Permutations in lexicographic order with every sign pattern, so op 0 is the identity
+    int8 perm[3] = { 0, 1, 2 };
+    num = 0;
+    do {
+        int32 inversions = 0;
+        for (int32 i = 0; i < n; ++i) {
+            for (int32 j = i + 1; j < n; ++j) {
+                inversions += perm[i] > perm[j] ? 1 : 0;
+            }
+        }
+        for (int32 s = 0; s < (1 << n); ++s) {
+            int8* a = axis[num];
+            int8* sg = sign[num];
+            a[0] = 0; a[1] = 1; a[2] = 2;
+            sg[0] = sg[1] = sg[2] = 1;
+            int32 d = (inversions & 1) ? -1 : 1;
+            for (int32 j = 0; j < n; ++j) {
+                a[axes[j]] = axes[perm[j]];
+                sg[axes[j]] = ((s >> j) & 1) ? -1 : 1;
+                d *= sg[axes[j]];
+            }
+            det[num] = (int8)d;
+            lookup[Key(a, sg)] = (int8)num;
+            num++;
+        }
+    } while (std::next_permutation(perm, perm + n));
+
+    for (int32 a = 0; a < num; ++a) {
+        for (int32 b = 0; b < num; ++b) {
+            int8 ca[3];
+            int8 cs[3];
+            for (int32 i = 0; i < 3; ++i) {
+                ca[i] = axis[b][axis[a][i]];
+                cs[i] = sign[a][i] * sign[b][axis[a][i]];
+            }
+            compose[a][b] = (uint8)lookup[Key(ca, cs)];
+            if (compose[a][b] == 0) {
+                inverse[a] = (uint8)b;
+            }
+        }
+
+        //A move along one axis comes out along the output axis that reads it
+        for (int32 m = 0; m < 6; ++m) {
+            int32 i = axis[a][0] == MOVE_AXIS[m] ? 0 : axis[a][1] == MOVE_AXIS[m] ? 1 : 2;
+            int32 s = sign[a][i] * MOVE_SIGN[m];
+            for (int32 k = 0; k < 6; ++k) {
+                if (MOVE_AXIS[k] == i && MOVE_SIGN[k] == s) {
+                    moves[a][m] = (uint8)k;
+                }
+            }
+        }
+    }
+}
+
+int32 FWarpSymmetry::ToSector(FVector v) const {
+    const int8* axes = lattice3D ? AXES_3D : AXES_2D;
+    const int32 n = lattice3D ? 3 : 2;
+
+    //Sort the permuted axes by magnitude, ties keep axis order
+    int8 order[3];
+    for (int32 j = 0; j < n; ++j) {
+        order[j] = axes[j];
+        for (int32 k = j; k > 0 && FMath::Abs(v[order[k]]) > FMath::Abs(v[order[k - 1]]); --k) {
+            Swap(order[k], order[k - 1]);
+        }
+    }
+
+    int8 a[3] = { 0, 1, 2 };
+    int8 sg[3] = { 1, 1, 1 };
+    for (int32 j = 0; j < n; ++j) {
+        a[axes[j]] = order[j];
+        sg[axes[j]] = v[order[j]] < 0.0f ? -1 : 1;
+    }
+    return lookup[Key(a, sg)];
+}
+
+SIZE_T FWarpSymmetryState::BytesFor(int32 capacity, bool lattice3D) {
+    int32 ops = lattice3D ? 48 : 8;
+    int32 orbits = OrbitsFor(capacity, lattice3D);
+    int32 count = orbits * (lattice3D ? 6 : 4);
+    return FWarpArena::ArrayBytes<int32>(capacity) + FWarpArena::ArrayBytes<uint8>(capacity) +
+        FWarpArena::ArrayBytes<int32>(orbits * ops) + FWarpArena::ArrayBytes<uint8>(orbits * ops) +
+        FWarpArena::ArrayBytes<GyroVectorD>(count) + FWarpArena::ArrayBytes<uint8>(count) + FWarpArena::ArrayBytes<bool>(count) +
+        FWarpArena::ArrayBytes<int32>(count) + FWarpArena::ArrayBytes<Tile>(count) + TileIndex::BytesFor(count) +
+        FWarpArena::ArrayBytes<uint8>(orbits * ops) + FWarpArena::ArrayBytes<FChild>(orbits * ops);
+}
+
+bool FWarpSymmetryState::Init(FWarpArena* arena, int32 capacity, bool lattice3D) {
+    group.Init(lattice3D);
+    orbitCapacity = OrbitsFor(capacity, lattice3D);
+    orbit = arena->AllocArray<int32>(capacity);
+    element = arena->AllocArray<uint8>(capacity);
+    images = arena->AllocArray<int32>(orbitCapacity * group.num);
+    frames = arena->AllocArray<uint8>(orbitCapacity * group.num);
+    valid = orbit && element && images && frames;
+    if (!valid) {
+        return false;
+    }
+    orbit[0] = 0;
+    element[0] = 0;
+    for (int32 e = 0; e < group.num; ++e) {
+        images[e] = 0;
+        frames[e] = (uint8)e;
+    }
+    numOrbits = 1;
+    ringBegin = 0;
+    ringEnd = 1;
+    ring = 1;
+    return true;
+}
@@ -0,0 +1,89 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Warp.h"
+
+using namespace WarpMath;
+
+//Symmetries of the origin tile as signed permutations of the lattice axes
+//The square (2D) has 8, swapping and flipping X and Z; the cube (3D) has all 48 of X, Y and Z
+//They fix the origin, so they commute with Mobius addition and map the tiling onto itself
+struct FWarpSymmetry {
+    static const int32 MAX_OPS = 48;
+
+    int32 num = 0;
+    int8 axis[MAX_OPS][3];      //Output component i is sign[i] times input component axis[i]
+    int8 sign[MAX_OPS][3];
+    int8 det[MAX_OPS];          //-1 for reflections, the gyration axis is a pseudovector and flips with them
+    uint8 compose[MAX_OPS][MAX_OPS];    //compose[a][b] applies b, then a
+    uint8 inverse[MAX_OPS];
+    uint8 moves[MAX_OPS][6];    //Image of each move, in ExpandTile order R L U D B F
+
+    void Init(bool lattice3D);
+
+    FVector Apply(int32 op, FVector v) const {
+        return FVector(sign[op][0] * v[axis[op][0]], sign[op][1] * v[axis[op][1]], sign[op][2] * v[axis[op][2]]);
+    }
+
+    //Members are set directly, so an unnormalized identity gyration stays as it is
+    GyroVectorD Apply(int32 op, const GyroVectorD& gv) const {
+        GyroVectorD out;
+        out.vec = Apply(op, gv.vec);
+        FVector q = Apply(op, FVector(gv.gyr.X, gv.gyr.Y, gv.gyr.Z)) * det[op];
+        out.gyr = FQuat(q.X, q.Y, q.Z, gv.gyr.W);
+        return out;
+    }
+
+    //Op taking v into the fundamental sector, X >= Z >= 0 in 2D and X >= Y >= Z >= 0 in 3D
+    int32 ToSector(FVector v) const;
+
+private:
+    bool lattice3D = false;
+    int8 lookup[27 * 8];
+
+    static int32 Key(const int8* axis, const int8* sign) {
+        return ((axis[0] * 3 + axis[1]) * 3 + axis[2]) * 8 + (sign[0] < 0 ? 1 : 0) + (sign[1] < 0 ? 2 : 0) + (sign[2] < 0 ? 4 : 0);
+    }
+};
+
+//Orbit bookkeeping for symmetric generation, in the generation arena after the tile set
+//Tile t is element[t] applied to the first tile of orbit[t], images holds every element's image of that first tile
+//A tile on a mirror or rotation axis is fixed by several elements that can disagree on its gyration,
+//frames holds the one that gives the gyration the tile was generated with, which decides how its moves map
+//Orbits are added ring by ring, the ones of the last expanded ring are [ringBegin, ringEnd)
+struct FWarpSymmetryState {
+    FWarpSymmetry group;
+    int32* orbit = nullptr;
+    uint8* element = nullptr;
+    int32* images = nullptr;
+    uint8* frames = nullptr;
+    int32 orbitCapacity = 0;
+    int32 numOrbits = 0;
+    int32 ringBegin = 0;
+    int32 ringEnd = 0;
+    int32 ring = 0;
+    bool valid = false;
+
+    //A tile of the next ring, keyed by its first generator as parent * 8 + move
+    //The generator is a candidate of a first tile seen through the parent's frame
+    struct FChild {
+        int64 key;
+        int32 orbit;
+        int32 candidate;
+        uint8 op;
+        uint8 frame;
+    };
+
+    //Most orbits have as many tiles as the group has elements, only tiles on mirror planes have fewer
+    static int32 OrbitsFor(int32 capacity, bool lattice3D) {
+        return capacity * 2 / (lattice3D ? 48 : 8) + 64;
+    }
+
+    //Arena bytes for the orbit tables and the scratch of the largest possible ring
+    static SIZE_T BytesFor(int32 capacity, bool lattice3D);
+
+    //Start from the origin tile, which is its own orbit fixed by every element
+    bool Init(FWarpArena* arena, int32 capacity, bool lattice3D);
+};
@@ -0,0 +1,118 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "WarpVertexWarp.h"
+#include "Async/ParallelFor.h"
+#include <algorithm>
+
+namespace WarpVertexWarp {
+
+    void ToPoincare(float k, float kv, bool useTanKHeight, const FVector* unit, int32 num, float* x, float* y, float* z, bool parallel) {
+        const int32 batches = (num + BATCH - 1) / BATCH;
+        ParallelFor(batches, [=](int32 b) {
+            const int32 end = std::min(num, (b + 1) * BATCH);
+            for (int32 i = b * BATCH; i < end; ++i) {
+                //UnitToKlein, the height goes through TanK so it stays scalar
+                FVector p = unit[i] * kv;
+                if (useTanKHeight) {
+                    p.Y = TanK(k, p.Y) * sqrt(1.0f + k * (p.X * p.X + p.Z * p.Z));
+                }
+                x[i] = p.X;
+                y[i] = p.Y;
+                z[i] = p.Z;
+            }
+            //KleinToPoincare
+            if (k != 0.0f) {
+                for (int32 i = b * BATCH; i < end; ++i) {
+                    float s = 1.0f / (FMath::Sqrt(FMath::Max(0.0f, 1.0f + k * (x[i] * x[i] + y[i] * y[i] + z[i] * z[i]))) + 1.0f);
+                    x[i] *= s;
+                    y[i] *= s;
+                    z[i] *= s;
+                }
+            }
+        }, !parallel || batches <= 1);
+    }
+
+    void Transform(float k, const GyroVectorD& gv, const float* x, const float* y, const float* z, int32 num, FVector* out, bool parallel) {
+        const float ax = gv.vec.X;
+        const float ay = gv.vec.Y;
+        const float az = gv.vec.Z;
+
+        //gyr as a matrix, built with the quaternion rotation so an unnormalized identity stays the identity
+        const FVector c0 = gv.gyr.RotateVector(FVector(1, 0, 0));
+        const FVector c1 = gv.gyr.RotateVector(FVector(0, 1, 0));
+        const FVector c2 = gv.gyr.RotateVector(FVector(0, 0, 1));
+
+        const int32 batches = (num + BATCH - 1) / BATCH;
+        ParallelFor(batches, [=](int32 b) {
+            const int32 begin = b * BATCH;
+            const int32 count = std::min(num - begin, BATCH);
+            const float* bx = x + begin;
+            const float* by = y + begin;
+            const float* bz = z + begin;
+            float ox[BATCH];
+            float oy[BATCH];
+            float oz[BATCH];
+
+            //MobiusAdd(vec, p) then the rotation, on planes so every lane does the same work
+            for (int32 i = 0; i < count; ++i) {
+                float cx = k * (ay * bz[i] - az * by[i]);
+                float cy = k * (az * bx[i] - ax * bz[i]);
+                float cz = k * (ax * by[i] - ay * bx[i]);
+                float d = 1.0f - k * (ax * bx[i] + ay * by[i] + az * bz[i]);
+                float tx = ax + bx[i];
+                float ty = ay + by[i];
+                float tz = az + bz[i];
+                float inv = 1.0f / (d * d + cx * cx + cy * cy + cz * cz);
+                float mx = (tx * d + cy * tz - cz * ty) * inv;
+                float my = (ty * d + cz * tx - cx * tz) * inv;
+                float mz = (tz * d + cx * ty - cy * tx) * inv;
+                ox[i] = c0.X * mx + c1.X * my + c2.X * mz;
+                oy[i] = c0.Y * mx + c1.Y * my + c2.Y * mz;
+                oz[i] = c0.Z * mx + c1.Z * my + c2.Z * mz;
+            }
+            FVector* o = out + begin;
+            for (int32 i = 0; i < count; ++i) {
+                o[i] = FVector(ox[i], oy[i], oz[i]);
+            }
+        }, !parallel || batches <= 1);
+    }
+
+}
+
+void FWarpVertexCache::SetVertices(const FVector* _unit, int32 num, bool _useTanKHeight) {
+    unit.SetNumUninitialized(num);
+    FMemory::Memcpy(unit.GetData(), _unit, num * sizeof(FVector));
+    ballX.SetNumUninitialized(num);
+    ballY.SetNumUninitialized(num);
+    ballZ.SetNumUninitialized(num);
+    warped.SetNumUninitialized(num);
+    useTanKHeight = _useTanKHeight;
+    ballValid = false;
+    warpedValid = false;
+}
+
+const TArray<FVector>& FWarpVertexCache::Warp(const GyroVectorD& local, const GyroVectorD& world, bool parallel) {
+    const float curK = getK();
+    const float curKV = getKV();
+
+    //A geometry switch changes the ball positions themselves
+    if (!ballValid || curK != k || curKV != kv) {
+        k = curK;
+        kv = curKV;
+        WarpVertexWarp::ToPoincare(k, kv, useTanKHeight, unit.GetData(), unit.Num(), ballX.GetData(), ballY.GetData(), ballZ.GetData(), parallel);
+        ballValid = true;
+        warpedValid = false;
+    }
+
+    GyroVectorD gv = add(local, world);
+    if (warpedValid && gv.vec == composed.vec && gv.gyr == composed.gyr) {
+        hits++;
+        return warped;
+    }
+    composed = gv;
+    WarpVertexWarp::Transform(k, gv, ballX.GetData(), ballY.GetData(), ballZ.GetData(), unit.Num(), warped.GetData(), parallel);
+    warpedValid = true;
+    recomputes++;
+    return warped;
+}
@@ -0,0 +1,63 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Warp.h"
+
+using namespace WarpMath;
+
+//CPU version of the vertex warp the hyperbolic materials do on the GPU
+//
+//A vertex in unit coordinates goes to the Klein model, then to the Poincare ball, then is moved by the object's
+//composed gyrovector, apply(add(local, world), UnitToPoincare(v)). Only the last step depends on the transform,
+//so the ball positions of a mesh are kept as X, Y and Z planes and the transform runs over them in fixed batches
+//of branch-free float loops the compiler vectorizes, one batch per worker task
+namespace WarpVertexWarp {
+
+    //Vertices per batch
+    static const int32 BATCH = 1024;
+
+    //UnitToPoincare for curvature k and Klein scale kv, into planes of num floats
+    void ToPoincare(float k, float kv, bool useTanKHeight, const FVector* unit, int32 num, float* x, float* y, float* z, bool parallel);
+
+    //apply(gv, p) for every ball position p, out holds num vectors
+    void Transform(float k, const GyroVectorD& gv, const float* x, const float* y, const float* z, int32 num, FVector* out, bool parallel);
+
+}
+
+//Warped vertices of one mesh, recomputed only when its composed gyrovector or the curvature changes
+class WARP_API FWarpVertexCache
+{
+public:
+    //Mesh vertices in unit coordinates, nothing is warped until the first Warp
+    void SetVertices(const FVector* unit, int32 num, bool useTanKHeight);
+
+    //The mesh as drawn with local added to world, straight from the cache when neither changed
+    const TArray<FVector>& Warp(const GyroVectorD& local, const GyroVectorD& world, bool parallel = true);
+
+    int32 Num() const { return unit.Num(); }
+    const TArray<FVector>& GetWarped() const { return warped; }
+
+    //Warps that ran the transform, and ones the cache answered
+    int32 GetRecomputes() const { return recomputes; }
+    int32 GetHits() const { return hits; }
+
+private:
+    TArray<FVector> unit;
+    TArray<float> ballX;
+    TArray<float> ballY;
+    TArray<float> ballZ;
+    TArray<FVector> warped;
+
+    //What the planes and warped vertices were made with
+    GyroVectorD composed;
+    float k = 0.0f;
+    float kv = 0.0f;
+    bool useTanKHeight = false;
+    bool ballValid = false;
+    bool warpedValid = false;
+
+    int32 recomputes = 0;
+    int32 hits = 0;
+};
@@ -0,0 +1,517 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "WarpVisibility.h"
+#include "Warp.h"
+#include "Async/ParallelFor.h"
+#include "Misc/Compression.h"
+
+namespace WarpVisibility {
+
+    static const uint32 MAGIC = 0x56505257;    //"WRPV"
+    static const uint32 VERSION = 3;    //Rows index tiles in FWarpTileStore order, sets are clipped through portals
+
+    //Portals are widened by this fraction so lines grazing a corner, or lost to rounding, still pass
+    static const double PORTAL_MARGIN = 0.01;
+
+    //Distance of the constraint hull from the origin below which no sightline is left
+    static const double BLOCKED = 1e-9;
+
+    //Rows in a nearest point set, one more than the 6 Plucker coordinates
+    static const int32 MAX_SET = 7;
+    static const int32 MAX_ITERATIONS = 256;
+
+    //Corners of a face in move order R, L, U, D, B, F, going round it, tiles in the plane use the first two
+    //Corner c is at +-face on X (bit 0), Z (bit 1) and Y (bit 2)
+    static const int32 FACE_CORNERS[6][4] = { { 1, 3, 7, 5 }, { 0, 2, 6, 4 }, { 2, 3, 7, 6 }, { 0, 1, 5, 4 }, { 4, 5, 7, 6 }, { 0, 1, 3, 2 } };
+
+    struct FHeader {
+        uint32 magic;
+        uint32 version;
+        int32 tiles;
+        int32 words;
+        int32 rawSize;
+        int32 packedSize;
+    };
+
+    struct FFooter {
+        int32 size;
+        uint32 magic;
+    };
+
+    //Portals are clipped in double, map Klein coordinates of small tiles are close together
+    struct FPoint {
+        double X, Y, Z;
+        FPoint() : X(0.0), Y(0.0), Z(0.0) {}
+        FPoint(const FVector& v) : X(v.X), Y(v.Y), Z(v.Z) {}
+        FPoint(double x, double y, double z) : X(x), Y(y), Z(z) {}
+        FPoint operator+(const FPoint& o) const { return FPoint(X + o.X, Y + o.Y, Z + o.Z); }
+        FPoint operator-(const FPoint& o) const { return FPoint(X - o.X, Y - o.Y, Z - o.Z); }
+        FPoint operator*(double s) const { return FPoint(X * s, Y * s, Z * s); }
+    };
+
+    static double Dot(const FPoint& a, const FPoint& b) {
+        return a.X * b.X + a.Y * b.Y + a.Z * b.Z;
+    }
+
+    static FPoint Cross(const FPoint& a, const FPoint& b) {
+        return FPoint(a.Y * b.Z - a.Z * b.Y, a.Z * b.X - a.X * b.Z, a.X * b.Y - a.Y * b.X);
+    }
+
+    //One constraint on a sightline L, a line through every portal so far has row . L > 0 for all rows
+    //L is (a, b, c) of ax + bz + c = 0 in the plane and Plucker coordinates (direction, moment) in honeycombs
+    struct FRow {
+        double v[6];
+    };
+
+    static double Dot(const FRow& a, const FRow& b) {
+        double sum = 0.0;
+        for (int32 i = 0; i < 6; ++i) {
+            sum += a.v[i] * b.v[i];
+        }
+        return sum;
+    }
+
+    //Tiles map local points x to vec + gyr^-1 x, the same way neighbours are spawned
+    static FVector ToMap(const GyroVectorD& gv, FVector x) {
+        return MobiusAdd(gv.vec, gv.gyr.Inverse() * x);
+    }
+
+    //Rows for lines leaving a tile through one face, false if the face has no size left to clip against
+    //Faces are geodesic, so straight in map Klein coordinates, lines through them in the Plucker case
+    //are only bounded by the side of each edge, dropping the Plucker quadric only lets more lines through
+    static bool AddPortal(const FVector* corners, const FVector& centre, int32 face, bool lattice3D, TArray<FRow>* rows) {
+
+        const int32 count = lattice3D ? 4 : 2;
+        FPoint v[4];
+        FPoint mid;
+        for (int32 i = 0; i < count; ++i) {
+            v[i] = FPoint(corners[FACE_CORNERS[face][i]]);
+            mid = mid + v[i];
+        }
+        mid = mid * (1.0 / count);
+        for (int32 i = 0; i < count; ++i) {
+            v[i] = mid + (v[i] - mid) * (1.0 + PORTAL_MARGIN);
+        }
+        FPoint through = mid - FPoint(centre);
+
+        int32 first = rows->Num();
+        if (!lattice3D) {
+            //Seen along the way through, the left end goes above the line and the right end below
+            FPoint side = v[1] - v[0];
+            bool flip = through.X * side.Z - through.Z * side.X < 0.0;
+            const FPoint& left = flip ? v[0] : v[1];
+            const FPoint& right = flip ? v[1] : v[0];
+            rows->Add({ { left.X, left.Z, 1.0, 0.0, 0.0, 0.0 } });
+            rows->Add({ { -right.X, -right.Z, -1.0, 0.0, 0.0, 0.0 } });
+        }
+        else {
+            //Side of the line against each edge, signed so the line from the centre through the face is positive
+            FPoint moment = Cross(mid, through);
+            for (int32 i = 0; i < 4; ++i) {
+                const FPoint& p = v[i];
+                const FPoint& q = v[(i + 1) % 4];
+                FPoint pq = Cross(p, q);
+                FPoint edge = q - p;
+                rows->Add({ { pq.X, pq.Y, pq.Z, edge.X, edge.Y, edge.Z } });
+            }
+            const FRow& row = (*rows)[first];
+            if (row.v[0] * through.X + row.v[1] * through.Y + row.v[2] * through.Z + row.v[3] * moment.X + row.v[4] * moment.Y + row.v[5] * moment.Z < 0.0) {
+                for (int32 r = first; r < rows->Num(); ++r) {
+                    for (double& x : (*rows)[r].v) {
+                        x = -x;
+                    }
+                }
+            }
+        }
+
+        for (int32 r = first; r < rows->Num(); ++r) {
+            FRow& row = (*rows)[r];
+            double length = FMath::Sqrt(Dot(row, row));
+            if (!(length > 1e-30)) {
+                rows->SetNum(first, false);
+                return false;
+            }
+            for (double& x : row.v) {
+                x /= length;
+            }
+        }
+        return true;
+    }
+
+    //Weights summing to one that bring a combination of rows closest to the origin, false if the rows are degenerate
+    static bool AffineMinimum(const TArray<FRow>& rows, const int32* set, int32 num, double* alpha) {
+
+        double m[MAX_SET + 1][MAX_SET + 2];
+        const int32 size = num + 1;
+        for (int32 i = 0; i < num; ++i) {
+            for (int32 j = 0; j < num; ++j) {
+                m[i][j] = Dot(rows[set[i]], rows[set[j]]);
+            }
+            m[i][num] = 1.0;
+            m[i][size] = 0.0;
+        }
+        for (int32 j = 0; j < num; ++j) {
+            m[num][j] = 1.0;
+        }
+        m[num][num] = 0.0;
+        m[num][size] = 1.0;
+
+        for (int32 c = 0; c < size; ++c) {
+            int32 pivot = c;
+            for (int32 r = c + 1; r < size; ++r) {
+                if (FMath::Abs(m[r][c]) > FMath::Abs(m[pivot][c])) {
+                    pivot = r;
+                }
+            }
+            if (FMath::Abs(m[pivot][c]) < 1e-14) {
+                return false;
+            }
+            if (pivot != c) {
+                for (int32 j = 0; j <= size; ++j) {
+                    Swap(m[c][j], m[pivot][j]);
+                }
+            }
+            for (int32 r = 0; r < size; ++r) {
+                if (r != c) {
+                    double f = m[r][c] / m[c][c];
+                    for (int32 j = c; j <= size; ++j) {
+                        m[r][j] -= f * m[c][j];
+                    }
+                }
+            }
+        }
+        for (int32 i = 0; i < num; ++i) {
+            alpha[i] = m[i][size] / m[i][i];
+        }
+        return true;
+    }
+
+    //Distance from the origin to the convex hull of the rows (Wolfe's nearest point algorithm)
+    //Some line passes every portal exactly when no non-negative mix of rows is zero (Gordan), so when this is above 0
+    //Stopping early returns the distance of a point in the hull, which can only overstate it and keep a tile visible
+    static double HullDistance(const TArray<FRow>& rows) {
+
+        int32 set[MAX_SET];
+        double lambda[MAX_SET];
+        double alpha[MAX_SET];
+        int32 num = 1;
+        set[0] = 0;
+        lambda[0] = 1.0;
+        FRow x = rows[0];
+
+        for (int32 iteration = 0; iteration < MAX_ITERATIONS; ++iteration) {
+            double xx = Dot(x, x);
+            int32 nearest = 0;
+            double least = DBL_MAX;
+            for (int32 r = 0; r < rows.Num(); ++r) {
+                double d = Dot(x, rows[r]);
+                if (d < least) {
+                    least = d;
+                    nearest = r;
+                }
+            }
+            if (xx < BLOCKED * BLOCKED || xx - least <= 1e-12) {
+                return FMath::Sqrt(xx);
+            }
+            for (int32 i = 0; i < num; ++i) {
+                if (set[i] == nearest) {
+                    return FMath::Sqrt(xx);
+                }
+            }
+            if (num == MAX_SET) {
+                return FMath::Sqrt(xx);
+            }
+            set[num] = nearest;
+            lambda[num] = 0.0;
+            num++;
+
+            //Move to the nearest point of the affine hull of the set, dropping rows whose weight runs out on the way
+            for (;;) {
+                if (!AffineMinimum(rows, set, num, alpha)) {
+                    return FMath::Sqrt(xx);
+                }
+                bool inside = true;
+                for (int32 i = 0; i < num; ++i) {
+                    inside &= alpha[i] > 0.0;
+                }
+                if (inside) {
+                    FMemory::Memcpy(lambda, alpha, num * sizeof(double));
+                    break;
+                }
+                double theta = 1.0;
+                for (int32 i = 0; i < num; ++i) {
+                    if (alpha[i] <= 0.0) {
+                        theta = FMath::Min(theta, lambda[i] / (lambda[i] - alpha[i]));
+                    }
+                }
+                int32 kept = 0;
+                for (int32 i = 0; i < num; ++i) {
+                    double l = lambda[i] + theta * (alpha[i] - lambda[i]);
+                    if (l > 1e-12) {
+                        set[kept] = set[i];
+                        lambda[kept] = l;
+                        kept++;
+                    }
+                }
+                if (kept == num) {
+                    return FMath::Sqrt(xx);
+                }
+                num = kept;
+            }
+
+            x = FRow();
+            for (int32 i = 0; i < num; ++i) {
+                for (int32 j = 0; j < 6; ++j) {
+                    x.v[j] += lambda[i] * rows[set[i]].v[j];
+                }
+            }
+        }
+        return FMath::Sqrt(Dot(x, x));
+    }
+
+    //Depth first walk through portals from one tile, a tile is reached while some line still passes every portal on the way to it
+    //Lines from anywhere in the start tile count, the first portal is one of its faces so every line through it crosses the tile
+    struct FPortalWalk {
+        const FWarpGeometry& geometry;
+        const TArray<FVector>& corners;
+        const TArray<FVector>& centres;
+        const int32 numFaces;
+        TArray<FRow> rows;
+        TArray<int32> path;
+        TArray<int32>* seen;
+        int32 budget;
+
+        FPortalWalk(const FWarpGeometry& _geometry, const TArray<FVector>& _corners, const TArray<FVector>& _centres, TArray<int32>* _seen, int32 _budget)
+            : geometry(_geometry), corners(_corners), centres(_centres), numFaces(_geometry.lattice3D ? 6 : 4), seen(_seen), budget(_budget) {
+        }
+
+        //False once the budget runs out or a portal cannot be clipped against
+        bool Walk(int32 tile) {
+            for (int32 f = 0; f < numFaces; ++f) {
+                int32 next = geometry.Neighbour(tile, f);
+                //A convex tile is never entered twice by one line
+                if (next == INDEX_NONE || path.Contains(next)) {
+                    continue;
+                }
+                if (!TileIndex::IsFinite(geometry.tiles.vec[next])) {
+                    seen->Add(next);
+                    continue;
+                }
+                if (--budget < 0) {
+                    return false;
+                }
+                int32 num = rows.Num();
+                if (!AddPortal(corners.GetData() + tile * 8, centres[tile], f, geometry.lattice3D, &rows)) {
+                    return false;
+                }
+                if (HullDistance(rows) > BLOCKED) {
+                    seen->Add(next);
+                    path.Add(next);
+                    bool open = Walk(next);
+                    path.Pop(false);
+                    if (!open) {
+                        return false;
+                    }
+                }
+                rows.SetNum(num, false);
+            }
+            return true;
+        }
+    };
+
+    //Every tile connected to one, what a walk falls back to when it cannot finish
+    static void Flood(const FWarpGeometry& geometry, int32 tile, TArray<int32>* seen) {
+        const int32 numFaces = geometry.lattice3D ? 6 : 4;
+        TBitArray<> reached(false, geometry.tiles.Num());
+        seen->Reset();
+        seen->Add(tile);
+        reached[tile] = true;
+        for (int32 i = 0; i < seen->Num(); ++i) {
+            for (int32 f = 0; f < numFaces; ++f) {
+                int32 next = geometry.Neighbour((*seen)[i], f);
+                if (next != INDEX_NONE && !reached[next]) {
+                    reached[next] = true;
+                    seen->Add(next);
+                }
+            }
+        }
+    }
+
+    void Compute(const FWarpGeometry& geometry, int32 budget, FWarpVisibility* out) {
+
+        const int32 n = geometry.tiles.Num();
+        const bool lattice3D = geometry.lattice3D;
+        *out = FWarpVisibility();
+        if (n == 0 || geometry.neighbours.Num() != n * FWarpGeometry::FACES) {
+            return;
+        }
+
+        //Klein coordinates are doubled except in flat space
+        const float face = geometry.curvature.K == 0.0f ? geometry.curvature.CELL_WIDTH * 0.5f : geometry.curvature.CELL_WIDTH;
+        const int32 numFaces = lattice3D ? 6 : 4;
+
+        //Corners and centres of every tile in map Klein coordinates
+        TArray<FVector> corners;
+        TArray<FVector> centres;
+        corners.SetNumUninitialized(n * 8);
+        centres.SetNumUninitialized(n);
+        ParallelFor(n, [&](int32 t) {
+            FScopedCurvature scope(geometry.curvature);
+            GyroVectorD gv = geometry.tiles.GV(t);
+            centres[t] = PoincareToKlein(gv.vec);
+            for (int32 c = 0; c < 8; ++c) {
+                FVector corner((c & 1) ? face : -face, lattice3D ? ((c & 4) ? face : -face) : 0.0f, (c & 2) ? face : -face);
+                corners[t * 8 + c] = PoincareToKlein(ToMap(gv, KleinToPoincare(corner)));
+            }
+        });
+
+        TArray<TArray<int32>> rows;
+        rows.SetNum(n);
+        ParallelFor(n, [&](int32 t) {
+            TArray<int32>& row = rows[t];
+            row.Add(t);
+            if (!TileIndex::IsFinite(geometry.tiles.vec[t])) {
+                return;
+            }
+
+            //Lines are only straight in Klein coordinates on one side of a sphere's equator, closed maps see everything
+            if (geometry.curvature.K > 0.0f) {
+                Flood(geometry, t, &row);
+            }
+            else {
+                FPortalWalk walk(geometry, corners, centres, &row, budget);
+                walk.path.Add(t);
+                if (!walk.Walk(t)) {
+                    Flood(geometry, t, &row);
+                }
+            }
+
+            //Objects overlap the tiles next to theirs
+            int32 reached = row.Num();
+            for (int32 i = 0; i < reached; ++i) {
+                for (int32 f = 0; f < numFaces; ++f) {
+                    int32 next = geometry.Neighbour(row[i], f);
+                    if (next != INDEX_NONE) {
+                        row.Add(next);
+                    }
+                }
+            }
+            row.Sort();
+            int32 unique = 0;
+            for (int32 i = 0; i < row.Num(); ++i) {
+                if (unique == 0 || row[unique - 1] != row[i]) {
+                    row[unique++] = row[i];
+                }
+            }
+            row.SetNum(unique, false);
+        });
+
+        out->first.SetNumUninitialized(n);
+        out->offset.SetNumUninitialized(n + 1);
+        out->offset[0] = 0;
+        for (int32 t = 0; t < n; ++t) {
+            const TArray<int32>& row = rows[t];
+            int32 first = row[0] >> 5;
+            int32 count = (row.Last() >> 5) - first + 1;
+            out->first[t] = first;
+            out->offset[t + 1] = out->offset[t] + count;
+            out->words.AddZeroed(count);
+            uint32* words = out->words.GetData() + out->offset[t];
+            for (int32 v : row) {
+                words[(v >> 5) - first] |= 1u << (v & 31);
+            }
+        }
+    }
+
+    int32 TrailerSize(const TArray<uint8>& data) {
+        int32 n = data.Num();
+        if (n < (int32)(sizeof(FHeader) + sizeof(FFooter))) {
+            return 0;
+        }
+        FFooter footer;
+        FMemory::Memcpy(&footer, data.GetData() + n - sizeof(FFooter), sizeof(FFooter));
+        if (footer.magic != MAGIC || footer.size < (int32)(sizeof(FHeader) + sizeof(FFooter)) || footer.size > n) {
+            return 0;
+        }
+        FHeader header;
+        FMemory::Memcpy(&header, data.GetData() + n - footer.size, sizeof(FHeader));
+        return header.magic == MAGIC ? footer.size : 0;
+    }
+
+    void Append(const FWarpVisibility& visibility, int32 tiles, TArray<uint8>* data) {
+
+        data->SetNum(data->Num() - TrailerSize(*data), false);
+        if (!visibility.IsValid() || visibility.first.Num() != tiles) {
+            return;
+        }
+
+        TArray<uint8> raw;
+        int32 words = visibility.words.Num();
+        raw.Reserve((tiles * 2 + words) * sizeof(int32));
+        raw.Append((const uint8*)visibility.first.GetData(), tiles * sizeof(int32));
+        for (int32 t = 0; t < tiles; ++t) {
+            int32 count = visibility.offset[t + 1] - visibility.offset[t];
+            raw.Append((const uint8*)&count, sizeof(int32));
+        }
+        raw.Append((const uint8*)visibility.words.GetData(), words * sizeof(uint32));
+
+        int32 bound = FCompression::CompressMemoryBound(NAME_Zlib, raw.Num());
+        int32 start = data->Num();
+        data->AddUninitialized(sizeof(FHeader) + bound);
+        int32 packedSize = bound;
+        if (!FCompression::CompressMemory(NAME_Zlib, data->GetData() + start + sizeof(FHeader), packedSize, raw.GetData(), raw.Num(), COMPRESS_BiasMemory)) {
+            data->SetNum(start, false);
+            return;
+        }
+        data->SetNum(start + sizeof(FHeader) + packedSize, false);
+
+        FHeader header = { MAGIC, VERSION, tiles, words, raw.Num(), packedSize };
+        FMemory::Memcpy(data->GetData() + start, &header, sizeof(FHeader));
+        FFooter footer = { (int32)(sizeof(FHeader) + packedSize + sizeof(FFooter)), MAGIC };
+        data->Append((const uint8*)&footer, sizeof(FFooter));
+    }
+
+    bool Read(const TArray<uint8>& data, int32 tiles, FWarpVisibility* out) {
+
+        *out = FWarpVisibility();
+        int32 size = TrailerSize(data);
+        if (size == 0) {
+            return false;
+        }
+        FHeader header;
+        const uint8* start = data.GetData() + data.Num() - size;
+        FMemory::Memcpy(&header, start, sizeof(FHeader));
+        if (header.version != VERSION || header.tiles != tiles || header.words < 0 ||
+            header.packedSize > size - (int32)(sizeof(FHeader) + sizeof(FFooter)) ||
+            header.rawSize != (int32)((tiles * 2 + header.words) * sizeof(int32))) {
+            return false;
+        }
+
+        TArray<uint8> raw;
+        raw.SetNumUninitialized(header.rawSize);
+        if (!FCompression::UncompressMemory(NAME_Zlib, raw.GetData(), header.rawSize, start + sizeof(FHeader), header.packedSize)) {
+            return false;
+        }
+
+        const int32* ints = (const int32*)raw.GetData();
+        out->first.Append(ints, tiles);
+        out->offset.SetNumUninitialized(tiles + 1);
+        out->offset[0] = 0;
+        for (int32 t = 0; t < tiles; ++t) {
+            int32 count = ints[tiles + t];
+            if (count < 0 || out->first[t] < 0) {
+                *out = FWarpVisibility();
+                return false;
+            }
+            out->offset[t + 1] = out->offset[t] + count;
+        }
+        if (out->offset[tiles] != header.words) {
+            *out = FWarpVisibility();
+            return false;
+        }
+        out->words.Append((const uint32*)(ints + tiles * 2), header.words);
+        return true;
+    }
+
+}
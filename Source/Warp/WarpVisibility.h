@@ -0,0 +1,33 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FWarpGeometry;
+struct FWarpVisibility;
+
+//Potentially visible sets between tiles
+//
+//Geodesics are straight lines in the Klein model, so tile faces are flat polygons in map Klein coordinates
+//Walks go from tile to tile through the neighbour table, a face without a neighbour blocks them, and a tile is visible
+//while some line from anywhere in the start tile passes every face on the way to it, so no visible tile is left out
+//Tiles next to a visible one are visible too, walks over budget and closed maps keep every connected tile
+//
+//The sets are stored as a trailer after the tile records of a map file, either format:
+//  header, zlib(first word and word count per row, row words), trailer size, magic
+namespace WarpVisibility {
+
+    //Fill visibility for a geometry with neighbours, budget is the portal sequences one tile may open
+    void Compute(const FWarpGeometry& geometry, int32 budget, FWarpVisibility* out);
+
+    //Bytes the trailer takes at the end of a map file, 0 without one
+    int32 TrailerSize(const TArray<uint8>& data);
+
+    //Append visibility to map data, replacing a trailer already there
+    void Append(const FWarpVisibility& visibility, int32 tiles, TArray<uint8>* data);
+
+    //Read the trailer of a map with this many tiles, false if there is none or it does not match
+    bool Read(const TArray<uint8>& data, int32 tiles, FWarpVisibility* out);
+
+}